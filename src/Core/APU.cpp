@@ -0,0 +1,743 @@
+#include <algorithm>
+
+#include "APU.h"
+#include "CPU.h"
+#include "Memory.h"
+
+namespace
+{
+    constexpr uint8_t LENGTH_TABLE[32] = {
+        10, 254, 20, 2, 40, 4, 80, 6, 160, 8, 60, 10, 14, 12, 26, 14,
+        12, 16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30};
+
+    constexpr uint8_t DUTY_TABLE[4][8] = {
+        {0, 1, 0, 0, 0, 0, 0, 0},
+        {0, 1, 1, 0, 0, 0, 0, 0},
+        {0, 1, 1, 1, 1, 0, 0, 0},
+        {1, 0, 0, 1, 1, 1, 1, 1}};
+
+    constexpr uint8_t TRIANGLE_TABLE[32] = {
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+
+    // Timer periods in CPU cycles.
+    constexpr uint16_t NOISE_PERIODS[16] = {
+        4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068};
+
+    constexpr uint16_t DMC_PERIODS[16] = {
+        428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54};
+
+    // Frame counter steps in CPU cycles from the start of the sequence,
+    // and the sequence lengths, for the 4-step and 5-step modes.
+    constexpr uint64_t FRAME_STEPS[2][5] = {
+        {7457, 14913, 22371, 29829, 0},
+        {7457, 14913, 22371, 29829, 37281}};
+
+    constexpr uint64_t FRAME_PERIODS[2] = {29830, 37282};
+
+    constexpr unsigned int FRAME_STEP_COUNTS[2] = {4, 5};
+
+    // Per-unit output of each channel in the nesdev wiki's linear mixer
+    // approximation, scaled so all channels at full volume stay within
+    // 16 bits. Linear mixing lets every channel feed the Synth on its own.
+    constexpr int PULSE_GAIN = 246;
+    constexpr int TRIANGLE_GAIN = 279;
+    constexpr int NOISE_GAIN = 162;
+    constexpr int DMC_GAIN = 110;
+
+    // Runs a timer that is timer cycles from its next clock for elapsed
+    // cycles and returns how many times it clocked.
+    uint64_t advanceTimer(uint32_t &timer, uint32_t period, uint64_t elapsed)
+    {
+        if (elapsed < timer)
+        {
+            timer -= elapsed;
+            return 0;
+        }
+
+        elapsed -= timer;
+        timer = period - elapsed % period;
+
+        return 1 + elapsed / period;
+    }
+
+    unsigned int getVolume(const nemus::core::Envelope &envelope)
+    {
+        return envelope.constant ? envelope.period : envelope.decay;
+    }
+
+    void clockEnvelope(nemus::core::Envelope &envelope)
+    {
+        if (envelope.start)
+        {
+            envelope.start = false;
+            envelope.decay = 15;
+            envelope.divider = envelope.period;
+        }
+        else if (envelope.divider == 0)
+        {
+            envelope.divider = envelope.period;
+
+            if (envelope.decay > 0)
+            {
+                envelope.decay--;
+            }
+            else if (envelope.loop)
+            {
+                envelope.decay = 15;
+            }
+        }
+        else
+        {
+            envelope.divider--;
+        }
+    }
+
+    // The period the sweep unit would move to. Pulse 1 negates in ones'
+    // complement, pulse 2 in two's complement.
+    int getSweepTarget(const nemus::core::Pulse &pulse, unsigned int index)
+    {
+        const int change = pulse.period >> pulse.sweepShift;
+
+        return pulse.sweepNegate ? pulse.period - change - (index == 0 ? 1 : 0) : pulse.period + change;
+    }
+
+    // Too high a pitch, or a sweep that would overflow, mutes the channel
+    // and stops the sweep whether or not the sweep is enabled.
+    bool isSweepMuting(const nemus::core::Pulse &pulse, unsigned int index)
+    {
+        return pulse.period < 8 || getSweepTarget(pulse, index) > 0x7FF;
+    }
+}
+
+nemus::core::APU::APU() : m_samples(APU_SAMPLE_QUEUE_SIZE)
+{
+    reset();
+}
+
+void nemus::core::APU::reset()
+{
+    m_pulse[0] = {};
+    m_pulse[1] = {};
+    m_triangle = {};
+    m_noise = {};
+    m_dmc = {};
+
+    m_pulse[0].timer = 2;
+    m_pulse[1].timer = 2;
+    m_triangle.timer = 1;
+
+    m_noise.shift = 1;
+    m_noise.period = NOISE_PERIODS[0];
+    m_noise.timer = m_noise.period;
+
+    m_dmc.silence = true;
+    m_dmc.bits = 8;
+    m_dmc.period = DMC_PERIODS[0];
+    m_dmc.timer = m_dmc.period;
+
+    m_fiveStep = false;
+    m_irqInhibit = false;
+    m_frameIrq = false;
+    m_dmcIrq = false;
+    m_frameStep = 0;
+    m_sequenceStart = 0;
+
+    m_cycle = 0;
+    m_frameStart = 0;
+
+    m_synth.clear();
+}
+
+void nemus::core::APU::setSampleRate(unsigned int rate)
+{
+    m_sampleRate = rate;
+    m_synth.setRates(APU_CLOCK_RATE, rate);
+
+    clearOutputs();
+}
+
+void nemus::core::APU::clearOutputs()
+{
+    m_pulse[0].output = 0;
+    m_pulse[1].output = 0;
+    m_triangle.output = 0;
+    m_noise.output = 0;
+    m_dmc.output = 0;
+}
+
+void nemus::core::APU::setOutput(int &output, uint64_t time, int value)
+{
+    if (value != output)
+    {
+        m_synth.addDelta(static_cast<uint32_t>(time - m_frameStart), value - output);
+        output = value;
+    }
+}
+
+void nemus::core::APU::catchUp()
+{
+    const uint64_t target = m_cpu->getCycles();
+
+    while (m_cycle < target)
+    {
+        const uint64_t event = getFrameEvent();
+        const uint64_t end = std::min(target, event);
+
+        // Only the DMC affects what the CPU sees; the others just make sound.
+        if (m_synth.isEnabled())
+        {
+            runPulse(0, end);
+            runPulse(1, end);
+            runTriangle(end);
+            runNoise(end);
+        }
+
+        runDMC(end);
+
+        m_cycle = end;
+
+        if (m_cycle == event)
+        {
+            clockFrameCounter();
+        }
+    }
+}
+
+uint64_t nemus::core::APU::getNextEvent()
+{
+    uint64_t next = UINT64_MAX;
+
+    // Step 3 of the 4-step sequence raises the frame IRQ.
+    if (!m_fiveStep && !m_irqInhibit)
+    {
+        next = m_sequenceStart + FRAME_STEPS[0][3];
+    }
+
+    // The DMC can only run out of sample when it needs its next byte.
+    if (m_dmc.irqEnabled && m_dmc.remaining > 0)
+    {
+        next = std::min(next, m_cycle + m_dmc.timer + (m_dmc.bits - 1) * uint64_t{m_dmc.period});
+    }
+
+    return next;
+}
+
+void nemus::core::APU::endFrame()
+{
+    catchUp();
+
+    if (m_synth.isEnabled())
+    {
+        const std::size_t count = m_synth.endFrame(static_cast<uint32_t>(m_cycle - m_frameStart));
+        m_samples.push(m_synth.getSamples(), count);
+    }
+
+    m_frameStart = m_cycle;
+}
+
+void nemus::core::APU::runPulse(unsigned int index, uint64_t end)
+{
+    Pulse &pulse = m_pulse[index];
+
+    const bool audible = pulse.length > 0 && !isSweepMuting(pulse, index);
+    const int volume = audible ? getVolume(pulse.envelope) * PULSE_GAIN : 0;
+    const uint32_t period = (pulse.period + 1) * 2;
+
+    uint64_t time = m_cycle;
+
+    setOutput(pulse.output, time, DUTY_TABLE[pulse.duty][pulse.step] * volume);
+
+    if (volume == 0)
+    {
+        pulse.step = (pulse.step + advanceTimer(pulse.timer, period, end - time)) & 7;
+        return;
+    }
+
+    while (pulse.timer <= end - time)
+    {
+        time += pulse.timer;
+        pulse.timer = period;
+        pulse.step = (pulse.step + 1) & 7;
+
+        setOutput(pulse.output, time, DUTY_TABLE[pulse.duty][pulse.step] * volume);
+    }
+
+    pulse.timer -= end - time;
+}
+
+void nemus::core::APU::runTriangle(uint64_t end)
+{
+    const uint32_t period = m_triangle.period + 1;
+
+    uint64_t time = m_cycle;
+
+    setOutput(m_triangle.output, time, TRIANGLE_TABLE[m_triangle.step] * TRIANGLE_GAIN);
+
+    // The sequencer holds its level while silenced. Timer values below 2
+    // are ultrasonic and would cost a clock per cycle, so they hold too.
+    if (m_triangle.length == 0 || m_triangle.linear == 0 || period < 3)
+    {
+        advanceTimer(m_triangle.timer, period, end - time);
+        return;
+    }
+
+    while (m_triangle.timer <= end - time)
+    {
+        time += m_triangle.timer;
+        m_triangle.timer = period;
+        m_triangle.step = (m_triangle.step + 1) & 31;
+
+        setOutput(m_triangle.output, time, TRIANGLE_TABLE[m_triangle.step] * TRIANGLE_GAIN);
+    }
+
+    m_triangle.timer -= end - time;
+}
+
+void nemus::core::APU::runNoise(uint64_t end)
+{
+    const int volume = m_noise.length > 0 ? getVolume(m_noise.envelope) * NOISE_GAIN : 0;
+    const unsigned int tap = m_noise.mode ? 6 : 1;
+
+    uint64_t time = m_cycle;
+
+    setOutput(m_noise.output, time, (m_noise.shift & 1) ? 0 : volume);
+
+    // Nobody hears the shift register while the channel is silent.
+    if (volume == 0)
+    {
+        advanceTimer(m_noise.timer, m_noise.period, end - time);
+        return;
+    }
+
+    while (m_noise.timer <= end - time)
+    {
+        time += m_noise.timer;
+        m_noise.timer = m_noise.period;
+
+        const unsigned int feedback = (m_noise.shift ^ (m_noise.shift >> tap)) & 1;
+        m_noise.shift = (m_noise.shift >> 1) | (feedback << 14);
+
+        setOutput(m_noise.output, time, (m_noise.shift & 1) ? 0 : volume);
+    }
+
+    m_noise.timer -= end - time;
+}
+
+void nemus::core::APU::runDMC(uint64_t end)
+{
+    uint64_t time = m_cycle;
+
+    if (m_synth.isEnabled())
+    {
+        setOutput(m_dmc.output, time, m_dmc.level * DMC_GAIN);
+    }
+
+    // Idle, the output unit only counts down its bits.
+    if (m_dmc.silence && !m_dmc.bufferFull && m_dmc.remaining == 0)
+    {
+        const uint64_t clocks = advanceTimer(m_dmc.timer, m_dmc.period, end - time);
+        m_dmc.bits = (m_dmc.bits + 7 - clocks % 8) % 8 + 1;
+        return;
+    }
+
+    while (m_dmc.timer <= end - time)
+    {
+        time += m_dmc.timer;
+        m_dmc.timer = m_dmc.period;
+
+        clockDMC(time);
+    }
+
+    m_dmc.timer -= end - time;
+}
+
+void nemus::core::APU::clockDMC(uint64_t time)
+{
+    if (!m_dmc.silence)
+    {
+        if (m_dmc.shift & 1)
+        {
+            if (m_dmc.level <= 125)
+            {
+                m_dmc.level += 2;
+            }
+        }
+        else if (m_dmc.level >= 2)
+        {
+            m_dmc.level -= 2;
+        }
+
+        if (m_synth.isEnabled())
+        {
+            setOutput(m_dmc.output, time, m_dmc.level * DMC_GAIN);
+        }
+    }
+
+    m_dmc.shift >>= 1;
+
+    if (--m_dmc.bits == 0)
+    {
+        m_dmc.bits = 8;
+        m_dmc.silence = !m_dmc.bufferFull;
+
+        if (m_dmc.bufferFull)
+        {
+            m_dmc.shift = m_dmc.buffer;
+            m_dmc.bufferFull = false;
+
+            fetchSample();
+        }
+    }
+}
+
+void nemus::core::APU::fetchSample()
+{
+    if (m_dmc.bufferFull || m_dmc.remaining == 0)
+    {
+        return;
+    }
+
+    // The CPU is not stalled for the fetch.
+    m_dmc.buffer = m_memory->readByte(m_dmc.address);
+    m_dmc.bufferFull = true;
+    m_dmc.address = m_dmc.address == 0xFFFF ? 0x8000 : m_dmc.address + 1;
+
+    if (--m_dmc.remaining == 0)
+    {
+        if (m_dmc.loop)
+        {
+            m_dmc.address = m_dmc.sampleAddress;
+            m_dmc.remaining = m_dmc.sampleLength;
+        }
+        else if (m_dmc.irqEnabled)
+        {
+            setDMCIrq(true);
+        }
+    }
+}
+
+uint64_t nemus::core::APU::getFrameEvent()
+{
+    return m_sequenceStart + FRAME_STEPS[m_fiveStep][m_frameStep];
+}
+
+void nemus::core::APU::clockFrameCounter()
+{
+    const unsigned int step = m_frameStep;
+
+    if (!m_fiveStep)
+    {
+        clockQuarterFrame();
+
+        if (step == 1 || step == 3)
+        {
+            clockHalfFrame();
+        }
+
+        if (step == 3 && !m_irqInhibit)
+        {
+            setFrameIrq(true);
+        }
+    }
+    else if (step != 3)
+    {
+        clockQuarterFrame();
+
+        if (step == 1 || step == 4)
+        {
+            clockHalfFrame();
+        }
+    }
+
+    if (++m_frameStep == FRAME_STEP_COUNTS[m_fiveStep])
+    {
+        m_frameStep = 0;
+        m_sequenceStart += FRAME_PERIODS[m_fiveStep];
+    }
+}
+
+void nemus::core::APU::clockQuarterFrame()
+{
+    clockEnvelope(m_pulse[0].envelope);
+    clockEnvelope(m_pulse[1].envelope);
+    clockEnvelope(m_noise.envelope);
+
+    if (m_triangle.linearReload)
+    {
+        m_triangle.linear = m_triangle.linearPeriod;
+    }
+    else if (m_triangle.linear > 0)
+    {
+        m_triangle.linear--;
+    }
+
+    if (!m_triangle.control)
+    {
+        m_triangle.linearReload = false;
+    }
+}
+
+void nemus::core::APU::clockHalfFrame()
+{
+    for (unsigned int index = 0; index < 2; index++)
+    {
+        Pulse &pulse = m_pulse[index];
+
+        if (!pulse.envelope.loop && pulse.length > 0)
+        {
+            pulse.length--;
+        }
+
+        if (pulse.sweepDivider == 0 && pulse.sweepEnabled && pulse.sweepShift > 0 && !isSweepMuting(pulse, index))
+        {
+            pulse.period = static_cast<uint16_t>(std::max(getSweepTarget(pulse, index), 0));
+        }
+
+        if (pulse.sweepDivider == 0 || pulse.sweepReload)
+        {
+            pulse.sweepDivider = pulse.sweepPeriod;
+            pulse.sweepReload = false;
+        }
+        else
+        {
+            pulse.sweepDivider--;
+        }
+    }
+
+    if (!m_triangle.control && m_triangle.length > 0)
+    {
+        m_triangle.length--;
+    }
+
+    if (!m_noise.envelope.loop && m_noise.length > 0)
+    {
+        m_noise.length--;
+    }
+}
+
+void nemus::core::APU::setFrameIrq(bool asserted)
+{
+    m_frameIrq = asserted;
+    m_cpu->setIrq(comp::IRQ_FRAME_COUNTER, asserted);
+}
+
+void nemus::core::APU::setDMCIrq(bool asserted)
+{
+    m_dmcIrq = asserted;
+    m_cpu->setIrq(comp::IRQ_DMC, asserted);
+}
+
+void nemus::core::APU::writeRegister(uint8_t data, uint16_t address)
+{
+    switch (address)
+    {
+    case 0x4000:
+    case 0x4004:
+    {
+        Pulse &pulse = m_pulse[(address - 0x4000) / 4];
+        pulse.duty = data >> 6;
+        pulse.envelope.loop = data & 0x20;
+        pulse.envelope.constant = data & 0x10;
+        pulse.envelope.period = data & 0xF;
+    }
+    break;
+    case 0x4001:
+    case 0x4005:
+    {
+        Pulse &pulse = m_pulse[(address - 0x4000) / 4];
+        pulse.sweepEnabled = data & 0x80;
+        pulse.sweepPeriod = (data >> 4) & 0x7;
+        pulse.sweepNegate = data & 0x08;
+        pulse.sweepShift = data & 0x7;
+        pulse.sweepReload = true;
+    }
+    break;
+    case 0x4002:
+    case 0x4006:
+    {
+        Pulse &pulse = m_pulse[(address - 0x4000) / 4];
+        pulse.period = (pulse.period & 0x700) | data;
+    }
+    break;
+    case 0x4003:
+    case 0x4007:
+    {
+        Pulse &pulse = m_pulse[(address - 0x4000) / 4];
+        pulse.period = (pulse.period & 0xFF) | ((data & 0x7) << 8);
+        pulse.step = 0;
+        pulse.envelope.start = true;
+
+        if (pulse.enabled)
+        {
+            pulse.length = LENGTH_TABLE[data >> 3];
+        }
+    }
+    break;
+    case 0x4008:
+        m_triangle.control = data & 0x80;
+        m_triangle.linearPeriod = data & 0x7F;
+        break;
+    case 0x400A:
+        m_triangle.period = (m_triangle.period & 0x700) | data;
+        break;
+    case 0x400B:
+        m_triangle.period = (m_triangle.period & 0xFF) | ((data & 0x7) << 8);
+        m_triangle.linearReload = true;
+
+        if (m_triangle.enabled)
+        {
+            m_triangle.length = LENGTH_TABLE[data >> 3];
+        }
+        break;
+    case 0x400C:
+        m_noise.envelope.loop = data & 0x20;
+        m_noise.envelope.constant = data & 0x10;
+        m_noise.envelope.period = data & 0xF;
+        break;
+    case 0x400E:
+        m_noise.mode = data & 0x80;
+        m_noise.period = NOISE_PERIODS[data & 0xF];
+        break;
+    case 0x400F:
+        m_noise.envelope.start = true;
+
+        if (m_noise.enabled)
+        {
+            m_noise.length = LENGTH_TABLE[data >> 3];
+        }
+        break;
+    case 0x4010:
+        m_dmc.irqEnabled = data & 0x80;
+        m_dmc.loop = data & 0x40;
+        m_dmc.period = DMC_PERIODS[data & 0xF];
+
+        if (!m_dmc.irqEnabled)
+        {
+            setDMCIrq(false);
+        }
+        break;
+    case 0x4011:
+        m_dmc.level = data & 0x7F;
+        break;
+    case 0x4012:
+        m_dmc.sampleAddress = 0xC000 + data * 64;
+        break;
+    case 0x4013:
+        m_dmc.sampleLength = data * 16 + 1;
+        break;
+    case 0x4015:
+        m_pulse[0].enabled = data & 0x01;
+        m_pulse[1].enabled = data & 0x02;
+        m_triangle.enabled = data & 0x04;
+        m_noise.enabled = data & 0x08;
+
+        if (!m_pulse[0].enabled)
+        {
+            m_pulse[0].length = 0;
+        }
+
+        if (!m_pulse[1].enabled)
+        {
+            m_pulse[1].length = 0;
+        }
+
+        if (!m_triangle.enabled)
+        {
+            m_triangle.length = 0;
+        }
+
+        if (!m_noise.enabled)
+        {
+            m_noise.length = 0;
+        }
+
+        if (!(data & 0x10))
+        {
+            m_dmc.remaining = 0;
+        }
+        else if (m_dmc.remaining == 0)
+        {
+            m_dmc.address = m_dmc.sampleAddress;
+            m_dmc.remaining = m_dmc.sampleLength;
+            fetchSample();
+        }
+
+        setDMCIrq(false);
+        break;
+    case 0x4017:
+        m_fiveStep = data & 0x80;
+        m_irqInhibit = data & 0x40;
+        m_frameStep = 0;
+        m_sequenceStart = m_cycle;
+
+        if (m_irqInhibit)
+        {
+            setFrameIrq(false);
+        }
+
+        if (m_fiveStep)
+        {
+            clockQuarterFrame();
+            clockHalfFrame();
+        }
+        break;
+    default:
+        break;
+    }
+
+    // A write can start a sample or the frame counter, bringing the next
+    // IRQ before the deadline the CPU is running to.
+    m_cpu->limitRun(getNextEvent());
+}
+
+uint8_t nemus::core::APU::readStatus()
+{
+    uint8_t status = 0;
+
+    status |= m_pulse[0].length > 0 ? 0x01 : 0;
+    status |= m_pulse[1].length > 0 ? 0x02 : 0;
+    status |= m_triangle.length > 0 ? 0x04 : 0;
+    status |= m_noise.length > 0 ? 0x08 : 0;
+    status |= m_dmc.remaining > 0 ? 0x10 : 0;
+    status |= m_frameIrq ? 0x40 : 0;
+    status |= m_dmcIrq ? 0x80 : 0;
+
+    setFrameIrq(false);
+
+    return status;
+}
+
+void nemus::core::APU::saveState(StateWriter &state)
+{
+    state.write(m_pulse);
+    state.write(m_triangle);
+    state.write(m_noise);
+    state.write(m_dmc);
+    state.write(m_fiveStep);
+    state.write(m_irqInhibit);
+    state.write(m_frameIrq);
+    state.write(m_dmcIrq);
+    state.write(m_frameStep);
+    state.write(m_sequenceStart);
+    state.write(m_cycle);
+}
+
+void nemus::core::APU::loadState(StateReader &state)
+{
+    state.read(m_pulse);
+    state.read(m_triangle);
+    state.read(m_noise);
+    state.read(m_dmc);
+    state.read(m_fiveStep);
+    state.read(m_irqInhibit);
+    state.read(m_frameIrq);
+    state.read(m_dmcIrq);
+    state.read(m_frameStep);
+    state.read(m_sequenceStart);
+    state.read(m_cycle);
+
+    m_frameStart = m_cycle;
+    m_synth.clear();
+    clearOutputs();
+}
@@ -0,0 +1,217 @@
+#ifndef NEMUS_APU_H
+#define NEMUS_APU_H
+
+#include <cstdint>
+
+#include "ComponentHelper.h"
+#include "SampleQueue.h"
+#include "State.h"
+#include "Synth.h"
+
+// NTSC CPU clock, which also clocks the APU.
+#define APU_CLOCK_RATE 1789773
+
+#define APU_SAMPLE_QUEUE_SIZE (1 << 14)
+
+namespace nemus::core
+{
+    class CPU;
+
+    class Memory;
+
+    struct Envelope
+    {
+        bool start;
+        bool loop;
+        bool constant;
+        uint8_t period;
+        uint8_t divider;
+        uint8_t decay;
+    };
+
+    struct Pulse
+    {
+        Envelope envelope;
+        bool enabled;
+        uint8_t duty;
+        uint8_t step;
+        uint8_t length;
+        uint16_t period;
+        uint32_t timer;
+        bool sweepEnabled;
+        bool sweepNegate;
+        bool sweepReload;
+        uint8_t sweepPeriod;
+        uint8_t sweepShift;
+        uint8_t sweepDivider;
+        int output;
+    };
+
+    struct Triangle
+    {
+        bool enabled;
+        bool control;
+        bool linearReload;
+        uint8_t linearPeriod;
+        uint8_t linear;
+        uint8_t step;
+        uint8_t length;
+        uint16_t period;
+        uint32_t timer;
+        int output;
+    };
+
+    struct Noise
+    {
+        Envelope envelope;
+        bool enabled;
+        bool mode;
+        uint8_t length;
+        uint16_t shift;
+        uint16_t period;
+        uint32_t timer;
+        int output;
+    };
+
+    struct DMC
+    {
+        bool irqEnabled;
+        bool loop;
+        bool silence;
+        bool bufferFull;
+        uint8_t buffer;
+        uint8_t shift;
+        uint8_t bits;
+        uint8_t level;
+        uint16_t sampleAddress;
+        uint16_t sampleLength;
+        uint16_t address;
+        uint16_t remaining;
+        uint16_t period;
+        uint32_t timer;
+        int output;
+    };
+
+    // The 2A03 sound hardware. Like the PPU it runs behind the CPU and is
+    // caught up on register accesses and at its own events, which are the
+    // IRQs it can raise. Catching up runs each channel over the whole span
+    // from timer reload to timer reload, and the channels hand only their
+    // level changes to a band-limited Synth, so there is no per-cycle work.
+    // endFrame() turns the frame's changes into samples for the queue.
+    //
+    // Without a sample rate nothing is synthesized and only the frame
+    // counter and DMC run, as the CPU can observe those.
+    class APU
+    {
+    private:
+        CPU *m_cpu = nullptr;
+
+        Memory *m_memory = nullptr;
+
+        Synth m_synth;
+
+        SampleQueue m_samples;
+
+        unsigned int m_sampleRate = 0;
+
+        Pulse m_pulse[2];
+
+        Triangle m_triangle;
+
+        Noise m_noise;
+
+        DMC m_dmc;
+
+        bool m_fiveStep = false;
+
+        bool m_irqInhibit = false;
+
+        bool m_frameIrq = false;
+
+        bool m_dmcIrq = false;
+
+        unsigned int m_frameStep = 0;
+
+        // CPU cycle at which the frame counter's sequence last restarted.
+        uint64_t m_sequenceStart = 0;
+
+        // CPU cycle the APU has run up to and the one the Synth's current
+        // frame started at.
+        uint64_t m_cycle = 0;
+
+        uint64_t m_frameStart = 0;
+
+        // Moves a channel's level to value at CPU cycle time.
+        void setOutput(int &output, uint64_t time, int value);
+
+        void runPulse(unsigned int index, uint64_t end);
+
+        void runTriangle(uint64_t end);
+
+        void runNoise(uint64_t end);
+
+        void runDMC(uint64_t end);
+
+        void clockDMC(uint64_t time);
+
+        // Refills the DMC's sample buffer from memory if it is empty.
+        void fetchSample();
+
+        void clockFrameCounter();
+
+        void clockQuarterFrame();
+
+        void clockHalfFrame();
+
+        uint64_t getFrameEvent();
+
+        void setFrameIrq(bool asserted);
+
+        void setDMCIrq(bool asserted);
+
+        void clearOutputs();
+
+    public:
+        APU();
+
+        void reset();
+
+        void setCPU(CPU *cpu) { m_cpu = cpu; }
+
+        void setMemory(Memory *memory) { m_memory = memory; }
+
+        // Samples per second pushed to the queue; 0, the default, disables
+        // synthesis. Kept across resets.
+        void setSampleRate(unsigned int rate);
+
+        unsigned int getSampleRate() { return m_sampleRate; }
+
+        // See Synth::setResampleRatio().
+        void setResampleRatio(double ratio) { m_synth.setResampleRatio(ratio); }
+
+        // Mono samples for the audio backend, a frame's worth per endFrame().
+        SampleQueue *getSampleQueue() { return &m_samples; }
+
+        // Advances the APU to the CPU's current cycle count.
+        void catchUp();
+
+        // CPU cycle of the next IRQ the APU may raise.
+        uint64_t getNextEvent();
+
+        // Catches up and pushes the samples of everything since the last
+        // call. Called by the console at the end of each video frame.
+        void endFrame();
+
+        void writeRegister(uint8_t data, uint16_t address);
+
+        // $4015. Acknowledges the frame IRQ.
+        uint8_t readStatus();
+
+        // Only emulated state is saved; synthesis restarts from silence.
+        void saveState(StateWriter &state);
+
+        void loadState(StateReader &state);
+    };
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include <algorithm>
+
+#include "Batch.h"
+
+nemus::core::Batch::Batch(std::size_t size, const std::vector<char> &gameData, unsigned int threads)
+    : m_runner(threads), m_cartridge(std::make_shared<const Cartridge>(gameData))
+{
+    for (std::size_t i = 0; i < size; i++)
+    {
+        m_consoles.push_back(std::make_unique<Console>());
+        m_consoles.back()->loadGame(m_cartridge);
+        m_runner.add(m_consoles.back().get());
+    }
+}
+
+void nemus::core::Batch::setBuffers(void *frames, comp::PixelFormat format, unsigned char *ram)
+{
+    const std::size_t frameBytes = FRAME_SIZE * comp::getPixelSize(format);
+
+    for (std::size_t i = 0; i < m_consoles.size(); i++)
+    {
+        m_consoles[i]->setPixelFormat(format);
+        m_consoles[i]->setFramebuffer(frames != nullptr ? static_cast<unsigned char *>(frames) + i * frameBytes : nullptr);
+    }
+
+    m_ram = ram;
+}
+
+void nemus::core::Batch::step(const uint8_t *actions)
+{
+    m_runner.forEach([this, actions](std::size_t index, Console &console) {
+        if (actions != nullptr)
+        {
+            console.getInput()->setButtons(actions[index]);
+        }
+
+        console.runFrame();
+
+        if (m_ram != nullptr && console.isGameLoaded())
+        {
+            std::copy_n(console.getRam(), RAM_SIZE, m_ram + index * RAM_SIZE);
+        }
+    });
+}
+
+void nemus::core::Batch::reset()
+{
+    for (auto &console : m_consoles)
+    {
+        console->loadGame(m_cartridge);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef NEMUS_BATCH_H
+#define NEMUS_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Console.h"
+#include "Runner.h"
+
+namespace nemus::core
+{
+    // A fixed set of consoles running the same game, stepped one frame at
+    // a time for training loops. Observations go to caller-owned storage
+    // laid out as structure of arrays: console i's frame starts at
+    // frames + i * FRAME_SIZE and its RAM at ram + i * RAM_SIZE, so a
+    // whole step hands over as two contiguous blocks.
+    class Batch
+    {
+    public:
+        // In pixels; see comp::getPixelSize() for bytes.
+        static constexpr std::size_t FRAME_SIZE = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+        static constexpr std::size_t RAM_SIZE = 0x800;
+
+    private:
+        std::vector<std::unique_ptr<Console>> m_consoles;
+
+        Runner m_runner;
+
+        // Loaded by every console, so the ROM is in memory once.
+        std::shared_ptr<const Cartridge> m_cartridge;
+
+        unsigned char *m_ram = nullptr;
+
+    public:
+        // threads is passed on to the Runner.
+        Batch(std::size_t size, const std::vector<char> &gameData, unsigned int threads = 0);
+
+        Batch(const Batch &) = delete;
+
+        Batch &operator=(const Batch &) = delete;
+
+        // frames holds size * FRAME_SIZE pixels of the given format and ram
+        // size * RAM_SIZE bytes; either may be nullptr. The PPUs draw
+        // straight into frames, while RAM is copied after each step since
+        // compiled code and the CPU's page tables point at each console's
+        // own RAM.
+        void setBuffers(void *frames, comp::PixelFormat format, unsigned char *ram);
+
+        // Sets console i's buttons to actions[i] (bit n is button n) and
+        // runs one frame on every console. nullptr keeps the buttons held.
+        // Halted consoles keep their last observation.
+        void step(const uint8_t *actions);
+
+        // Reloads the game on every console.
+        void reset();
+
+        // False if gameData was not a usable ROM image, in which case no
+        // console has a game and step() does nothing.
+        bool isGameLoaded() { return m_cartridge->isValid(); }
+
+        std::size_t getSize() { return m_consoles.size(); }
+
+        unsigned int getThreadCount() { return m_runner.getThreadCount(); }
+
+        Console &getConsole(std::size_t index) { return *m_consoles[index]; }
+    };
+}
+
+#endif
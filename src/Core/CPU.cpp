@@ -1,5 +1,6 @@
+#include <algorithm>
+#include <cstring>
 #include <sstream>
-#include <QMessageBox>
 #include "CPU.h"
 #include "Memory.h"
 
@@ -15,6 +16,12 @@ nemus::core::CPU::CPU(Memory *memory, debug::Logger *logger)
 
     m_logger = logger;
 
+    m_blocks.resize(BLOCK_CACHE_SIZE);
+
+    m_jitState.ram = m_memory->getRam();
+    m_jitState.readPages = m_memory->getReadPages();
+    m_jitState.writePages = m_memory->getWritePages();
+
     m_reg.pc = m_memory->readWord(0xFFFC);
 
     std::stringstream sstream;
@@ -22,820 +29,431 @@ nemus::core::CPU::CPU(Memory *memory, debug::Logger *logger)
 
     m_logger->write(sstream.str());
 
-    setFlags(0x34);
-
     m_logger->write("CPU Initialized");
 
     m_running = true;
 }
 
-int nemus::core::CPU::tick()
+template <bool Trace>
+int nemus::core::CPU::step()
+{
+    if (isInterruptPending())
+    {
+        return interrupt();
+    }
+
+    return execute<Trace>(decode(m_reg.pc));
+}
+
+template <bool Trace>
+int nemus::core::CPU::execute(const DecodedInstruction &instruction)
+{
+    if constexpr (Trace)
+    {
+        traceInstruction(instruction.opcode);
+    }
+
+    m_operand = instruction.operand;
+
+    unsigned int pageCycle = instruction.handler(*this);
+
+    if (!m_running)
+    {
+        return 0;
+    }
+
+    m_reg.pc += instruction.size;
+
+    const int cycles = instruction.cycles + pageCycle;
+
+    m_cycles += cycles;
+
+    return cycles;
+}
+
+template <bool Trace>
+void nemus::core::CPU::run(uint64_t untilCycle)
 {
-    // NMI
-    if (m_interrupt != comp::INT_NONE)
+    m_deadline = untilCycle;
+
+    do
     {
-        if (m_interrupt == comp::INT_NMI || !m_flags.I)
+        if (isInterruptPending())
         {
             interrupt();
-            return 0;
+            continue;
         }
-    }
 
-    unsigned int op = m_memory->readByte(m_reg.pc);
-    unsigned int pageCycle = 0;
+        const unsigned char *code = m_memory->getCodePointer(m_reg.pc);
 
-    switch (op)
-    {
-    // NOP
-    case 0x04:
-    case 0x44:
-    case 0x64:
-    case 0x0C:
-    case 0x14:
-    case 0x1A:
-    case 0x1C:
-    case 0x34:
-    case 0x3A:
-    case 0x3C:
-    case 0x54:
-    case 0x5A:
-    case 0x5C:
-    case 0x74:
-    case 0x7A:
-    case 0x7C:
-    case 0xD4:
-    case 0xDA:
-    case 0xDC:
-    case 0xF4:
-    case 0xFA:
-    case 0xFC:
-    case 0x80:
-    case 0xEA:
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "NOP", 0, comp::ADDR_MODE_IMPLIED);
-        break;
-
-    // SEI
-    case 0x78:
-        setFlags(comp::FLAG_INTERRUPT);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "SEI", 0, comp::ADDR_MODE_IMPLIED);
-        break;
-
-    // SEC
-    case 0x38:
-        setFlags(comp::FLAG_CARRY);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "SEC", 0, comp::ADDR_MODE_IMPLIED);
-        break;
-
-    // SED
-    case 0xF8:
-        setFlags(comp::FLAG_DECIMAL);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "SED", 0, comp::ADDR_MODE_IMPLIED);
-        break;
-    // CLV
-    case 0xB8:
-        unsetFlags(comp::FLAG_OVERFLOW);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "CLV", 0, comp::ADDR_MODE_IMPLIED);
-        break;
-
-    // CLC
-    case 0x18:
-        unsetFlags(comp::FLAG_CARRY);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "CLC", 0, comp::ADDR_MODE_IMPLIED);
-        break;
-
-    // CLI
-    case 0x58:
-        unsetFlags(comp::FLAG_INTERRUPT);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "CLI", 0, comp::ADDR_MODE_IMPLIED);
-        break;
-
-    // CLD
-    case 0xD8:
-        unsetFlags(comp::FLAG_DECIMAL);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "CLD", 0, comp::ADDR_MODE_IMPLIED);
-        break;
+        Block *block = nullptr;
+        if (code != nullptr)
+        {
+            block = &m_blocks[getBlockIndex(code)];
 
-    // LDA
-    case 0xA9:
-        load(m_reg.a, comp::ADDR_MODE_IMMEDIATE);
-        break;
-    case 0xA5:
-        load(m_reg.a, comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0xB5:
-        load(m_reg.a, comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0xAD:
-        load(m_reg.a, comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0xBD:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_X);
-        load(m_reg.a, comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-    case 0xB9:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_Y);
-        load(m_reg.a, comp::ADDR_MODE_ABSOLUTE_Y);
-        break;
-    case 0xA1:
-        load(m_reg.a, comp::ADDR_MODE_INDIRECT_X);
-        break;
-    case 0xB1:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_INDIRECT_Y);
-        load(m_reg.a, comp::ADDR_MODE_INDIRECT_Y);
-        break;
+            if (block->code != code)
+            {
+                buildBlock(*block, code, m_reg.pc);
+            }
+        }
 
-    // LDX
-    case 0xA2:
-        load(m_reg.x, comp::ADDR_MODE_IMMEDIATE);
-        break;
-    case 0xA6:
-        load(m_reg.x, comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0xB6:
-        load(m_reg.x, comp::ADDR_MODE_ZERO_PAGE_Y);
-        break;
-    case 0xAE:
-        load(m_reg.x, comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0xBE:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_Y);
-        load(m_reg.x, comp::ADDR_MODE_ABSOLUTE_Y);
-        break;
+        if (block == nullptr || block->length == 0)
+        {
+            execute<Trace>(decode(m_reg.pc));
+            continue;
+        }
 
-    // LDY
-    case 0xA0:
-        load(m_reg.y, comp::ADDR_MODE_IMMEDIATE);
-        break;
-    case 0xA4:
-        load(m_reg.y, comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0xB4:
-        load(m_reg.y, comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0xAC:
-        load(m_reg.y, comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0xBC:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_Y);
-        load(m_reg.y, comp::ADDR_MODE_ABSOLUTE_X);
-        break;
+        if constexpr (!Trace)
+        {
+            if (m_jitMode != comp::JIT_OFF && runNative(*block, m_deadline))
+            {
+                continue;
+            }
+        }
 
-    // STA
-    case 0x85:
-        store(m_reg.a, comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x95:
-        store(m_reg.a, comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x8D:
-        store(m_reg.a, comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x9D:
-        store(m_reg.a, comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-    case 0x99:
-        store(m_reg.a, comp::ADDR_MODE_ABSOLUTE_Y);
-        break;
-    case 0x81:
-        store(m_reg.a, comp::ADDR_MODE_INDIRECT_X);
-        break;
-    case 0x91:
-        store(m_reg.a, comp::ADDR_MODE_INDIRECT_Y);
-        break;
+        const uint32_t generation = m_memory->getMapGeneration();
 
-    // STX
-    case 0x86:
-        store(m_reg.x, comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x96:
-        store(m_reg.x, comp::ADDR_MODE_ZERO_PAGE_Y);
-        break;
-    case 0x8E:
-        store(m_reg.x, comp::ADDR_MODE_ABSOLUTE);
-        break;
+        for (unsigned int i = 0; i < block->length; i++)
+        {
+            execute<Trace>(block->instructions[i]);
+
+            // Leave early for the caller's deadline, for a new interrupt,
+            // or when a bank switch may have moved the rest of the block.
+            if (m_cycles >= m_deadline || isInterruptPending() ||
+                m_memory->getMapGeneration() != generation)
+            {
+                break;
+            }
+        }
+    } while (m_cycles < m_deadline && m_running);
+}
 
-    // STY
-    case 0x84:
-        store(m_reg.y, comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x94:
-        store(m_reg.y, comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x8C:
-        store(m_reg.y, comp::ADDR_MODE_ABSOLUTE);
-        break;
-
-    // TXS
-    case 0x9A:
-        m_reg.sp = m_reg.x;
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "TXS", 0, comp::ADDR_MODE_IMMEDIATE);
-        break;
-
-    // TSX
-    case 0xBA:
-        m_reg.x = m_reg.sp;
-        checkFlags(m_reg.x, comp::FLAG_NEGATIVE | comp::FLAG_ZERO);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "TSX", 0, comp::ADDR_MODE_IMMEDIATE);
-        break;
+template void nemus::core::CPU::run<false>(uint64_t untilCycle);
+template void nemus::core::CPU::run<true>(uint64_t untilCycle);
 
-    // Branching
-    case 0x10:
+void nemus::core::CPU::setJitMode(comp::JitMode mode)
+{
+    if (!Jit::isAvailable())
     {
-        auto address = m_reg.pc;
-        pageCycle = !m_flags.N;
-        branch(!m_flags.N);
-        pageCycle += ((address & 0xFF00) != m_reg.pc + m_opsize[op]) * 2;
-        break;
+        mode = comp::JIT_OFF;
     }
-    case 0x30:
+
+    if (mode != comp::JIT_OFF && !m_jit)
     {
-        auto address = m_reg.pc;
-        pageCycle = m_flags.N;
-        branch(m_flags.N);
-        pageCycle += ((address & 0xFF00) != m_reg.pc + m_opsize[op]) * 2;
-        break;
+        m_jit = std::make_unique<Jit>(m_cyclesTable);
     }
-    case 0x50:
+
+    if (mode == comp::JIT_CHECK && m_checkBefore.empty())
     {
-        auto address = m_reg.pc;
-        pageCycle = !m_flags.V;
-        branch(!m_flags.V);
-        pageCycle += ((address & 0xFF00) != m_reg.pc + m_opsize[op]) * 2;
-        break;
+        m_checkBefore.resize(CPU_PAGE_COUNT * CPU_PAGE_SIZE);
+        m_checkAfter.resize(CPU_PAGE_COUNT * CPU_PAGE_SIZE);
+        m_checkReplayed.resize(CPU_PAGE_COUNT * CPU_PAGE_SIZE);
     }
-    case 0x70:
+
+    m_jitMode = mode;
+}
+
+bool nemus::core::CPU::runNative(Block &block, uint64_t untilCycle)
+{
+    if (block.native != nullptr && block.nativeGeneration != m_jit->getGeneration())
     {
-        auto address = m_reg.pc;
-        pageCycle = m_flags.V;
-        branch(m_flags.V);
-        pageCycle += ((address & 0xFF00) != m_reg.pc + m_opsize[op]) * 2;
-        break;
+        block.native = nullptr;
+        block.runs = 0;
     }
-    case 0x90:
+
+    if (block.native == nullptr)
     {
-        auto address = m_reg.pc;
-        pageCycle = !m_flags.C;
-        branch(!m_flags.C);
-        pageCycle += ((address & 0xFF00) != m_reg.pc + m_opsize[op]) * 2;
-        break;
+        // Blocks that fail to compile stay interpreted for good.
+        if (++block.runs != JIT_THRESHOLD)
+        {
+            return false;
+        }
+
+        block.native = m_jit->compile(block.code, m_reg.pc, block.length, block.nativeCycles, block.nativeWrites);
+        block.nativeGeneration = m_jit->getGeneration();
+
+        if (block.native == nullptr)
+        {
+            return false;
+        }
     }
-    case 0xB0:
+
+    // Native code neither takes interrupts nor watches the deadline, so it
+    // only runs where the interpreter would have run the whole block too.
+    if (isInterruptPending() || m_cycles + block.nativeCycles >= untilCycle)
     {
-        auto address = m_reg.pc;
-        pageCycle = m_flags.C;
-        branch(m_flags.C);
-        pageCycle += ((address & 0xFF00) != m_reg.pc + m_opsize[op]) * 2;
-        break;
+        return false;
     }
-    case 0xD0:
+
+    if (m_jitMode == comp::JIT_CHECK)
     {
-        auto address = m_reg.pc;
-        pageCycle = !m_flags.Z;
-        branch(!m_flags.Z);
-        pageCycle += ((address & 0xFF00) != m_reg.pc + m_opsize[op]) * 2;
-        break;
+        return runChecked(block, untilCycle);
     }
-    case 0xF0:
+
+    // No cycles means it returned before its first instruction, which
+    // the interpreter has to run.
+    return callNative(block.native, untilCycle) != 0;
+}
+
+unsigned int nemus::core::CPU::callNative(Jit::Function function, uint64_t untilCycle)
+{
+    m_jitState.budget = static_cast<uint32_t>(std::min<uint64_t>(untilCycle - m_cycles, UINT32_MAX));
+    m_jitState.reg = m_reg;
+    m_jitState.negative = m_negative;
+    m_jitState.zero = m_zero;
+
+    const unsigned int cycles = function(&m_jitState);
+
+    m_reg = m_jitState.reg;
+    m_negative = m_jitState.negative;
+    m_zero = m_jitState.zero;
+    m_cycles += cycles;
+
+    return cycles;
+}
+
+std::size_t nemus::core::CPU::copyWritablePages(const Jit::PageMask &pages, std::vector<unsigned char> &buffer,
+                                                bool restore)
+{
+    // Pages between one RAM mirror and the next.
+    constexpr unsigned int RAM_MIRROR_PAGES = 0x800 / CPU_PAGE_SIZE;
+
+    unsigned char *const *writePages = m_memory->getWritePages();
+    unsigned char *copy = buffer.data();
+
+    for (unsigned int page = 0; page < CPU_PAGE_COUNT; page++)
     {
-        auto address = m_reg.pc;
-        pageCycle = m_flags.Z;
-        branch(m_flags.Z);
-        pageCycle += ((address & 0xFF00) != m_reg.pc + m_opsize[op]) * 2;
-        break;
+        if (!pages[page] || writePages[page] == nullptr)
+        {
+            continue;
+        }
+
+        // RAM repeats every 2 KB, and one copy of a mirrored page is enough.
+        if (page >= RAM_MIRROR_PAGES && pages[page - RAM_MIRROR_PAGES] &&
+            writePages[page] == writePages[page - RAM_MIRROR_PAGES])
+        {
+            continue;
+        }
+
+        if (restore)
+        {
+            std::memcpy(writePages[page], copy, CPU_PAGE_SIZE);
+        }
+        else
+        {
+            std::memcpy(copy, writePages[page], CPU_PAGE_SIZE);
+        }
+
+        copy += CPU_PAGE_SIZE;
     }
 
-    // CMP
-    case 0xC9:
-        compare(m_reg.a, comp::ADDR_MODE_IMMEDIATE);
-        break;
-    case 0xC5:
-        compare(m_reg.a, comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0xD5:
-        compare(m_reg.a, comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0xCD:
-        compare(m_reg.a, comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0xDD:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_X);
-        compare(m_reg.a, comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-    case 0xD9:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_Y);
-        compare(m_reg.a, comp::ADDR_MODE_ABSOLUTE_Y);
-        break;
-    case 0xC1:
-        compare(m_reg.a, comp::ADDR_MODE_INDIRECT_X);
-        break;
-    case 0xD1:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_INDIRECT_Y);
-        compare(m_reg.a, comp::ADDR_MODE_INDIRECT_Y);
-        break;
+    return copy - buffer.data();
+}
 
-    // CPX
-    case 0xE0:
-        compare(m_reg.x, comp::ADDR_MODE_IMMEDIATE);
-        break;
-    case 0xE4:
-        compare(m_reg.x, comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0xEC:
-        compare(m_reg.x, comp::ADDR_MODE_ABSOLUTE);
-        break;
+bool nemus::core::CPU::runChecked(Block &block, uint64_t untilCycle)
+{
+    // Compiled code only writes mapped memory, so the registers and the
+    // pages its stores can reach are enough to replay it. The interpreter
+    // runs the same instructions, so it writes the same pages.
+    const Jit::PageMask &pages = block.nativeWrites;
+
+    const comp::Registers reg = m_reg;
+    const uint8_t negative = m_negative;
+    const uint8_t zero = m_zero;
+    const uint64_t cycles = m_cycles;
+    copyWritablePages(pages, m_checkBefore, false);
+
+    if (callNative(block.native, untilCycle) == 0)
+    {
+        return false;
+    }
 
-    // CPY
-    case 0xC0:
-        compare(m_reg.y, comp::ADDR_MODE_IMMEDIATE);
-        break;
-    case 0xC4:
-        compare(m_reg.y, comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0xCC:
-        compare(m_reg.y, comp::ADDR_MODE_ABSOLUTE);
-        break;
+    const comp::Registers nativeReg = m_reg;
+    const uint8_t nativeFlags = generateFlags();
+    const uint64_t nativeCycles = m_cycles;
+    const std::size_t size = copyWritablePages(pages, m_checkAfter, false);
 
-    // INC
-    case 0xE6:
-        increment(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0xF6:
-        increment(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0xEE:
-        increment(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0xFE:
-        increment(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-
-    // INX
-    case 0xE8:
-        increment(m_reg.x);
-        break;
-
-    // INY
-    case 0xC8:
-        increment(m_reg.y);
-        break;
+    m_reg = reg;
+    m_negative = negative;
+    m_zero = zero;
+    m_cycles = cycles;
+    copyWritablePages(pages, m_checkBefore, true);
 
-    // DEC
-    case 0xC6:
-        decrement(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0xD6:
-        decrement(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0xCE:
-        decrement(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0xDE:
-        decrement(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-
-    // DEX
-    case 0xCA:
-        decrement(m_reg.x);
-        break;
-
-    // DEY
-    case 0x88:
-        decrement(m_reg.y);
-        break;
-
-    // JMP
-    case 0x20:
-        subJump();
-        break;
-    case 0x4C:
-        jump(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x6C:
-        jump(comp::ADDR_MODE_INDIRECT);
-        break;
-
-    // RTS
-    case 0x60:
-        returnSub();
-        break;
+    // Native loops can go around the block several times, so the
+    // interpreter follows PC rather than the block's instruction list.
+    for (unsigned int i = 0; i < m_jitState.instructions; i++)
+    {
+        execute<false>(decode(m_reg.pc));
+    }
 
-    // BIT
-    case 0x24:
-        bit(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x2C:
-        bit(comp::ADDR_MODE_ABSOLUTE);
-        break;
+    copyWritablePages(pages, m_checkReplayed, false);
 
-    // ORA
-    case 0x09:
-        ora(comp::ADDR_MODE_IMMEDIATE);
-        break;
-    case 0x05:
-        ora(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x15:
-        ora(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x0D:
-        ora(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x1D:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_X);
-        ora(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-    case 0x19:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_Y);
-        ora(comp::ADDR_MODE_ABSOLUTE_Y);
-        break;
-    case 0x01:
-        ora(comp::ADDR_MODE_INDIRECT_X);
-        break;
-    case 0x11:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_INDIRECT_Y);
-        ora(comp::ADDR_MODE_INDIRECT_Y);
-        break;
+    const bool memoryMatches = std::memcmp(m_checkReplayed.data(), m_checkAfter.data(), size) == 0;
 
-    // XOR
-    case 0x49:
-        xora(comp::ADDR_MODE_IMMEDIATE);
-        break;
-    case 0x45:
-        xora(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x55:
-        xora(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x4D:
-        xora(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x5D:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_X);
-        xora(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-    case 0x59:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_Y);
-        xora(comp::ADDR_MODE_ABSOLUTE_Y);
-        break;
-    case 0x41:
-        xora(comp::ADDR_MODE_INDIRECT_X);
-        break;
-    case 0x51:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_INDIRECT_Y);
-        xora(comp::ADDR_MODE_INDIRECT_Y);
-        break;
+    if (m_reg.pc == nativeReg.pc && m_reg.a == nativeReg.a && m_reg.x == nativeReg.x &&
+        m_reg.y == nativeReg.y && m_reg.sp == nativeReg.sp && generateFlags() == nativeFlags &&
+        m_cycles == nativeCycles && memoryMatches)
+    {
+        m_checkedRuns++;
+        return true;
+    }
 
-    // AND
-    case 0x29:
-        bitAnd(comp::ADDR_MODE_IMMEDIATE);
-        break;
-    case 0x25:
-        bitAnd(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x35:
-        bitAnd(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x2D:
-        bitAnd(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x3D:
-        bitAnd(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-    case 0x39:
-        bitAnd(comp::ADDR_MODE_ABSOLUTE_Y);
-        break;
-    case 0x21:
-        bitAnd(comp::ADDR_MODE_INDIRECT_X);
-        break;
-    case 0x31:
-        bitAnd(comp::ADDR_MODE_INDIRECT_Y);
-        break;
-
-    // TXA
-    case 0x8A:
-        m_reg.a = m_reg.x;
-        checkFlags(m_reg.a, comp::FLAG_NEGATIVE | comp::FLAG_ZERO);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "TXA", m_reg.a, comp::ADDR_MODE_IMMEDIATE);
-        break;
-
-    // TAX
-    case 0xAA:
-        m_reg.x = m_reg.a;
-        checkFlags(m_reg.x, comp::FLAG_NEGATIVE | comp::FLAG_ZERO);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "TAX", m_reg.x, comp::ADDR_MODE_IMMEDIATE);
-        break;
-
-    // TAY
-    case 0xA8:
-        m_reg.y = m_reg.a;
-        checkFlags(m_reg.y, comp::FLAG_NEGATIVE | comp::FLAG_ZERO);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "TAY", m_reg.y, comp::ADDR_MODE_IMPLIED);
-        break;
-
-    // TYA
-    case 0x98:
-        m_reg.a = m_reg.y;
-        checkFlags(m_reg.a, comp::FLAG_NEGATIVE | comp::FLAG_ZERO);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "TYA", m_reg.a, comp::ADDR_MODE_IMPLIED);
-        break;
+    std::stringstream msg;
+    msg << std::hex << std::uppercase << "JIT mismatch in block at $" << reg.pc
+        << " (interpreter/native): PC " << m_reg.pc << "/" << nativeReg.pc
+        << " A " << +m_reg.a << "/" << +nativeReg.a
+        << " X " << +m_reg.x << "/" << +nativeReg.x
+        << " Y " << +m_reg.y << "/" << +nativeReg.y
+        << " SP " << +m_reg.sp << "/" << +nativeReg.sp
+        << " P " << +generateFlags() << "/" << +nativeFlags
+        << std::dec << " CYC " << m_cycles << "/" << nativeCycles
+        << (memoryMatches ? "" : " memory differs");
+
+    m_logger->write(msg.str());
+    m_error = msg.str();
+    m_running = false;
+
+    return true;
+}
 
-    // LSR
-    case 0x4A:
-        shiftRight(comp::ADDR_MODE_ACCUMULATOR);
-        break;
-    case 0x46:
-        shiftRight(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x56:
-        shiftRight(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x4E:
-        shiftRight(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x5E:
-        shiftRight(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
+nemus::core::CPU::DecodedInstruction nemus::core::CPU::decode(uint16_t address)
+{
+    DecodedInstruction instruction;
 
-    // ROR
-    case 0x6A:
-        rotateRight(comp::ADDR_MODE_ACCUMULATOR);
-        break;
-    case 0x66:
-        rotateRight(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x76:
-        rotateRight(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x6E:
-        rotateRight(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x7E:
-        rotateRight(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
+    instruction.opcode = m_memory->readByte(address);
+    instruction.handler = s_dispatch.instruction[instruction.opcode];
+    instruction.size = m_opsize[instruction.opcode];
+    instruction.cycles = m_cyclesTable[instruction.opcode];
+    instruction.operand = 0;
 
-    // ASL
-    case 0x0A:
-        asl(comp::ADDR_MODE_ACCUMULATOR);
-        break;
-    case 0x06:
-        asl(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x16:
-        asl(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x0E:
-        asl(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x1E:
-        asl(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
+    if (instruction.size > 1)
+    {
+        instruction.operand = m_memory->readByte(address + 1);
+    }
 
-    // ROL
-    case 0x2A:
-        rotateLeft(comp::ADDR_MODE_ACCUMULATOR);
-        break;
-    case 0x26:
-        rotateLeft(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x36:
-        rotateLeft(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x2E:
-        rotateLeft(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x3E:
-        rotateLeft(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-
-    // PHA
-    case 0x48:
-        m_memory->push(m_reg.a, m_reg.sp);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "pha", m_reg.a, comp::ADDR_MODE_IMPLIED);
-        break;
-
-    // PLA
-    case 0x68:
-        m_reg.a = m_memory->pop(m_reg.sp);
-        checkFlags(m_reg.a, comp::FLAG_NEGATIVE | comp::FLAG_ZERO);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "pla", m_reg.a, comp::ADDR_MODE_IMPLIED);
-        break;
-
-    // PHP
-    case 0x08:
-        setFlags(comp::FLAG_PUSHED);
-        m_memory->push(generateFlags(), m_reg.sp);
-        unsetFlags(comp::FLAG_PUSHED);
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "php", generateFlags(), comp::ADDR_MODE_IMPLIED);
-        break;
-
-    // PLP
-    case 0x28:
-        setFlags(m_memory->pop(m_reg.sp));
-        m_flags.P = false;
-        m_reg.p = generateFlags() & ~0x30;
-        m_logger->writeInstruction(m_reg, "plp", generateFlags(), comp::ADDR_MODE_IMPLIED);
-        break;
+    if (instruction.size > 2)
+    {
+        instruction.operand |= m_memory->readByte(address + 2) << 8;
+    }
 
-    // ADC
-    case 0x69:
-        adc(comp::ADDR_MODE_IMMEDIATE);
-        break;
-    case 0x65:
-        adc(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x75:
-        adc(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x6D:
-        adc(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x7D:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_X);
-        adc(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-    case 0x79:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_Y);
-        adc(comp::ADDR_MODE_ABSOLUTE_Y);
-        break;
-    case 0x61:
-        adc(comp::ADDR_MODE_INDIRECT_X);
-        break;
-    case 0x71:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_INDIRECT_Y);
-        adc(comp::ADDR_MODE_INDIRECT_Y);
-        break;
+    return instruction;
+}
 
-    // SBC
-    case 0xE9:
-        subtract(comp::ADDR_MODE_IMMEDIATE);
-        break;
-    case 0xE5:
-        subtract(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0xF5:
-        subtract(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0xED:
-        subtract(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0xFD:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_X);
-        subtract(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-    case 0xF9:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_ABSOLUTE_Y);
-        subtract(comp::ADDR_MODE_ABSOLUTE_Y);
-        break;
-    case 0xE1:
-        subtract(comp::ADDR_MODE_INDIRECT_X);
-        break;
-    case 0xF1:
-        pageCycle = m_memory->checkPageCross(m_reg, comp::ADDR_MODE_INDIRECT_Y);
-        subtract(comp::ADDR_MODE_INDIRECT_Y);
-        break;
+void nemus::core::CPU::buildBlock(Block &block, const unsigned char *code, uint16_t address)
+{
+    block.code = code;
+    block.length = 0;
+    block.native = nullptr;
+    block.runs = 0;
 
-    // SLO
-    case 0x03:
-        m_logger->write("SOL Instruction");
-        asl(comp::ADDR_MODE_INDIRECT_X);
-        ora(comp::ADDR_MODE_INDIRECT_X);
-        break;
-    case 0x07:
-        m_logger->write("SOL Instruction");
-        asl(comp::ADDR_MODE_ZERO_PAGE);
-        ora(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x0F:
-        m_logger->write("SOL Instruction");
-        asl(comp::ADDR_MODE_ABSOLUTE);
-        ora(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x13:
-        m_logger->write("SOL Instruction");
-        asl(comp::ADDR_MODE_INDIRECT_Y);
-        ora(comp::ADDR_MODE_INDIRECT_Y);
-        break;
-    case 0x17:
-        asl(comp::ADDR_MODE_ZERO_PAGE_X);
-        ora(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x1B:
-        m_logger->write("SOL Instruction");
-        asl(comp::ADDR_MODE_ABSOLUTE_Y);
-        ora(comp::ADDR_MODE_ABSOLUTE_Y);
-        break;
-    case 0x1F:
-        m_logger->write("SOL Instruction");
-        asl(comp::ADDR_MODE_ABSOLUTE_X);
-        ora(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
+    // Blocks stay inside the page they start on, since neighbouring pages
+    // may belong to banks that switch independently.
+    const unsigned int end = CPU_PAGE_SIZE - address % CPU_PAGE_SIZE;
+    unsigned int offset = 0;
 
-    // RLA
-    case 0x23:
-        m_logger->write("RLA Instruction");
-        rotateLeft(comp::ADDR_MODE_INDIRECT_X);
-        bitAnd(comp::ADDR_MODE_INDIRECT_X);
-        break;
-    case 0x27:
-        m_logger->write("RLA Instruction");
-        rotateLeft(comp::ADDR_MODE_ZERO_PAGE);
-        bitAnd(comp::ADDR_MODE_ZERO_PAGE);
-        break;
-    case 0x2F:
-        m_logger->write("RLA Instruction");
-        rotateLeft(comp::ADDR_MODE_ABSOLUTE);
-        bitAnd(comp::ADDR_MODE_ABSOLUTE);
-        break;
-    case 0x33:
-        m_logger->write("RLA Instruction");
-        rotateLeft(comp::ADDR_MODE_INDIRECT_Y);
-        bitAnd(comp::ADDR_MODE_INDIRECT_Y);
-        break;
-    case 0x37:
-        m_logger->write("RLA Instruction");
-        rotateLeft(comp::ADDR_MODE_ZERO_PAGE_X);
-        bitAnd(comp::ADDR_MODE_ZERO_PAGE_X);
-        break;
-    case 0x3B:
-        m_logger->write("RLA Instruction");
-        rotateLeft(comp::ADDR_MODE_ABSOLUTE_Y);
-        bitAnd(comp::ADDR_MODE_ABSOLUTE_Y);
-        break;
-    case 0x3F:
-        m_logger->write("RLA Instruction");
-        rotateLeft(comp::ADDR_MODE_ABSOLUTE_X);
-        bitAnd(comp::ADDR_MODE_ABSOLUTE_X);
-        break;
-
-    // RTI
-    case 0x40:
-        setFlags(m_memory->pop(m_reg.sp) & ~0x30);
-        m_reg.pc = m_memory->pop16(m_reg.sp) - 1;
+    while (block.length < BLOCK_LENGTH)
+    {
+        const unsigned int op = code[offset];
+        const unsigned int size = m_opsize[op];
 
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "rti", m_reg.pc, comp::ADDR_MODE_IMPLIED);
-        break;
+        if (offset + std::max(size, 1U) > end)
+        {
+            break;
+        }
 
-    // BRK
-    case 0x00:
-        m_memory->push16(m_reg.pc + 2, m_reg.sp);
-        setFlags(comp::FLAG_PUSHED);
-        m_memory->push(generateFlags(), m_reg.sp);
-        unsetFlags(comp::FLAG_PUSHED);
-        m_reg.p = generateFlags();
+        DecodedInstruction &instruction = block.instructions[block.length++];
+        instruction.opcode = op;
+        instruction.handler = s_dispatch.instruction[op];
+        instruction.size = size;
+        instruction.cycles = m_cyclesTable[op];
+        instruction.operand = 0;
 
-        setFlags(comp::FLAG_INTERRUPT);
-        m_reg.pc = m_memory->readWord(0xFFFE) - 1;
-        break;
+        if (size > 1)
+        {
+            instruction.operand = code[offset + 1];
+        }
 
-    default:
-        m_logger->writeError(m_opcodes[op], m_reg.pc);
-        std::stringstream msg;
-        msg << "Unknown opcode $" << std::hex << op << ":" << m_opcodes[op] << " at $" << m_reg.pc;
-        QMessageBox *msg_box = new QMessageBox(QMessageBox::Critical, "Unimplemented Opcode", msg.str().c_str(), QMessageBox::StandardButton::Ok);
-        msg_box->exec();
-        m_running = false;
-        return 0;
+        if (size > 2)
+        {
+            instruction.operand |= code[offset + 2] << 8;
+        }
+
+        // Anything that can change PC other than by its size ends the block.
+        const bool branch = (op & 0x1F) == 0x10;
+        const bool jump = op == 0x00 || op == 0x20 || op == 0x40 || op == 0x4C || op == 0x60 || op == 0x6C;
+
+        if (branch || jump || instruction.handler == &invoke<&CPU::jam>)
+        {
+            break;
+        }
+
+        offset += size;
     }
+}
+
+template int nemus::core::CPU::step<false>();
+template int nemus::core::CPU::step<true>();
 
-    m_reg.pc += m_opsize[op];
+void nemus::core::CPU::traceInstruction(unsigned int op)
+{
+    debug::TraceRecord &record = m_trace->next();
+
+    record.cycle = static_cast<uint32_t>(m_cycles);
+    record.pc = m_reg.pc;
+    record.opcode = static_cast<uint8_t>(op);
+    record.operand[0] = m_opsize[op] > 1 ? m_memory->readByte(m_reg.pc + 1) : 0;
+    record.operand[1] = m_opsize[op] > 2 ? m_memory->readByte(m_reg.pc + 2) : 0;
+    record.a = m_reg.a;
+    record.x = m_reg.x;
+    record.y = m_reg.y;
+    record.sp = m_reg.sp;
+    record.p = generateFlags();
+}
+
+void nemus::core::CPU::saveState(StateWriter &state)
+{
+    state.write(m_reg);
+    state.write(m_negative);
+    state.write(m_zero);
+    state.write(m_interrupt);
+    state.write(m_irqLines);
+    state.write(m_cycles);
+    state.write(m_running);
+}
+
+void nemus::core::CPU::loadState(StateReader &state)
+{
+    state.read(m_reg);
+    state.read(m_negative);
+    state.read(m_zero);
+    state.read(m_interrupt);
+    state.read(m_irqLines);
+    state.read(m_cycles);
+    state.read(m_running);
+
+    m_error.clear();
+}
 
-    return m_cyclesTable[op] + pageCycle;
+bool nemus::core::CPU::isInterruptPending()
+{
+    return m_interrupt == comp::INT_NMI || (m_irqLines != 0 && !readFlag<comp::FLAG_INTERRUPT>());
 }
 
-void nemus::core::CPU::interrupt()
+int nemus::core::CPU::interrupt()
 {
-    switch (m_interrupt)
+    // A pending NMI wins over the IRQ line.
+    switch (m_interrupt == comp::INT_NONE ? comp::INT_IRQ : m_interrupt)
     {
     case comp::INT_NMI:
     {
         m_memory->push16(m_reg.pc, m_reg.sp);
         m_memory->push(generateFlags(), m_reg.sp);
 
-        unsigned int address = m_memory->readWord(0xFFFA);
-
-        m_reg.pc = address;
+        m_reg.pc = m_memory->readWord(0xFFFA);
 
         m_interrupt = comp::INT_NONE;
 
-        setFlags(comp::FLAG_INTERRUPT);
+        writeFlag<comp::FLAG_INTERRUPT>(true);
 
         m_logger->write("NMI has occurred!\n");
     }
@@ -845,11 +463,9 @@ void nemus::core::CPU::interrupt()
         m_memory->push16(m_reg.pc, m_reg.sp);
         m_memory->push(generateFlags(), m_reg.sp);
 
-        unsigned int address = m_memory->readWord(0xFFFE);
+        m_reg.pc = m_memory->readWord(0xFFFE);
 
-        m_reg.pc = address;
-
-        setFlags(comp::FLAG_INTERRUPT);
+        writeFlag<comp::FLAG_INTERRUPT>(true);
 
         m_interrupt = comp::INT_NONE;
         m_logger->write("IRQ has occured!\n");
@@ -857,10 +473,14 @@ void nemus::core::CPU::interrupt()
     break;
     case comp::INT_RESET:
         // TODO: Implement reset vector
-        break;
+        return 0;
     case comp::INT_NONE:
-        break;
+        return 0;
     }
+
+    m_cycles += INTERRUPT_CYCLES;
+
+    return INTERRUPT_CYCLES;
 }
 
 void nemus::core::CPU::generateOP()
@@ -906,7 +526,7 @@ void nemus::core::CPU::generateOP()
     int instructionSizes[256] = {
         1,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -922,7 +542,7 @@ void nemus::core::CPU::generateOP()
         3,
         2,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -938,7 +558,7 @@ void nemus::core::CPU::generateOP()
         3,
         3,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -954,7 +574,7 @@ void nemus::core::CPU::generateOP()
         3,
         2,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -970,7 +590,7 @@ void nemus::core::CPU::generateOP()
         3,
         1,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -986,7 +606,7 @@ void nemus::core::CPU::generateOP()
         3,
         2,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -1002,7 +622,7 @@ void nemus::core::CPU::generateOP()
         3,
         1,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -1018,7 +638,7 @@ void nemus::core::CPU::generateOP()
         3,
         2,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -1034,14 +654,14 @@ void nemus::core::CPU::generateOP()
         3,
         2,
         2,
-        0,
+        2,
         2,
         2,
         2,
         2,
         2,
         1,
-        0,
+        2,
         1,
         2,
         3,
@@ -1050,7 +670,7 @@ void nemus::core::CPU::generateOP()
         3,
         2,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -1060,9 +680,9 @@ void nemus::core::CPU::generateOP()
         3,
         1,
         3,
-        0,
         3,
-        0,
+        3,
+        3,
         3,
         2,
         2,
@@ -1082,7 +702,7 @@ void nemus::core::CPU::generateOP()
         3,
         2,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -1098,7 +718,7 @@ void nemus::core::CPU::generateOP()
         3,
         2,
         2,
-        0,
+        2,
         2,
         2,
         2,
@@ -1114,7 +734,7 @@ void nemus::core::CPU::generateOP()
         3,
         2,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -1130,7 +750,7 @@ void nemus::core::CPU::generateOP()
         3,
         2,
         2,
-        0,
+        2,
         2,
         2,
         2,
@@ -1146,7 +766,7 @@ void nemus::core::CPU::generateOP()
         3,
         2,
         2,
-        0,
+        1,
         2,
         2,
         2,
@@ -1434,7 +1054,6 @@ void nemus::core::CPU::generateOP()
 
 void nemus::core::CPU::resetRegisters()
 {
-    m_reg.p = 0x34;
     setFlags(0x34);
     m_reg.a = 0;
     m_reg.x = 0;
@@ -1442,455 +1061,1442 @@ void nemus::core::CPU::resetRegisters()
     m_reg.sp = 0xFD;
 }
 
-void nemus::core::CPU::adc(comp::AddressMode addr)
+template <nemus::comp::Flag flag>
+bool nemus::core::CPU::readFlag()
 {
-    unsigned int operand = m_memory->readByte(m_reg, addr);
-
-    unsigned int result = m_reg.a + operand + (int)(m_flags.C);
-
-    m_flags.V = ~(m_reg.a ^ operand) & (m_reg.a ^ result) & 0x80;
-
-    m_reg.a = result & 0xFF;
+    if constexpr (flag == comp::FLAG_NEGATIVE)
+        return m_negative & 0x80;
+    else if constexpr (flag == comp::FLAG_ZERO)
+        return m_zero == 0;
+    else
+        return m_reg.p & flag;
+}
 
-    m_flags.C = result > 0xFF;
+template <nemus::comp::Flag flag>
+void nemus::core::CPU::writeFlag(bool value)
+{
+    if constexpr (flag == comp::FLAG_NEGATIVE)
+        m_negative = value ? 0x80 : 0;
+    else if constexpr (flag == comp::FLAG_ZERO)
+        m_zero = !value;
+    else
+        m_reg.p = (m_reg.p & ~flag) | (value ? flag : 0);
+}
 
-    checkFlags(result & 0xFF, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
-    m_reg.p = generateFlags();
+template <nemus::comp::Flag flag>
+unsigned int nemus::core::CPU::setFlag()
+{
+    writeFlag<flag>(true);
 
-    m_logger->writeInstruction(m_reg, "adc", result, addr);
+    return 0;
 }
 
-void nemus::core::CPU::bitAnd(comp::AddressMode addr)
+template <nemus::comp::Flag flag>
+unsigned int nemus::core::CPU::clearFlag()
 {
-    unsigned int operand = m_memory->readByte(m_reg, addr);
+    writeFlag<flag>(false);
 
-    m_reg.a = (operand & m_reg.a) & 0xFF;
+    return 0;
+}
 
-    checkFlags(m_reg.a, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
-    m_reg.p = generateFlags();
+template <nemus::core::CPU::Register dest>
+void nemus::core::CPU::opLoad(uint8_t value)
+{
+    m_reg.*dest = value;
 
-    m_logger->writeInstruction(m_reg, "and", operand, addr);
+    setNZ(value);
 }
 
-void nemus::core::CPU::asl(comp::AddressMode addr)
+template <nemus::core::CPU::Register src>
+void nemus::core::CPU::opCompare(uint8_t value)
 {
-    if (addr == comp::ADDR_MODE_ACCUMULATOR)
-    {
-        m_flags.C = (bool)(m_reg.a & 0x80);
+    writeFlag<comp::FLAG_CARRY>(m_reg.*src >= value);
 
-        m_reg.a = (m_reg.a << 1) & 0xFF;
+    setNZ(m_reg.*src - value);
+}
 
-        checkFlags(m_reg.a, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
-    }
-    else
-    {
-        unsigned int operand = m_memory->readByte(m_reg, addr);
+void nemus::core::CPU::opOra(uint8_t value)
+{
+    m_reg.a |= value;
 
-        m_flags.C = (bool)(operand & 0x80);
+    setNZ(m_reg.a);
+}
 
-        operand = (operand << 1) & 0xFF;
+void nemus::core::CPU::opEor(uint8_t value)
+{
+    m_reg.a ^= value;
 
-        checkFlags(operand, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
+    setNZ(m_reg.a);
+}
 
-        m_memory->writeByte(m_reg, operand, addr);
-    }
+void nemus::core::CPU::opAnd(uint8_t value)
+{
+    m_reg.a &= value;
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "asl", 0, addr);
+    setNZ(m_reg.a);
 }
 
-void nemus::core::CPU::branch(bool doJump)
+void nemus::core::CPU::opBit(uint8_t value)
 {
-    auto b = static_cast<signed char>(m_memory->readByte(m_reg.pc + 1));
+    // N and V come from the operand, Z from the masked result.
+    m_negative = value;
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "branch", static_cast<int>(b) & 0xFF, comp::ADDR_MODE_IMMEDIATE);
+    writeFlag<comp::FLAG_OVERFLOW>(value & 0x40);
 
-    if (doJump)
-    {
-        m_reg.pc += b;
-    }
+    m_zero = m_reg.a & value;
 }
 
-void nemus::core::CPU::bit(comp::AddressMode addr)
+void nemus::core::CPU::opAdc(uint8_t value)
 {
-    unsigned int operand = m_memory->readByte(m_reg, addr);
+    const unsigned int result = m_reg.a + value + (m_reg.p & comp::FLAG_CARRY);
 
-    unsigned int result = (m_reg.a & 0xFF) & (operand & 0xFF);
+    writeFlag<comp::FLAG_OVERFLOW>(~(m_reg.a ^ value) & (m_reg.a ^ result) & 0x80);
 
-    m_flags.N = (bool)(operand & 0x80);
+    writeFlag<comp::FLAG_CARRY>(result > 0xFF);
 
-    m_flags.V = (bool)(operand & 0x40);
+    m_reg.a = result;
 
-    m_flags.Z = result == 0;
+    setNZ(m_reg.a);
+}
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "bit_test", operand, addr);
+void nemus::core::CPU::opSbc(uint8_t value)
+{
+    // Subtraction is addition of the one's complement; the carry supplies
+    // the missing 1 and stays set when no borrow happens.
+    opAdc(~value);
 }
 
-void nemus::core::CPU::compare(unsigned int &src, comp::AddressMode addr)
+uint8_t nemus::core::CPU::opAsl(uint8_t value)
 {
-    unsigned int operand = m_memory->readByte(m_reg, addr);
+    writeFlag<comp::FLAG_CARRY>(value & 0x80);
 
-    m_flags.C = src >= operand;
+    value <<= 1;
 
-    m_flags.Z = src - operand == 0;
-    m_flags.N = (bool)(((unsigned char)(src) - (unsigned char)(operand)) & 0x80);
+    setNZ(value);
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "compare", src, addr);
+    return value;
 }
 
-void nemus::core::CPU::decrement(comp::AddressMode addr)
+uint8_t nemus::core::CPU::opLsr(uint8_t value)
 {
-    auto operand = (unsigned char)(m_memory->readByte(m_reg, addr));
+    writeFlag<comp::FLAG_CARRY>(value & 0x01);
 
-    m_memory->writeByte(m_reg, (unsigned char)(operand - 1), addr);
+    value >>= 1;
 
-    checkFlags((unsigned char)(operand - 1), comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
+    setNZ(value);
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "decrement memory", operand, addr);
+    return value;
 }
 
-void nemus::core::CPU::decrement(unsigned int &src)
+uint8_t nemus::core::CPU::opRol(uint8_t value)
 {
-    src = (unsigned char)((src)-1);
-    src &= 0xFF;
+    const uint8_t carry = m_reg.p & comp::FLAG_CARRY;
+
+    writeFlag<comp::FLAG_CARRY>(value & 0x80);
 
-    checkFlags(src, comp::FLAG_NEGATIVE | comp::FLAG_ZERO);
+    value = (value << 1) | carry;
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "decrement reg", src, comp::ADDR_MODE_IMMEDIATE);
+    setNZ(value);
+
+    return value;
 }
 
-void nemus::core::CPU::xora(comp::AddressMode addr)
+uint8_t nemus::core::CPU::opRor(uint8_t value)
 {
-    unsigned int operand = m_memory->readByte(m_reg, addr);
+    const uint8_t carry = (m_reg.p & comp::FLAG_CARRY) << 7;
+
+    writeFlag<comp::FLAG_CARRY>(value & 0x01);
 
-    m_reg.a = (operand & 0xFF) ^ (m_reg.a & 0xFF);
+    value = (value >> 1) | carry;
 
-    checkFlags(m_reg.a, comp::FLAG_NEGATIVE | comp::FLAG_ZERO);
+    setNZ(value);
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "xor", operand, addr);
+    return value;
 }
 
-void nemus::core::CPU::increment(comp::AddressMode addr)
+uint8_t nemus::core::CPU::opInc(uint8_t value)
 {
-    unsigned char operand = m_memory->readByte(m_reg, addr);
+    setNZ(++value);
 
-    m_memory->writeByte(m_reg, (unsigned char)(operand + 1), addr);
+    return value;
+}
 
-    checkFlags((unsigned char)(operand + 1), comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
+uint8_t nemus::core::CPU::opDec(uint8_t value)
+{
+    setNZ(--value);
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "increment memory", 0, addr);
+    return value;
 }
 
-void nemus::core::CPU::increment(unsigned int &src)
+uint8_t nemus::core::CPU::opSlo(uint8_t value)
 {
-    src = static_cast<unsigned char>(src) + 1;
-    src &= 0xFF;
+    value = opAsl(value);
+    opOra(value);
 
-    checkFlags(src, comp::FLAG_NEGATIVE | comp::FLAG_ZERO);
+    return value;
+}
+
+uint8_t nemus::core::CPU::opRla(uint8_t value)
+{
+    value = opRol(value);
+    opAnd(value);
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "increment reg", 0, comp::ADDR_MODE_IMMEDIATE);
+    return value;
 }
 
-void nemus::core::CPU::subJump()
+uint8_t nemus::core::CPU::opSre(uint8_t value)
 {
-    m_memory->push16(m_reg.pc + 2, m_reg.sp);
+    value = opLsr(value);
+    opEor(value);
 
-    unsigned int address = m_memory->readWord(m_reg.pc + 1) - 3;
+    return value;
+}
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "jump_sub", address + 3, comp::ADDR_MODE_ABSOLUTE);
+uint8_t nemus::core::CPU::opRra(uint8_t value)
+{
+    value = opRor(value);
+    opAdc(value);
 
-    m_reg.pc = address;
+    return value;
 }
 
-void nemus::core::CPU::jump(comp::AddressMode addr)
+uint8_t nemus::core::CPU::opDcp(uint8_t value)
 {
-    unsigned int address = 0;
+    value = opDec(value);
+    opCompare<&comp::Registers::a>(value);
 
-    if (addr == comp::ADDR_MODE_ABSOLUTE)
-    {
-        address = m_memory->readWord(m_reg.pc + 1);
-    }
-    else
-    {
-        unsigned int indirect_address = m_memory->readWord(m_reg.pc + 1);
-        address = m_memory->readWordBug(indirect_address);
-    }
+    return value;
+}
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "jump", address, comp::ADDR_MODE_ABSOLUTE);
+uint8_t nemus::core::CPU::opIsc(uint8_t value)
+{
+    value = opInc(value);
+    opSbc(value);
 
-    m_reg.pc = address - 3;
+    return value;
 }
 
-void nemus::core::CPU::shiftRight(comp::AddressMode addr)
+void nemus::core::CPU::opLax(uint8_t value)
 {
-    if (addr == comp::ADDR_MODE_ACCUMULATOR)
-    {
-        m_flags.C = (bool)(m_reg.a & 0x01);
-        m_reg.a = (m_reg.a & 0xFF) >> 1;
-        checkFlags(m_reg.a, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
+    m_reg.a = m_reg.x = value;
 
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "lsr", m_reg.a, addr);
-    }
-    else
-    {
-        unsigned int operand = m_memory->readByte(m_reg, addr);
+    setNZ(value);
+}
 
-        m_flags.C = (bool)(operand & 0x01);
+void nemus::core::CPU::opLas(uint8_t value)
+{
+    m_reg.a = m_reg.x = m_reg.sp = value & m_reg.sp;
 
-        operand = (operand & 0xFF) >> 1;
-        checkFlags(operand, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
+    setNZ(m_reg.a);
+}
 
-        m_memory->writeByte(m_reg, operand, addr);
+void nemus::core::CPU::opAnc(uint8_t value)
+{
+    opAnd(value);
 
-        m_reg.p = generateFlags();
-        m_logger->writeInstruction(m_reg, "lsr", operand, addr);
-    }
+    writeFlag<comp::FLAG_CARRY>(m_reg.a & 0x80);
 }
 
-void nemus::core::CPU::load(unsigned int &dest, comp::AddressMode addr)
+void nemus::core::CPU::opAlr(uint8_t value)
 {
-    dest = m_memory->readByte(m_reg, addr);
+    m_reg.a = opLsr(m_reg.a & value);
+}
 
-    checkFlags(dest, comp::FLAG_NEGATIVE | comp::FLAG_ZERO);
+void nemus::core::CPU::opArr(uint8_t value)
+{
+    // AND followed by ROR A, but C and V come from bits 6 and 5 of the
+    // result instead of the shift.
+    m_reg.a = ((m_reg.a & value) >> 1) | ((m_reg.p & comp::FLAG_CARRY) << 7);
 
-    m_reg.p = generateFlags();
+    setNZ(m_reg.a);
 
-    m_logger->writeInstruction(m_reg, "load", dest, addr);
+    writeFlag<comp::FLAG_CARRY>(m_reg.a & 0x40);
+    writeFlag<comp::FLAG_OVERFLOW>((m_reg.a ^ (m_reg.a << 1)) & 0x40);
 }
 
-void nemus::core::CPU::ora(comp::AddressMode addr)
+void nemus::core::CPU::opAxs(uint8_t value)
 {
-    unsigned int operand = m_memory->readByte(m_reg, addr);
+    // Compare-style subtraction: no borrow in, C set when nothing borrowed.
+    const unsigned int result = (m_reg.a & m_reg.x) - value;
 
-    m_reg.a = (operand & 0xFF) | (m_reg.a & 0xFF);
+    writeFlag<comp::FLAG_CARRY>(result < 0x100);
 
-    checkFlags(m_reg.a, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
+    m_reg.x = result;
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "ora", operand, addr);
+    setNZ(m_reg.x);
 }
 
-void nemus::core::CPU::store(unsigned int &src, comp::AddressMode addr)
+void nemus::core::CPU::opXaa(uint8_t value)
 {
-    m_memory->writeByte(m_reg, src, addr);
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "store", src, addr);
+    m_reg.a = (m_reg.a | UNSTABLE_MAGIC) & m_reg.x & value;
+
+    setNZ(m_reg.a);
 }
 
-void nemus::core::CPU::returnSub()
+void nemus::core::CPU::opLxa(uint8_t value)
 {
-    unsigned int address = m_memory->pop16(m_reg.sp);
+    m_reg.a = m_reg.x = (m_reg.a | UNSTABLE_MAGIC) & value;
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "return_sub", address, comp::ADDR_MODE_IMMEDIATE);
-
-    m_reg.pc = address;
+    setNZ(m_reg.a);
 }
 
-void nemus::core::CPU::rotateRight(comp::AddressMode addr)
+uint8_t nemus::core::CPU::opSax(uint16_t &, bool)
 {
-    bool carry = m_flags.C;
+    return m_reg.a & m_reg.x;
+}
 
-    if (addr == comp::ADDR_MODE_ACCUMULATOR)
-    {
-        m_flags.C = (bool)(m_reg.a & 0x01);
-        m_reg.a = (m_reg.a & 0xFF) >> 1;
-        m_reg.a += (carry * 0x80);
+uint8_t nemus::core::CPU::opShy(uint16_t &address, bool pageCross)
+{
+    return storeHigh(m_reg.y, address, pageCross);
+}
 
-        checkFlags(m_reg.a, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
-    }
-    else
-    {
-        unsigned int operand = m_memory->readByte(m_reg, addr);
+uint8_t nemus::core::CPU::opShx(uint16_t &address, bool pageCross)
+{
+    return storeHigh(m_reg.x, address, pageCross);
+}
 
-        m_flags.C = (bool)(operand & 0x01);
+uint8_t nemus::core::CPU::opAhx(uint16_t &address, bool pageCross)
+{
+    return storeHigh(m_reg.a & m_reg.x, address, pageCross);
+}
 
-        operand = (operand & 0xFF) >> 1;
+uint8_t nemus::core::CPU::opTas(uint16_t &address, bool pageCross)
+{
+    m_reg.sp = m_reg.a & m_reg.x;
 
-        operand += (carry * 0x80);
+    return storeHigh(m_reg.sp, address, pageCross);
+}
 
-        m_memory->writeByte(m_reg, operand, addr);
+uint8_t nemus::core::CPU::storeHigh(uint8_t value, uint16_t &address, bool pageCross)
+{
+    // The value is ANDed with the high byte of the unindexed address plus
+    // one. When indexing carries into the high byte, the write goes to the
+    // page given by the stored value instead.
+    value &= (address >> 8) + !pageCross;
 
-        checkFlags(operand, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
+    if (pageCross)
+    {
+        address = (address & 0xFF) | value << 8;
     }
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "ror", 0, addr);
+    return value;
 }
 
-void nemus::core::CPU::rotateLeft(comp::AddressMode addr)
+template <void (nemus::core::CPU::*Op)(uint8_t), nemus::comp::AddressMode addr>
+unsigned int nemus::core::CPU::read()
 {
-    bool carry = m_flags.C;
+    const Operand operand = m_memory->fetch<addr>(m_reg, m_operand);
 
-    if (addr == comp::ADDR_MODE_ACCUMULATOR)
-    {
-        m_flags.C = (bool)(m_reg.a & 0x80);
-        m_reg.a = (m_reg.a << 1) & 0xFF;
-        m_reg.a += carry;
+    (this->*Op)(operand.value);
+
+    return operand.pageCycle;
+}
 
-        checkFlags(m_reg.a, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
+template <uint8_t (nemus::core::CPU::*Op)(uint8_t), nemus::comp::AddressMode addr>
+unsigned int nemus::core::CPU::modify()
+{
+    if constexpr (addr == comp::ADDR_MODE_ACCUMULATOR)
+    {
+        m_reg.a = (this->*Op)(m_reg.a);
     }
     else
     {
-        unsigned int operand = m_memory->readByte(m_reg, addr);
-
-        m_flags.C = (bool)(operand & 0x80);
+        const Operand operand = m_memory->fetch<addr>(m_reg, m_operand);
 
-        operand = (operand << 1) & 0xFF;
-
-        operand += carry;
-
-        m_memory->writeByte(m_reg, operand, addr);
-
-        checkFlags(operand, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
+        m_memory->writeByte((this->*Op)(operand.value), operand.address);
     }
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "rol", 0, addr);
+    return 0;
 }
 
-void nemus::core::CPU::subtract(comp::AddressMode addr)
+template <nemus::core::CPU::Register src, nemus::comp::AddressMode addr>
+unsigned int nemus::core::CPU::store()
 {
-    unsigned int operand = m_memory->readByte(m_reg, addr) ^ 0xFF;
-
-    unsigned int result = m_reg.a + operand + m_flags.C;
+    m_memory->writeByte(m_reg.*src, m_memory->resolve<addr>(m_reg, m_operand).address);
 
-    m_flags.V = ~(m_reg.a ^ operand) & (m_reg.a ^ (result & 0xFF)) & 0x80;
-
-    m_flags.C = result & 0xFF00;
+    return 0;
+}
 
-    checkFlags(result & 0xFF, comp::FLAG_ZERO | comp::FLAG_NEGATIVE);
+template <uint8_t (nemus::core::CPU::*Op)(uint16_t &, bool), nemus::comp::AddressMode addr>
+unsigned int nemus::core::CPU::storeOp()
+{
+    const Operand operand = m_memory->resolve<addr>(m_reg, m_operand);
+    uint16_t address = operand.address;
 
-    m_reg.a = result & 0xFF;
+    const uint8_t value = (this->*Op)(address, operand.pageCycle);
+    m_memory->writeByte(value, address);
 
-    m_reg.p = generateFlags();
-    m_logger->writeInstruction(m_reg, "sbc", operand, addr);
+    return 0;
 }
 
-void nemus::core::CPU::setFlags(unsigned int flagbits)
+template <nemus::comp::Flag flag, bool condition>
+unsigned int nemus::core::CPU::branch()
 {
-    m_flags.C = (flagbits & 0x01) != 0;
-    m_flags.Z = (flagbits & 0x02) != 0;
-    m_flags.I = (flagbits & 0x04) != 0;
-    m_flags.D = (flagbits & 0x08) != 0;
-    m_flags.P = (flagbits & 0x10) != 0;
-    m_flags.V = (flagbits & 0x40) != 0;
-    m_flags.N = (flagbits & 0x80) != 0;
-}
+    if (readFlag<flag>() != condition)
+    {
+        return 0;
+    }
+
+    auto b = static_cast<int8_t>(m_operand);
+
+    // Taken branches cost one cycle, plus one more when the target is on another page.
+    const uint16_t next = m_reg.pc + 2;
+    m_reg.pc += b;
+
+    return 1 + ((static_cast<uint16_t>(m_reg.pc + 2) ^ next) >> 8 != 0);
+}
+
+template <nemus::core::CPU::Register src, nemus::core::CPU::Register dest>
+unsigned int nemus::core::CPU::transfer()
+{
+    m_reg.*dest = m_reg.*src;
+    setNZ(m_reg.*dest);
+
+    return 0;
+}
 
-void nemus::core::CPU::setFlags(comp::Flag flag)
+template <nemus::core::CPU::Register src>
+unsigned int nemus::core::CPU::decrementRegister()
 {
-    switch (flag)
+    m_reg.*src -= 1;
+
+    setNZ(m_reg.*src);
+
+    return 0;
+}
+
+template <nemus::core::CPU::Register src>
+unsigned int nemus::core::CPU::incrementRegister()
+{
+    m_reg.*src += 1;
+
+    setNZ(m_reg.*src);
+
+    return 0;
+}
+
+template <nemus::comp::AddressMode addr>
+unsigned int nemus::core::CPU::jump()
+{
+    uint16_t address = m_operand;
+
+    if constexpr (addr == comp::ADDR_MODE_INDIRECT)
     {
-    case comp::FLAG_CARRY:
-        m_flags.C = true;
-        break;
-    case comp::FLAG_ZERO:
-        m_flags.Z = true;
-        break;
-    case comp::FLAG_INTERRUPT:
-        m_flags.I = true;
-        break;
-    case comp::FLAG_PUSHED:
-        m_flags.P = true;
-        break;
-    case comp::FLAG_DECIMAL:
-        m_flags.D = true;
-        break;
-    case comp::FLAG_OVERFLOW:
-        m_flags.V = true;
-        break;
-    case comp::FLAG_NEGATIVE:
-        m_flags.N = true;
-        break;
+        address = m_memory->readWordBug(address);
     }
+
+    m_reg.pc = address - 3;
+
+    return 0;
+}
+
+unsigned int nemus::core::CPU::nop()
+{
+    return 0;
 }
 
-void nemus::core::CPU::unsetFlags(comp::Flag flag)
+unsigned int nemus::core::CPU::txs()
 {
-    switch (flag)
+    m_reg.sp = m_reg.x;
+
+    return 0;
+}
+
+unsigned int nemus::core::CPU::subJump()
+{
+    m_memory->push16(m_reg.pc + 2, m_reg.sp);
+
+    m_reg.pc = m_operand - 3;
+
+    return 0;
+}
+
+unsigned int nemus::core::CPU::returnSub()
+{
+    m_reg.pc = m_memory->pop16(m_reg.sp);
+
+    return 0;
+}
+
+unsigned int nemus::core::CPU::returnInterrupt()
+{
+    setFlags(m_memory->pop(m_reg.sp) & ~0x30);
+    m_reg.pc = m_memory->pop16(m_reg.sp) - 1;
+
+    return 0;
+}
+
+unsigned int nemus::core::CPU::pha()
+{
+    m_memory->push(m_reg.a, m_reg.sp);
+
+    return 0;
+}
+
+unsigned int nemus::core::CPU::pla()
+{
+    m_reg.a = m_memory->pop(m_reg.sp);
+    setNZ(m_reg.a);
+
+    return 0;
+}
+
+unsigned int nemus::core::CPU::php()
+{
+    m_memory->push(generateFlags() | comp::FLAG_PUSHED, m_reg.sp);
+    writeFlag<comp::FLAG_PUSHED>(false);
+
+    return 0;
+}
+
+unsigned int nemus::core::CPU::plp()
+{
+    setFlags(m_memory->pop(m_reg.sp));
+    writeFlag<comp::FLAG_PUSHED>(false);
+
+    return 0;
+}
+
+unsigned int nemus::core::CPU::brk()
+{
+    m_memory->push16(m_reg.pc + 2, m_reg.sp);
+    m_memory->push(generateFlags() | comp::FLAG_PUSHED, m_reg.sp);
+    writeFlag<comp::FLAG_PUSHED>(false);
+
+    writeFlag<comp::FLAG_INTERRUPT>(true);
+    m_reg.pc = m_memory->readWord(0xFFFE) - 1;
+
+    return 0;
+}
+
+unsigned int nemus::core::CPU::jam()
+{
+    // KIL stops the 6502 fetching instructions until it is reset.
+    const unsigned int op = m_memory->readByte(m_reg.pc);
+
+    m_logger->writeError(m_opcodes[op], m_reg.pc);
+    std::stringstream msg;
+    msg << "CPU jammed by opcode $" << std::hex << op << ":" << m_opcodes[op] << " at $" << m_reg.pc;
+    m_error = msg.str();
+    m_running = false;
+
+    return 0;
+}
+
+// The cycle engine follows the 6502's bus activity cycle by cycle, dummy
+// reads included. Cycle 0 of every instruction is the opcode fetch done in
+// cycle(), so handlers start at m_microStep 1 with PC past the opcode.
+
+namespace
+{
+    // Cycles spent forming the effective address.
+    template <nemus::comp::AddressMode addr>
+    constexpr unsigned int addressCycles()
     {
-    case comp::FLAG_CARRY:
-        m_flags.C = false;
-        break;
-    case comp::FLAG_ZERO:
-        m_flags.Z = false;
-        break;
-    case comp::FLAG_INTERRUPT:
-        m_flags.I = false;
-        break;
-    case comp::FLAG_PUSHED:
-        m_flags.P = false;
-        break;
-    case comp::FLAG_DECIMAL:
-        m_flags.D = false;
-        break;
-    case comp::FLAG_OVERFLOW:
-        m_flags.V = false;
-        break;
-    case comp::FLAG_NEGATIVE:
-        m_flags.N = false;
-        break;
+        switch (addr)
+        {
+        case nemus::comp::ADDR_MODE_ZERO_PAGE:
+            return 1;
+        case nemus::comp::ADDR_MODE_INDIRECT_Y:
+            return 3;
+        case nemus::comp::ADDR_MODE_INDIRECT_X:
+            return 4;
+        default:
+            return 2;
+        }
+    }
+
+    // Indexed modes spend one more cycle reading the address before the
+    // carry from the low byte reaches the high byte. Reads that stay on
+    // the page take their operand from that read.
+    template <nemus::comp::AddressMode addr>
+    constexpr bool isIndexed()
+    {
+        return addr == nemus::comp::ADDR_MODE_ABSOLUTE_X || addr == nemus::comp::ADDR_MODE_ABSOLUTE_Y ||
+               addr == nemus::comp::ADDR_MODE_INDIRECT_Y;
     }
 }
 
-void nemus::core::CPU::checkFlags(unsigned int operand, int flagbits)
+template <bool Trace>
+void nemus::core::CPU::cycle()
 {
-    if (flagbits & comp::FLAG_NEGATIVE)
+    if (m_microStep == 0)
     {
-        if (operand > 0x7F)
+        if (isInterruptPending())
         {
-            setFlags(comp::FLAG_NEGATIVE);
+            // The opcode fetch still happens but PC is not incremented.
+            m_memory->readByte(m_reg.pc);
+
+            m_address = m_interrupt == comp::INT_NMI ? 0xFFFA : 0xFFFE;
+            m_interrupt = comp::INT_NONE;
+            m_microOp = &invoke<&CPU::microInterrupt>;
         }
         else
         {
-            unsetFlags(comp::FLAG_NEGATIVE);
+            const unsigned int op = m_memory->readByte(m_reg.pc);
+
+            if constexpr (Trace)
+            {
+                traceInstruction(op);
+            }
+
+            m_reg.pc++;
+            m_microOp = s_dispatch.micro[op];
         }
+
+        m_microStep = 1;
+    }
+    else if (m_microOp(*this))
+    {
+        m_microStep = 0;
     }
+    else
+    {
+        m_microStep++;
+    }
+
+    m_cycles++;
+}
+
+template void nemus::core::CPU::cycle<false>();
+template void nemus::core::CPU::cycle<true>();
 
-    if (flagbits & comp::FLAG_ZERO)
+template <nemus::comp::AddressMode addr>
+void nemus::core::CPU::microAddress()
+{
+    constexpr bool indexX = addr == comp::ADDR_MODE_ZERO_PAGE_X || addr == comp::ADDR_MODE_ABSOLUTE_X;
+    const uint8_t index = indexX ? m_reg.x : m_reg.y;
+
+    if constexpr (addr == comp::ADDR_MODE_ZERO_PAGE || addr == comp::ADDR_MODE_ABSOLUTE)
+    {
+        if (m_microStep == 1)
+        {
+            m_address = m_memory->readByte(m_reg.pc++);
+        }
+        else
+        {
+            m_address |= m_memory->readByte(m_reg.pc++) << 8;
+        }
+    }
+    else if constexpr (addr == comp::ADDR_MODE_ZERO_PAGE_X || addr == comp::ADDR_MODE_ZERO_PAGE_Y)
+    {
+        if (m_microStep == 1)
+        {
+            m_address = m_memory->readByte(m_reg.pc++);
+        }
+        else
+        {
+            m_memory->readByte(m_address);
+            m_address = static_cast<uint8_t>(m_address + index);
+        }
+    }
+    else if constexpr (addr == comp::ADDR_MODE_ABSOLUTE_X || addr == comp::ADDR_MODE_ABSOLUTE_Y)
     {
-        if (operand == 0)
+        if (m_microStep == 1)
         {
-            setFlags(comp::FLAG_ZERO);
+            m_address = m_memory->readByte(m_reg.pc++);
         }
         else
         {
-            unsetFlags(comp::FLAG_ZERO);
+            m_pageCross = m_address + index > 0xFF;
+            m_address = (m_address | m_memory->readByte(m_reg.pc++) << 8) + index;
+        }
+    }
+    else if constexpr (addr == comp::ADDR_MODE_INDIRECT_X)
+    {
+        switch (m_microStep)
+        {
+        case 1:
+            m_pointer = m_memory->readByte(m_reg.pc++);
+            break;
+        case 2:
+            m_memory->readByte(m_pointer);
+            m_pointer += m_reg.x;
+            break;
+        case 3:
+            m_address = m_memory->readByte(m_pointer);
+            break;
+        default:
+            m_address |= m_memory->readByte(static_cast<uint8_t>(m_pointer + 1)) << 8;
+            break;
+        }
+    }
+    else
+    {
+        static_assert(addr == comp::ADDR_MODE_INDIRECT_Y, "Address mode does not reference memory");
+
+        switch (m_microStep)
+        {
+        case 1:
+            m_pointer = m_memory->readByte(m_reg.pc++);
+            break;
+        case 2:
+            m_address = m_memory->readByte(m_pointer);
+            break;
+        default:
+            m_pageCross = m_address + m_reg.y > 0xFF;
+            m_address = (m_address | m_memory->readByte(static_cast<uint8_t>(m_pointer + 1)) << 8) + m_reg.y;
+            break;
+        }
+    }
+}
+
+template <void (nemus::core::CPU::*Op)(uint8_t), nemus::comp::AddressMode addr>
+bool nemus::core::CPU::microRead()
+{
+    if constexpr (addr == comp::ADDR_MODE_IMMEDIATE)
+    {
+        (this->*Op)(m_memory->readByte(m_reg.pc++));
+        return true;
+    }
+    else
+    {
+        if (m_microStep <= addressCycles<addr>())
+        {
+            microAddress<addr>();
+            return false;
+        }
+
+        if constexpr (isIndexed<addr>())
+        {
+            if (m_microStep == addressCycles<addr>() + 1)
+            {
+                const uint8_t value = m_memory->readByte(m_pageCross ? m_address - 0x100 : m_address);
+
+                if (m_pageCross)
+                {
+                    return false;
+                }
+
+                (this->*Op)(value);
+                return true;
+            }
+        }
+
+        (this->*Op)(m_memory->readByte(m_address));
+        return true;
+    }
+}
+
+template <uint8_t (nemus::core::CPU::*Op)(uint8_t), nemus::comp::AddressMode addr>
+bool nemus::core::CPU::microModify()
+{
+    if constexpr (addr == comp::ADDR_MODE_ACCUMULATOR)
+    {
+        m_memory->readByte(m_reg.pc);
+        m_reg.a = (this->*Op)(m_reg.a);
+        return true;
+    }
+    else
+    {
+        if (m_microStep <= addressCycles<addr>())
+        {
+            microAddress<addr>();
+            return false;
+        }
+
+        unsigned int access = m_microStep - addressCycles<addr>();
+
+        if constexpr (isIndexed<addr>())
+        {
+            if (access == 1)
+            {
+                m_memory->readByte(m_pageCross ? m_address - 0x100 : m_address);
+                return false;
+            }
+
+            access--;
+        }
+
+        // Read, write the old value back while modifying it, write the result.
+        switch (access)
+        {
+        case 1:
+            m_data = m_memory->readByte(m_address);
+            return false;
+        case 2:
+            m_memory->writeByte(m_data, m_address);
+            m_data = (this->*Op)(m_data);
+            return false;
+        default:
+            m_memory->writeByte(m_data, m_address);
+            return true;
+        }
+    }
+}
+
+template <nemus::core::CPU::Register src, nemus::comp::AddressMode addr>
+bool nemus::core::CPU::microStore()
+{
+    if (m_microStep <= addressCycles<addr>())
+    {
+        microAddress<addr>();
+        return false;
+    }
+
+    if constexpr (isIndexed<addr>())
+    {
+        if (m_microStep == addressCycles<addr>() + 1)
+        {
+            m_memory->readByte(m_pageCross ? m_address - 0x100 : m_address);
+            return false;
         }
     }
+
+    m_memory->writeByte(m_reg.*src, m_address);
+    return true;
+}
+
+template <uint8_t (nemus::core::CPU::*Op)(uint16_t &, bool), nemus::comp::AddressMode addr>
+bool nemus::core::CPU::microStoreOp()
+{
+    if (m_microStep <= addressCycles<addr>())
+    {
+        microAddress<addr>();
+        return false;
+    }
+
+    if constexpr (isIndexed<addr>())
+    {
+        if (m_microStep == addressCycles<addr>() + 1)
+        {
+            m_memory->readByte(m_pageCross ? m_address - 0x100 : m_address);
+            return false;
+        }
+    }
+
+    uint16_t address = m_address;
+    const uint8_t value = (this->*Op)(address, isIndexed<addr>() && m_pageCross);
+    m_memory->writeByte(value, address);
+
+    return true;
+}
+
+template <unsigned int (nemus::core::CPU::*Op)()>
+bool nemus::core::CPU::microImplied()
+{
+    m_memory->readByte(m_reg.pc);
+    (this->*Op)();
+
+    return true;
+}
+
+template <nemus::comp::Flag flag, bool condition>
+bool nemus::core::CPU::microBranch()
+{
+    switch (m_microStep)
+    {
+    case 1:
+        m_data = m_memory->readByte(m_reg.pc++);
+        return readFlag<flag>() != condition;
+    case 2:
+    {
+        m_memory->readByte(m_reg.pc);
+
+        // The offset is added to PCL first; crossing a page costs a cycle
+        // to fix PCH.
+        m_address = m_reg.pc + static_cast<int8_t>(m_data);
+        m_pageCross = (m_address ^ m_reg.pc) & 0xFF00;
+        m_reg.pc = (m_reg.pc & 0xFF00) | (m_address & 0xFF);
+
+        return !m_pageCross;
+    }
+    default:
+        m_memory->readByte(m_reg.pc);
+        m_reg.pc = m_address;
+        return true;
+    }
+}
+
+template <nemus::comp::AddressMode addr>
+bool nemus::core::CPU::microJump()
+{
+    switch (m_microStep)
+    {
+    case 1:
+        m_address = m_memory->readByte(m_reg.pc++);
+        return false;
+    case 2:
+        if constexpr (addr == comp::ADDR_MODE_ABSOLUTE)
+        {
+            m_reg.pc = m_address | m_memory->readByte(m_reg.pc) << 8;
+            return true;
+        }
+
+        m_address |= m_memory->readByte(m_reg.pc++) << 8;
+        return false;
+    case 3:
+        m_data = m_memory->readByte(m_address);
+        return false;
+    default:
+        // The pointer's high byte is read without carrying into its page.
+        m_reg.pc = m_data | m_memory->readByte((m_address & 0xFF00) | static_cast<uint8_t>(m_address + 1)) << 8;
+        return true;
+    }
+}
+
+bool nemus::core::CPU::microSubJump()
+{
+    switch (m_microStep)
+    {
+    case 1:
+        m_data = m_memory->readByte(m_reg.pc++);
+        return false;
+    case 2:
+        m_memory->readByte(0x100 | m_reg.sp);
+        return false;
+    case 3:
+        m_memory->push(m_reg.pc >> 8, m_reg.sp);
+        return false;
+    case 4:
+        m_memory->push(m_reg.pc & 0xFF, m_reg.sp);
+        return false;
+    default:
+        m_reg.pc = m_data | m_memory->readByte(m_reg.pc) << 8;
+        return true;
+    }
+}
+
+bool nemus::core::CPU::microReturnSub()
+{
+    switch (m_microStep)
+    {
+    case 1:
+        m_memory->readByte(m_reg.pc);
+        return false;
+    case 2:
+        m_memory->readByte(0x100 | m_reg.sp);
+        return false;
+    case 3:
+        m_data = m_memory->pop(m_reg.sp);
+        return false;
+    case 4:
+        m_reg.pc = m_data | m_memory->pop(m_reg.sp) << 8;
+        return false;
+    default:
+        m_memory->readByte(m_reg.pc++);
+        return true;
+    }
+}
+
+bool nemus::core::CPU::microReturnInterrupt()
+{
+    switch (m_microStep)
+    {
+    case 1:
+        m_memory->readByte(m_reg.pc);
+        return false;
+    case 2:
+        m_memory->readByte(0x100 | m_reg.sp);
+        return false;
+    case 3:
+        setFlags(m_memory->pop(m_reg.sp) & ~0x30);
+        return false;
+    case 4:
+        m_data = m_memory->pop(m_reg.sp);
+        return false;
+    default:
+        m_reg.pc = m_data | m_memory->pop(m_reg.sp) << 8;
+        return true;
+    }
+}
+
+template <unsigned int (nemus::core::CPU::*Op)()>
+bool nemus::core::CPU::microPush()
+{
+    if (m_microStep == 1)
+    {
+        m_memory->readByte(m_reg.pc);
+        return false;
+    }
+
+    (this->*Op)();
+    return true;
+}
+
+template <unsigned int (nemus::core::CPU::*Op)()>
+bool nemus::core::CPU::microPull()
+{
+    switch (m_microStep)
+    {
+    case 1:
+        m_memory->readByte(m_reg.pc);
+        return false;
+    case 2:
+        m_memory->readByte(0x100 | m_reg.sp);
+        return false;
+    default:
+        (this->*Op)();
+        return true;
+    }
+}
+
+bool nemus::core::CPU::microBrk()
+{
+    switch (m_microStep)
+    {
+    case 1:
+        m_memory->readByte(m_reg.pc++);
+        return false;
+    case 2:
+        m_memory->push(m_reg.pc >> 8, m_reg.sp);
+        return false;
+    case 3:
+        m_memory->push(m_reg.pc & 0xFF, m_reg.sp);
+        return false;
+    case 4:
+        m_memory->push(generateFlags() | comp::FLAG_PUSHED, m_reg.sp);
+        writeFlag<comp::FLAG_PUSHED>(false);
+        return false;
+    case 5:
+        m_data = m_memory->readByte(0xFFFE);
+        writeFlag<comp::FLAG_INTERRUPT>(true);
+        return false;
+    default:
+        m_reg.pc = m_data | m_memory->readByte(0xFFFF) << 8;
+        return true;
+    }
+}
+
+bool nemus::core::CPU::microInterrupt()
+{
+    // Same as BRK without the B flag; m_address holds the vector.
+    switch (m_microStep)
+    {
+    case 1:
+        m_memory->readByte(m_reg.pc);
+        return false;
+    case 2:
+        m_memory->push(m_reg.pc >> 8, m_reg.sp);
+        return false;
+    case 3:
+        m_memory->push(m_reg.pc & 0xFF, m_reg.sp);
+        return false;
+    case 4:
+        m_memory->push(generateFlags(), m_reg.sp);
+        return false;
+    case 5:
+        m_data = m_memory->readByte(m_address);
+        writeFlag<comp::FLAG_INTERRUPT>(true);
+        return false;
+    default:
+        m_reg.pc = m_data | m_memory->readByte(m_address + 1) << 8;
+        return true;
+    }
+}
+
+bool nemus::core::CPU::microJam()
+{
+    // Report the address of the opcode, not the byte after it.
+    m_reg.pc--;
+    jam();
+
+    return true;
+}
+
+void nemus::core::CPU::setFlags(uint8_t flagbits)
+{
+    m_reg.p = flagbits & ~(comp::FLAG_NEGATIVE | comp::FLAG_ZERO);
+    m_negative = flagbits & comp::FLAG_NEGATIVE;
+    m_zero = ~flagbits & comp::FLAG_ZERO;
+}
+
+uint8_t nemus::core::CPU::generateFlags()
+{
+    return m_reg.p | 0x20 | (s_nzTable[m_negative] & comp::FLAG_NEGATIVE) | (s_nzTable[m_zero] & comp::FLAG_ZERO);
+}
+
+template <void (nemus::core::CPU::*Op)(uint8_t), nemus::comp::AddressMode addr>
+void nemus::core::CPU::addRead(DispatchTable &table, unsigned int op)
+{
+    table.instruction[op] = &invoke<&CPU::read<Op, addr>>;
+    table.micro[op] = &invoke<&CPU::microRead<Op, addr>>;
+}
+
+template <uint8_t (nemus::core::CPU::*Op)(uint8_t), nemus::comp::AddressMode addr>
+void nemus::core::CPU::addModify(DispatchTable &table, unsigned int op)
+{
+    table.instruction[op] = &invoke<&CPU::modify<Op, addr>>;
+    table.micro[op] = &invoke<&CPU::microModify<Op, addr>>;
+}
+
+template <nemus::core::CPU::Register src, nemus::comp::AddressMode addr>
+void nemus::core::CPU::addStore(DispatchTable &table, unsigned int op)
+{
+    table.instruction[op] = &invoke<&CPU::store<src, addr>>;
+    table.micro[op] = &invoke<&CPU::microStore<src, addr>>;
+}
+
+template <uint8_t (nemus::core::CPU::*Op)(uint16_t &, bool), nemus::comp::AddressMode addr>
+void nemus::core::CPU::addStoreOp(DispatchTable &table, unsigned int op)
+{
+    table.instruction[op] = &invoke<&CPU::storeOp<Op, addr>>;
+    table.micro[op] = &invoke<&CPU::microStoreOp<Op, addr>>;
+}
+
+template <unsigned int (nemus::core::CPU::*Op)()>
+void nemus::core::CPU::addImplied(DispatchTable &table, unsigned int op)
+{
+    table.instruction[op] = &invoke<Op>;
+    table.micro[op] = &invoke<&CPU::microImplied<Op>>;
+}
+
+template <unsigned int (nemus::core::CPU::*Op)(), bool (nemus::core::CPU::*Micro)()>
+void nemus::core::CPU::add(DispatchTable &table, unsigned int op)
+{
+    table.instruction[op] = &invoke<Op>;
+    table.micro[op] = &invoke<Micro>;
+}
+
+nemus::core::CPU::DispatchTable nemus::core::CPU::buildDispatchTable()
+{
+    constexpr Register A = &comp::Registers::a;
+    constexpr Register X = &comp::Registers::x;
+    constexpr Register Y = &comp::Registers::y;
+    constexpr Register SP = &comp::Registers::sp;
+
+    constexpr auto IMM = comp::ADDR_MODE_IMMEDIATE;
+    constexpr auto ZP = comp::ADDR_MODE_ZERO_PAGE;
+    constexpr auto ZPX = comp::ADDR_MODE_ZERO_PAGE_X;
+    constexpr auto ZPY = comp::ADDR_MODE_ZERO_PAGE_Y;
+    constexpr auto ABS = comp::ADDR_MODE_ABSOLUTE;
+    constexpr auto ABX = comp::ADDR_MODE_ABSOLUTE_X;
+    constexpr auto ABY = comp::ADDR_MODE_ABSOLUTE_Y;
+    constexpr auto IND = comp::ADDR_MODE_INDIRECT;
+    constexpr auto IZX = comp::ADDR_MODE_INDIRECT_X;
+    constexpr auto IZY = comp::ADDR_MODE_INDIRECT_Y;
+    constexpr auto ACC = comp::ADDR_MODE_ACCUMULATOR;
+
+    DispatchTable table;
+    // Only the KIL opcodes are left on these.
+    table.instruction.fill(&invoke<&CPU::jam>);
+    table.micro.fill(&invoke<&CPU::microJam>);
+
+    // NOP, including the unofficial ones that read an operand
+    for (unsigned int op : {0x1A, 0x3A, 0x5A, 0x7A, 0xDA, 0xEA, 0xFA})
+    {
+        addImplied<&CPU::nop>(table, op);
+    }
+
+    for (unsigned int op : {0x04, 0x44, 0x64})
+    {
+        addRead<&CPU::opNop, ZP>(table, op);
+    }
+
+    for (unsigned int op : {0x14, 0x34, 0x54, 0x74, 0xD4, 0xF4})
+    {
+        addRead<&CPU::opNop, ZPX>(table, op);
+    }
+
+    for (unsigned int op : {0x1C, 0x3C, 0x5C, 0x7C, 0xDC, 0xFC})
+    {
+        addRead<&CPU::opNop, ABX>(table, op);
+    }
+
+    for (unsigned int op : {0x80, 0x82, 0x89, 0xC2, 0xE2})
+    {
+        addRead<&CPU::opNop, IMM>(table, op);
+    }
+
+    addRead<&CPU::opNop, ABS>(table, 0x0C);
+
+    // Flags
+    addImplied<&CPU::setFlag<comp::FLAG_INTERRUPT>>(table, 0x78);
+    addImplied<&CPU::setFlag<comp::FLAG_CARRY>>(table, 0x38);
+    addImplied<&CPU::setFlag<comp::FLAG_DECIMAL>>(table, 0xF8);
+    addImplied<&CPU::clearFlag<comp::FLAG_OVERFLOW>>(table, 0xB8);
+    addImplied<&CPU::clearFlag<comp::FLAG_CARRY>>(table, 0x18);
+    addImplied<&CPU::clearFlag<comp::FLAG_INTERRUPT>>(table, 0x58);
+    addImplied<&CPU::clearFlag<comp::FLAG_DECIMAL>>(table, 0xD8);
+
+    // LDA
+    addRead<&CPU::opLoad<A>, IMM>(table, 0xA9);
+    addRead<&CPU::opLoad<A>, ZP>(table, 0xA5);
+    addRead<&CPU::opLoad<A>, ZPX>(table, 0xB5);
+    addRead<&CPU::opLoad<A>, ABS>(table, 0xAD);
+    addRead<&CPU::opLoad<A>, ABX>(table, 0xBD);
+    addRead<&CPU::opLoad<A>, ABY>(table, 0xB9);
+    addRead<&CPU::opLoad<A>, IZX>(table, 0xA1);
+    addRead<&CPU::opLoad<A>, IZY>(table, 0xB1);
+
+    // LDX
+    addRead<&CPU::opLoad<X>, IMM>(table, 0xA2);
+    addRead<&CPU::opLoad<X>, ZP>(table, 0xA6);
+    addRead<&CPU::opLoad<X>, ZPY>(table, 0xB6);
+    addRead<&CPU::opLoad<X>, ABS>(table, 0xAE);
+    addRead<&CPU::opLoad<X>, ABY>(table, 0xBE);
+
+    // LDY
+    addRead<&CPU::opLoad<Y>, IMM>(table, 0xA0);
+    addRead<&CPU::opLoad<Y>, ZP>(table, 0xA4);
+    addRead<&CPU::opLoad<Y>, ZPX>(table, 0xB4);
+    addRead<&CPU::opLoad<Y>, ABS>(table, 0xAC);
+    addRead<&CPU::opLoad<Y>, ABX>(table, 0xBC);
+
+    // STA
+    addStore<A, ZP>(table, 0x85);
+    addStore<A, ZPX>(table, 0x95);
+    addStore<A, ABS>(table, 0x8D);
+    addStore<A, ABX>(table, 0x9D);
+    addStore<A, ABY>(table, 0x99);
+    addStore<A, IZX>(table, 0x81);
+    addStore<A, IZY>(table, 0x91);
+
+    // STX
+    addStore<X, ZP>(table, 0x86);
+    addStore<X, ZPY>(table, 0x96);
+    addStore<X, ABS>(table, 0x8E);
+
+    // STY
+    addStore<Y, ZP>(table, 0x84);
+    addStore<Y, ZPX>(table, 0x94);
+    addStore<Y, ABS>(table, 0x8C);
+
+    // Transfers
+    addImplied<&CPU::txs>(table, 0x9A);
+    addImplied<&CPU::transfer<SP, X>>(table, 0xBA);
+    addImplied<&CPU::transfer<X, A>>(table, 0x8A);
+    addImplied<&CPU::transfer<A, X>>(table, 0xAA);
+    addImplied<&CPU::transfer<A, Y>>(table, 0xA8);
+    addImplied<&CPU::transfer<Y, A>>(table, 0x98);
+
+    // Branching
+    add<&CPU::branch<comp::FLAG_NEGATIVE, false>, &CPU::microBranch<comp::FLAG_NEGATIVE, false>>(table, 0x10);
+    add<&CPU::branch<comp::FLAG_NEGATIVE, true>, &CPU::microBranch<comp::FLAG_NEGATIVE, true>>(table, 0x30);
+    add<&CPU::branch<comp::FLAG_OVERFLOW, false>, &CPU::microBranch<comp::FLAG_OVERFLOW, false>>(table, 0x50);
+    add<&CPU::branch<comp::FLAG_OVERFLOW, true>, &CPU::microBranch<comp::FLAG_OVERFLOW, true>>(table, 0x70);
+    add<&CPU::branch<comp::FLAG_CARRY, false>, &CPU::microBranch<comp::FLAG_CARRY, false>>(table, 0x90);
+    add<&CPU::branch<comp::FLAG_CARRY, true>, &CPU::microBranch<comp::FLAG_CARRY, true>>(table, 0xB0);
+    add<&CPU::branch<comp::FLAG_ZERO, false>, &CPU::microBranch<comp::FLAG_ZERO, false>>(table, 0xD0);
+    add<&CPU::branch<comp::FLAG_ZERO, true>, &CPU::microBranch<comp::FLAG_ZERO, true>>(table, 0xF0);
+
+    // CMP
+    addRead<&CPU::opCompare<A>, IMM>(table, 0xC9);
+    addRead<&CPU::opCompare<A>, ZP>(table, 0xC5);
+    addRead<&CPU::opCompare<A>, ZPX>(table, 0xD5);
+    addRead<&CPU::opCompare<A>, ABS>(table, 0xCD);
+    addRead<&CPU::opCompare<A>, ABX>(table, 0xDD);
+    addRead<&CPU::opCompare<A>, ABY>(table, 0xD9);
+    addRead<&CPU::opCompare<A>, IZX>(table, 0xC1);
+    addRead<&CPU::opCompare<A>, IZY>(table, 0xD1);
+
+    // CPX
+    addRead<&CPU::opCompare<X>, IMM>(table, 0xE0);
+    addRead<&CPU::opCompare<X>, ZP>(table, 0xE4);
+    addRead<&CPU::opCompare<X>, ABS>(table, 0xEC);
+
+    // CPY
+    addRead<&CPU::opCompare<Y>, IMM>(table, 0xC0);
+    addRead<&CPU::opCompare<Y>, ZP>(table, 0xC4);
+    addRead<&CPU::opCompare<Y>, ABS>(table, 0xCC);
+
+    // INC
+    addModify<&CPU::opInc, ZP>(table, 0xE6);
+    addModify<&CPU::opInc, ZPX>(table, 0xF6);
+    addModify<&CPU::opInc, ABS>(table, 0xEE);
+    addModify<&CPU::opInc, ABX>(table, 0xFE);
+
+    // INX, INY
+    addImplied<&CPU::incrementRegister<X>>(table, 0xE8);
+    addImplied<&CPU::incrementRegister<Y>>(table, 0xC8);
+
+    // DEC
+    addModify<&CPU::opDec, ZP>(table, 0xC6);
+    addModify<&CPU::opDec, ZPX>(table, 0xD6);
+    addModify<&CPU::opDec, ABS>(table, 0xCE);
+    addModify<&CPU::opDec, ABX>(table, 0xDE);
+
+    // DEX, DEY
+    addImplied<&CPU::decrementRegister<X>>(table, 0xCA);
+    addImplied<&CPU::decrementRegister<Y>>(table, 0x88);
+
+    // JMP, JSR, RTS
+    add<&CPU::subJump, &CPU::microSubJump>(table, 0x20);
+    add<&CPU::jump<ABS>, &CPU::microJump<ABS>>(table, 0x4C);
+    add<&CPU::jump<IND>, &CPU::microJump<IND>>(table, 0x6C);
+    add<&CPU::returnSub, &CPU::microReturnSub>(table, 0x60);
+
+    // BIT
+    addRead<&CPU::opBit, ZP>(table, 0x24);
+    addRead<&CPU::opBit, ABS>(table, 0x2C);
+
+    // ORA
+    addRead<&CPU::opOra, IMM>(table, 0x09);
+    addRead<&CPU::opOra, ZP>(table, 0x05);
+    addRead<&CPU::opOra, ZPX>(table, 0x15);
+    addRead<&CPU::opOra, ABS>(table, 0x0D);
+    addRead<&CPU::opOra, ABX>(table, 0x1D);
+    addRead<&CPU::opOra, ABY>(table, 0x19);
+    addRead<&CPU::opOra, IZX>(table, 0x01);
+    addRead<&CPU::opOra, IZY>(table, 0x11);
+
+    // XOR
+    addRead<&CPU::opEor, IMM>(table, 0x49);
+    addRead<&CPU::opEor, ZP>(table, 0x45);
+    addRead<&CPU::opEor, ZPX>(table, 0x55);
+    addRead<&CPU::opEor, ABS>(table, 0x4D);
+    addRead<&CPU::opEor, ABX>(table, 0x5D);
+    addRead<&CPU::opEor, ABY>(table, 0x59);
+    addRead<&CPU::opEor, IZX>(table, 0x41);
+    addRead<&CPU::opEor, IZY>(table, 0x51);
+
+    // AND
+    addRead<&CPU::opAnd, IMM>(table, 0x29);
+    addRead<&CPU::opAnd, ZP>(table, 0x25);
+    addRead<&CPU::opAnd, ZPX>(table, 0x35);
+    addRead<&CPU::opAnd, ABS>(table, 0x2D);
+    addRead<&CPU::opAnd, ABX>(table, 0x3D);
+    addRead<&CPU::opAnd, ABY>(table, 0x39);
+    addRead<&CPU::opAnd, IZX>(table, 0x21);
+    addRead<&CPU::opAnd, IZY>(table, 0x31);
+
+    // LSR
+    addModify<&CPU::opLsr, ACC>(table, 0x4A);
+    addModify<&CPU::opLsr, ZP>(table, 0x46);
+    addModify<&CPU::opLsr, ZPX>(table, 0x56);
+    addModify<&CPU::opLsr, ABS>(table, 0x4E);
+    addModify<&CPU::opLsr, ABX>(table, 0x5E);
+
+    // ROR
+    addModify<&CPU::opRor, ACC>(table, 0x6A);
+    addModify<&CPU::opRor, ZP>(table, 0x66);
+    addModify<&CPU::opRor, ZPX>(table, 0x76);
+    addModify<&CPU::opRor, ABS>(table, 0x6E);
+    addModify<&CPU::opRor, ABX>(table, 0x7E);
+
+    // ASL
+    addModify<&CPU::opAsl, ACC>(table, 0x0A);
+    addModify<&CPU::opAsl, ZP>(table, 0x06);
+    addModify<&CPU::opAsl, ZPX>(table, 0x16);
+    addModify<&CPU::opAsl, ABS>(table, 0x0E);
+    addModify<&CPU::opAsl, ABX>(table, 0x1E);
+
+    // ROL
+    addModify<&CPU::opRol, ACC>(table, 0x2A);
+    addModify<&CPU::opRol, ZP>(table, 0x26);
+    addModify<&CPU::opRol, ZPX>(table, 0x36);
+    addModify<&CPU::opRol, ABS>(table, 0x2E);
+    addModify<&CPU::opRol, ABX>(table, 0x3E);
+
+    // Stack
+    add<&CPU::pha, &CPU::microPush<&CPU::pha>>(table, 0x48);
+    add<&CPU::pla, &CPU::microPull<&CPU::pla>>(table, 0x68);
+    add<&CPU::php, &CPU::microPush<&CPU::php>>(table, 0x08);
+    add<&CPU::plp, &CPU::microPull<&CPU::plp>>(table, 0x28);
+
+    // ADC
+    addRead<&CPU::opAdc, IMM>(table, 0x69);
+    addRead<&CPU::opAdc, ZP>(table, 0x65);
+    addRead<&CPU::opAdc, ZPX>(table, 0x75);
+    addRead<&CPU::opAdc, ABS>(table, 0x6D);
+    addRead<&CPU::opAdc, ABX>(table, 0x7D);
+    addRead<&CPU::opAdc, ABY>(table, 0x79);
+    addRead<&CPU::opAdc, IZX>(table, 0x61);
+    addRead<&CPU::opAdc, IZY>(table, 0x71);
+
+    // SBC
+    addRead<&CPU::opSbc, IMM>(table, 0xE9);
+    addRead<&CPU::opSbc, ZP>(table, 0xE5);
+    addRead<&CPU::opSbc, ZPX>(table, 0xF5);
+    addRead<&CPU::opSbc, ABS>(table, 0xED);
+    addRead<&CPU::opSbc, ABX>(table, 0xFD);
+    addRead<&CPU::opSbc, ABY>(table, 0xF9);
+    addRead<&CPU::opSbc, IZX>(table, 0xE1);
+    addRead<&CPU::opSbc, IZY>(table, 0xF1);
+
+    // SLO
+    addModify<&CPU::opSlo, IZX>(table, 0x03);
+    addModify<&CPU::opSlo, ZP>(table, 0x07);
+    addModify<&CPU::opSlo, ABS>(table, 0x0F);
+    addModify<&CPU::opSlo, IZY>(table, 0x13);
+    addModify<&CPU::opSlo, ZPX>(table, 0x17);
+    addModify<&CPU::opSlo, ABY>(table, 0x1B);
+    addModify<&CPU::opSlo, ABX>(table, 0x1F);
+
+    // RLA
+    addModify<&CPU::opRla, IZX>(table, 0x23);
+    addModify<&CPU::opRla, ZP>(table, 0x27);
+    addModify<&CPU::opRla, ABS>(table, 0x2F);
+    addModify<&CPU::opRla, IZY>(table, 0x33);
+    addModify<&CPU::opRla, ZPX>(table, 0x37);
+    addModify<&CPU::opRla, ABY>(table, 0x3B);
+    addModify<&CPU::opRla, ABX>(table, 0x3F);
+
+    // SRE
+    addModify<&CPU::opSre, IZX>(table, 0x43);
+    addModify<&CPU::opSre, ZP>(table, 0x47);
+    addModify<&CPU::opSre, ABS>(table, 0x4F);
+    addModify<&CPU::opSre, IZY>(table, 0x53);
+    addModify<&CPU::opSre, ZPX>(table, 0x57);
+    addModify<&CPU::opSre, ABY>(table, 0x5B);
+    addModify<&CPU::opSre, ABX>(table, 0x5F);
+
+    // RRA
+    addModify<&CPU::opRra, IZX>(table, 0x63);
+    addModify<&CPU::opRra, ZP>(table, 0x67);
+    addModify<&CPU::opRra, ABS>(table, 0x6F);
+    addModify<&CPU::opRra, IZY>(table, 0x73);
+    addModify<&CPU::opRra, ZPX>(table, 0x77);
+    addModify<&CPU::opRra, ABY>(table, 0x7B);
+    addModify<&CPU::opRra, ABX>(table, 0x7F);
+
+    // DCP
+    addModify<&CPU::opDcp, IZX>(table, 0xC3);
+    addModify<&CPU::opDcp, ZP>(table, 0xC7);
+    addModify<&CPU::opDcp, ABS>(table, 0xCF);
+    addModify<&CPU::opDcp, IZY>(table, 0xD3);
+    addModify<&CPU::opDcp, ZPX>(table, 0xD7);
+    addModify<&CPU::opDcp, ABY>(table, 0xDB);
+    addModify<&CPU::opDcp, ABX>(table, 0xDF);
+
+    // ISC
+    addModify<&CPU::opIsc, IZX>(table, 0xE3);
+    addModify<&CPU::opIsc, ZP>(table, 0xE7);
+    addModify<&CPU::opIsc, ABS>(table, 0xEF);
+    addModify<&CPU::opIsc, IZY>(table, 0xF3);
+    addModify<&CPU::opIsc, ZPX>(table, 0xF7);
+    addModify<&CPU::opIsc, ABY>(table, 0xFB);
+    addModify<&CPU::opIsc, ABX>(table, 0xFF);
+
+    // LAX
+    addRead<&CPU::opLax, IZX>(table, 0xA3);
+    addRead<&CPU::opLax, ZP>(table, 0xA7);
+    addRead<&CPU::opLax, ABS>(table, 0xAF);
+    addRead<&CPU::opLax, IZY>(table, 0xB3);
+    addRead<&CPU::opLax, ZPY>(table, 0xB7);
+    addRead<&CPU::opLax, ABY>(table, 0xBF);
+    addRead<&CPU::opLxa, IMM>(table, 0xAB);
+
+    // SAX
+    addStoreOp<&CPU::opSax, IZX>(table, 0x83);
+    addStoreOp<&CPU::opSax, ZP>(table, 0x87);
+    addStoreOp<&CPU::opSax, ABS>(table, 0x8F);
+    addStoreOp<&CPU::opSax, ZPY>(table, 0x97);
+
+    // SHY, SHX, AHX, TAS
+    addStoreOp<&CPU::opShy, ABX>(table, 0x9C);
+    addStoreOp<&CPU::opShx, ABY>(table, 0x9E);
+    addStoreOp<&CPU::opAhx, IZY>(table, 0x93);
+    addStoreOp<&CPU::opAhx, ABY>(table, 0x9F);
+    addStoreOp<&CPU::opTas, ABY>(table, 0x9B);
+
+    // LAS
+    addRead<&CPU::opLas, ABY>(table, 0xBB);
+
+    // Immediate-only combinations, and the SBC duplicate
+    addRead<&CPU::opAnc, IMM>(table, 0x0B);
+    addRead<&CPU::opAnc, IMM>(table, 0x2B);
+    addRead<&CPU::opAlr, IMM>(table, 0x4B);
+    addRead<&CPU::opArr, IMM>(table, 0x6B);
+    addRead<&CPU::opXaa, IMM>(table, 0x8B);
+    addRead<&CPU::opAxs, IMM>(table, 0xCB);
+    addRead<&CPU::opSbc, IMM>(table, 0xEB);
+
+    // RTI, BRK
+    add<&CPU::returnInterrupt, &CPU::microReturnInterrupt>(table, 0x40);
+    add<&CPU::brk, &CPU::microBrk>(table, 0x00);
+
+    return table;
 }
 
-unsigned int nemus::core::CPU::generateFlags()
-{
-    unsigned int result = 0;
-
-    if (m_flags.N)
-        result += 0x80;
-    if (m_flags.V)
-        result += 0x40;
-    result += 0x20;
-    if (m_flags.P)
-        result += 0x10;
-    if (m_flags.D)
-        result += 0x08;
-    if (m_flags.I)
-        result += 0x04;
-    if (m_flags.Z)
-        result += 0x02;
-    if (m_flags.C)
-        result += 0x01;
-
-    return result;
-}
\ No newline at end of file
+const nemus::core::CPU::DispatchTable nemus::core::CPU::s_dispatch = nemus::core::CPU::buildDispatchTable();
@@ -1,8 +1,17 @@
 #ifndef NEMUS_CPU_H
 #define NEMUS_CPU_H
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "../Debug/Logger.h"
+#include "../Debug/Trace.h"
 #include "ComponentHelper.h"
+#include "Jit.h"
+#include "State.h"
 
 namespace nemus::core {
 
@@ -10,8 +19,84 @@ namespace nemus::core {
 
     class CPU {
     private:
+        // Handlers return any cycles spent on top of the base cycle count.
+        using Handler = unsigned int (*)(CPU &cpu);
+
+        // Cycle engine handlers run cycle m_microStep of an instruction and
+        // return true on its last cycle.
+        using MicroHandler = bool (*)(CPU &cpu);
+
+        using Register = uint8_t comp::Registers::*;
+
+        // Both engines decode through the same table.
+        struct DispatchTable
+        {
+            std::array<Handler, 256> instruction;
+            std::array<MicroHandler, 256> micro;
+        };
+
+        static const DispatchTable s_dispatch;
+
+        // An instruction with its table lookups and operand bytes done.
+        struct DecodedInstruction
+        {
+            Handler handler;
+            uint16_t operand;
+            uint8_t size;
+            uint8_t cycles;
+            uint8_t opcode;
+        };
+
+        static constexpr unsigned int BLOCK_LENGTH = 16;
+
+        static constexpr std::size_t BLOCK_CACHE_SIZE = 4096;
+
+        // Straight-line PRG-ROM code decoded ahead of time. Blocks are
+        // keyed by the host address of their first byte, so bank switches
+        // never invalidate them; the bank just stops being reached.
+        struct Block
+        {
+            const unsigned char *code = nullptr;
+            unsigned int length = 0;
+            std::array<DecodedInstruction, BLOCK_LENGTH> instructions;
+
+            // Native code for the block once it has run JIT_THRESHOLD times.
+            Jit::Function native = nullptr;
+            unsigned int nativeCycles = 0;
+            Jit::PageMask nativeWrites;
+            uint32_t nativeGeneration = 0;
+            unsigned int runs = 0;
+        };
+
+        static constexpr unsigned int JIT_THRESHOLD = 16;
+
+        // An NMI or IRQ takes as long as BRK, as in the cycle engine.
+        static constexpr int INTERRUPT_CYCLES = 7;
+
+        std::vector<Block> m_blocks;
+
+        comp::JitMode m_jitMode = comp::JIT_OFF;
+
+        std::unique_ptr<Jit> m_jit;
+
+        // Snapshots for JIT_CHECK, allocated once when it is turned on.
+        std::vector<unsigned char> m_checkBefore;
+        std::vector<unsigned char> m_checkAfter;
+        std::vector<unsigned char> m_checkReplayed;
+
+        uint64_t m_checkedRuns = 0;
+
+        JitState m_jitState;
+
         bool m_running;
 
+        uint64_t m_cycles = 0;
+
+        // Where the current run() stops. See limitRun().
+        uint64_t m_deadline = 0;
+
+        std::string m_error;
+
         // Instructions table
         std::string m_opcodes[256];
 
@@ -23,86 +108,375 @@ namespace nemus::core {
 
         comp::Interrupt m_interrupt;
 
-        struct {
-            bool N;
-            bool Z;
-            bool C;
-            bool P;
-            bool I;
-            bool D;
-            bool V;
-        } m_flags;
+        // Asserted IRQ inputs, one bit per comp::IrqSource. IRQs are level
+        // triggered: one stays pending until its source releases the line.
+        uint8_t m_irqLines = 0;
+
+        // m_reg.p holds every status flag except N and Z, which are derived
+        // from the last result that set them: N is bit 7 of m_negative and
+        // Z is set while m_zero is zero. generateFlags() packs the full byte.
+        uint8_t m_negative = 0;
+
+        uint8_t m_zero = 1;
+
+        static constexpr std::array<uint8_t, 256> s_nzTable = [] {
+            std::array<uint8_t, 256> table{};
+            for (unsigned int value = 0; value < 256; value++)
+            {
+                table[value] = (value & comp::FLAG_NEGATIVE) | (value == 0 ? comp::FLAG_ZERO : 0);
+            }
+            return table;
+        }();
+
+        // Cycle engine state. m_microStep is 0 between instructions.
+        MicroHandler m_microOp = nullptr;
+
+        unsigned int m_microStep = 0;
+
+        uint16_t m_address = 0;
+
+        uint8_t m_pointer = 0;
+
+        uint8_t m_data = 0;
+
+        bool m_pageCross = false;
+
+        // Operand bytes of the instruction being executed, low byte first.
+        uint16_t m_operand = 0;
 
         Memory* m_memory = nullptr;
 
         debug::Logger* m_logger;
 
+        debug::TraceBuffer* m_trace = nullptr;
+
+        static DispatchTable buildDispatchTable();
+
+        template <void (CPU::*Op)(uint8_t), comp::AddressMode addr>
+        static void addRead(DispatchTable &table, unsigned int op);
+
+        template <uint8_t (CPU::*Op)(uint8_t), comp::AddressMode addr>
+        static void addModify(DispatchTable &table, unsigned int op);
+
+        template <Register src, comp::AddressMode addr>
+        static void addStore(DispatchTable &table, unsigned int op);
+
+        template <uint8_t (CPU::*Op)(uint16_t &, bool), comp::AddressMode addr>
+        static void addStoreOp(DispatchTable &table, unsigned int op);
+
+        template <unsigned int (CPU::*Op)()>
+        static void addImplied(DispatchTable &table, unsigned int op);
+
+        template <unsigned int (CPU::*Op)(), bool (CPU::*Micro)()>
+        static void add(DispatchTable &table, unsigned int op);
+
+        template <auto Op>
+        static auto invoke(CPU &cpu) { return (cpu.*Op)(); }
+
         void generateOP();
 
         void resetRegisters();
 
-        void checkFlags(unsigned int operand, int flagbits);
+        void setNZ(uint8_t result) { m_negative = m_zero = result; }
+
+        // Loads all flags from a status byte.
+        void setFlags(uint8_t flagbits);
+
+        uint8_t generateFlags();
+
+        template <comp::Flag flag>
+        bool readFlag();
+
+        // An NMI, or an IRQ line with interrupts enabled.
+        bool isInterruptPending();
+
+        template <comp::Flag flag>
+        void writeFlag(bool value);
+
+        template <comp::Flag flag>
+        unsigned int setFlag();
+
+        template <comp::Flag flag>
+        unsigned int clearFlag();
+
+        // Operations shared by both engines. Read operations consume an
+        // operand; modify operations return the value to write back.
+        template <Register dest>
+        void opLoad(uint8_t value);
+
+        template <Register src>
+        void opCompare(uint8_t value);
+
+        void opOra(uint8_t value);
+
+        void opEor(uint8_t value);
+
+        void opAnd(uint8_t value);
+
+        void opBit(uint8_t value);
+
+        void opAdc(uint8_t value);
+
+        void opSbc(uint8_t value);
+
+        void opNop(uint8_t) {}
+
+        uint8_t opAsl(uint8_t value);
+
+        uint8_t opLsr(uint8_t value);
+
+        uint8_t opRol(uint8_t value);
 
-        void setFlags(unsigned int flagbits);
+        uint8_t opRor(uint8_t value);
 
-        void setFlags(comp::Flag flag);
+        uint8_t opInc(uint8_t value);
 
-        void unsetFlags(comp::Flag flag);
+        uint8_t opDec(uint8_t value);
 
-        unsigned int generateFlags();
+        uint8_t opSlo(uint8_t value);
 
-        void branch(bool doJump);
+        uint8_t opRla(uint8_t value);
 
-        void load(unsigned int &dest, comp::AddressMode addr);
+        uint8_t opSre(uint8_t value);
 
-        void store(unsigned int &src, comp::AddressMode addr);
+        uint8_t opRra(uint8_t value);
 
-        void compare(unsigned int &src, comp::AddressMode addr);
+        uint8_t opDcp(uint8_t value);
 
-        void decrement(comp::AddressMode addr);
+        uint8_t opIsc(uint8_t value);
 
-        void decrement(unsigned int &src);
+        void opLax(uint8_t value);
 
-        void increment(comp::AddressMode addr);
+        void opLas(uint8_t value);
 
-        void increment(unsigned int &src);
+        void opAnc(uint8_t value);
 
-        void subJump();
+        void opAlr(uint8_t value);
 
-        void jump(comp::AddressMode addr);
+        void opArr(uint8_t value);
 
-        void returnSub();
+        void opAxs(uint8_t value);
 
-        void bit(comp::AddressMode addr);
+        // XAA and LXA OR A with a constant that depends on the chip and
+        // its temperature before the AND. Most NES CPUs behave as if it
+        // were all ones.
+        static constexpr uint8_t UNSTABLE_MAGIC = 0xFF;
 
-        void ora(comp::AddressMode addr);
+        void opXaa(uint8_t value);
 
-        void xora(comp::AddressMode addr);
+        void opLxa(uint8_t value);
 
-        void bitAnd(comp::AddressMode addr);
+        // Store operations return the value to write. The SH* family also
+        // moves the address when indexing crosses a page.
+        uint8_t opSax(uint16_t &address, bool pageCross);
 
-        void shiftRight(comp::AddressMode addr);
+        uint8_t opShy(uint16_t &address, bool pageCross);
 
-        void rotateRight(comp::AddressMode addr);
+        uint8_t opShx(uint16_t &address, bool pageCross);
 
-        void asl(comp::AddressMode addr);
+        uint8_t opAhx(uint16_t &address, bool pageCross);
 
-        void rotateLeft(comp::AddressMode addr);
+        uint8_t opTas(uint16_t &address, bool pageCross);
 
-        void adc(comp::AddressMode addr);
+        uint8_t storeHigh(uint8_t value, uint16_t &address, bool pageCross);
 
-        void subtract(comp::AddressMode addr);
+        // Instruction engine
+        template <void (CPU::*Op)(uint8_t), comp::AddressMode addr>
+        unsigned int read();
 
-        void interrupt();
+        template <uint8_t (CPU::*Op)(uint8_t), comp::AddressMode addr>
+        unsigned int modify();
+
+        template <Register src, comp::AddressMode addr>
+        unsigned int store();
+
+        template <uint8_t (CPU::*Op)(uint16_t &, bool), comp::AddressMode addr>
+        unsigned int storeOp();
+
+        template <comp::Flag flag, bool condition>
+        unsigned int branch();
+
+        template <Register src, Register dest>
+        unsigned int transfer();
+
+        template <Register src>
+        unsigned int decrementRegister();
+
+        template <Register src>
+        unsigned int incrementRegister();
+
+        template <comp::AddressMode addr>
+        unsigned int jump();
+
+        unsigned int nop();
+
+        unsigned int txs();
+
+        unsigned int subJump();
+
+        unsigned int returnSub();
+
+        unsigned int returnInterrupt();
+
+        unsigned int pha();
+
+        unsigned int pla();
+
+        unsigned int php();
+
+        unsigned int plp();
+
+        unsigned int brk();
+
+        unsigned int jam();
+
+        // Cycle engine
+        template <comp::AddressMode addr>
+        void microAddress();
+
+        template <void (CPU::*Op)(uint8_t), comp::AddressMode addr>
+        bool microRead();
+
+        template <uint8_t (CPU::*Op)(uint8_t), comp::AddressMode addr>
+        bool microModify();
+
+        template <Register src, comp::AddressMode addr>
+        bool microStore();
+
+        template <uint8_t (CPU::*Op)(uint16_t &, bool), comp::AddressMode addr>
+        bool microStoreOp();
+
+        template <unsigned int (CPU::*Op)()>
+        bool microImplied();
+
+        template <comp::Flag flag, bool condition>
+        bool microBranch();
+
+        template <comp::AddressMode addr>
+        bool microJump();
+
+        bool microSubJump();
+
+        bool microReturnSub();
+
+        bool microReturnInterrupt();
+
+        template <unsigned int (CPU::*Op)()>
+        bool microPush();
+
+        template <unsigned int (CPU::*Op)()>
+        bool microPull();
+
+        bool microBrk();
+
+        bool microInterrupt();
+
+        bool microJam();
+
+        // Enters the pending NMI or IRQ handler and returns the cycles it
+        // took, which are already added to m_cycles.
+        int interrupt();
+
+        DecodedInstruction decode(uint16_t address);
+
+        template <bool Trace>
+        int execute(const DecodedInstruction &instruction);
+
+        // Decodes the block starting at code, which is mapped at address.
+        void buildBlock(Block &block, const unsigned char *code, uint16_t address);
+
+        // Runs the block's native code if it has any and the whole of it
+        // fits before untilCycle. Returns false if nothing ran.
+        bool runNative(Block &block, uint64_t untilCycle);
+
+        unsigned int callNative(Jit::Function function, uint64_t untilCycle);
+
+        // Runs the native code and then the interpreter over the same
+        // instructions from the same state, halting on any difference.
+        bool runChecked(Block &block, uint64_t untilCycle);
+
+        // Saves the writable pages in pages into buffer, packed in page
+        // order and skipping RAM mirrors, or with restore set, writes them
+        // back from it. Returns the bytes of buffer used.
+        std::size_t copyWritablePages(const Jit::PageMask &pages, std::vector<unsigned char> &buffer, bool restore);
+
+        static std::size_t getBlockIndex(const unsigned char *code)
+        {
+            const auto key = reinterpret_cast<std::uintptr_t>(code);
+            return (key ^ (key >> 12)) & (BLOCK_CACHE_SIZE - 1);
+        }
+
+        void traceInstruction(unsigned int op);
 
     public:
         CPU(Memory* memory, debug::Logger* logger);
 
-        int tick();
+        // Executes one instruction or interrupt and returns its cycles. The
+        // tracing instantiation records the state into the trace buffer
+        // first; the other one contains no trace code at all.
+        template <bool Trace>
+        int step();
+
+        int tick() { return step<false>(); }
+
+        // Executes instructions until at least untilCycle CPU cycles have
+        // run, going through the block cache for code in PRG-ROM. Always
+        // stops on an instruction boundary.
+        template <bool Trace>
+        void run(uint64_t untilCycle);
+
+        // Moves the deadline of the current run() forward to cycle, for
+        // devices whose next event moves earlier on a register write.
+        void limitRun(uint64_t cycle) { m_deadline = std::min(m_deadline, cycle); }
+
+        // Runs one bus cycle, fetching the next instruction or taking a
+        // pending interrupt when the previous one has finished.
+        template <bool Trace>
+        void cycle();
+
+        // True between instructions. Switching engines or saving state is
+        // only valid here.
+        bool isInstructionBoundary() { return m_microStep == 0; }
+
+        void setTrace(debug::TraceBuffer* trace) { m_trace = trace; }
+
+        // Falls back to JIT_OFF where the JIT is not available. Tracing
+        // always interprets, since compiled code records nothing.
+        void setJitMode(comp::JitMode mode);
+
+        comp::JitMode getJitMode() { return m_jitMode; }
+
+        // Runs of compiled blocks that JIT_CHECK found to match the
+        // interpreter.
+        uint64_t getCheckedRuns() { return m_checkedRuns; }
+
+        // Starts execution at address instead of the reset vector.
+        void setProgramCounter(uint16_t address) { m_reg.pc = address; }
 
         bool isRunning() { return m_running; }
 
+        uint64_t getCycles() { return m_cycles; }
+
+        // The registers with P packed from the flags, as the trace shows it.
+        comp::Registers getRegisters()
+        {
+            comp::Registers reg = m_reg;
+            reg.p = generateFlags();
+            return reg;
+        }
+
+        const std::string &getError() { return m_error; }
+
         void setInterrupt(comp::Interrupt interrupt) { m_interrupt = interrupt; }
+
+        void setIrq(comp::IrqSource source, bool asserted)
+        {
+            m_irqLines = asserted ? m_irqLines | source : m_irqLines & ~source;
+        }
+
+        void saveState(StateWriter &state);
+
+        void loadState(StateReader &state);
     };
 
 }
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <limits>
+
+#include "Cartridge.h"
+
+namespace
+{
+    constexpr std::size_t PRG_UNIT = 0x4000;
+    constexpr std::size_t CHR_UNIT = 0x2000;
+
+    constexpr std::size_t PRG_ALIGN = 0x2000;
+    constexpr std::size_t CHR_ALIGN = 0x400;
+
+    // NES 2.0 ROM sizes: a 12-bit count of units, or, when the high
+    // nibble is all ones, 2^E * (2M + 1) bytes from the low byte's bits.
+    // Returns false if the size does not fit in a std::size_t.
+    bool getRomSize(unsigned int low, unsigned int high, std::size_t unit, std::size_t &size)
+    {
+        if (high == 0xF)
+        {
+            // 2M + 1 takes up to three bits.
+            if ((low >> 2) > std::numeric_limits<std::size_t>::digits - 3)
+            {
+                return false;
+            }
+
+            size = (std::size_t{1} << (low >> 2)) * ((low & 3) * 2 + 1);
+            return true;
+        }
+
+        size = ((high << 8) | low) * unit;
+        return true;
+    }
+
+    std::size_t alignUp(std::size_t size, std::size_t alignment)
+    {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+}
+
+nemus::core::Cartridge::Cartridge(const std::vector<char> &gameData)
+{
+    unsigned char header[INES_HEADER_SIZE] = {};
+    std::copy_n(gameData.begin(), std::min<std::size_t>(gameData.size(), INES_HEADER_SIZE), header);
+
+    m_nes2 = (header[7] & 0x0C) == 0x08;
+
+    m_mapperNumber = (header[6] >> 4) | (header[7] & 0xF0);
+    m_verticalMirroring = header[6] & 0x01;
+    m_battery = header[6] & 0x02;
+    m_fourScreen = header[6] & 0x08;
+
+    if (m_nes2)
+    {
+        m_mapperNumber |= (header[8] & 0x0F) << 8;
+        m_submapper = header[8] >> 4;
+
+        if (!getRomSize(header[4], header[9] & 0x0F, PRG_UNIT, m_prgSize) ||
+            !getRomSize(header[5], header[9] >> 4, CHR_UNIT, m_chrSize))
+        {
+            m_prgSize = m_chrSize = 0;
+            return;
+        }
+    }
+    else
+    {
+        m_prgSize = header[4] * PRG_UNIT;
+        m_chrSize = header[5] * CHR_UNIT;
+    }
+
+    m_valid = true;
+
+    // A header can declare far more than the file holds, so only what is
+    // actually there is kept.
+    const auto available = [&gameData](std::size_t start) {
+        return start < gameData.size() ? gameData.size() - start : 0;
+    };
+
+    const std::size_t prgStart = INES_HEADER_SIZE + ((header[6] & 0x04) ? INES_TRAINER_SIZE : 0);
+    const std::size_t prgSize = std::min(m_prgSize, available(prgStart));
+
+    const std::size_t chrStart = prgStart + prgSize;
+    const std::size_t chrSize = std::min(m_chrSize, available(chrStart));
+
+    // Mappers index whole banks, so never leave them short of one.
+    m_prgSize = std::max(alignUp(prgSize, PRG_ALIGN), PRG_ALIGN);
+    m_chrSize = alignUp(chrSize, CHR_ALIGN);
+
+    m_data.assign(m_prgSize + m_chrSize, 0);
+
+    std::copy_n(gameData.begin() + prgStart, prgSize, m_data.data());
+    std::copy_n(gameData.begin() + chrStart, chrSize, m_data.data() + m_prgSize);
+}
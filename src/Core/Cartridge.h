@@ -0,0 +1,73 @@
+#ifndef NEMUS_CARTRIDGE_H
+#define NEMUS_CARTRIDGE_H
+
+#include <cstddef>
+#include <vector>
+
+#define INES_HEADER_SIZE  16
+#define INES_TRAINER_SIZE 512
+
+namespace nemus::core
+{
+    // A game image in iNES or NES 2.0 format, parsed once. It never changes
+    // after loading, so any number of consoles can share one and map their
+    // PRG and CHR banks straight into it.
+    class Cartridge
+    {
+    private:
+        // PRG-ROM followed by CHR-ROM as far as the file holds them, zero
+        // padded to whole 8 KB PRG and 1 KB CHR banks.
+        std::vector<unsigned char> m_data;
+
+        std::size_t m_prgSize = 0;
+
+        std::size_t m_chrSize = 0;
+
+        unsigned int m_mapperNumber = 0;
+
+        unsigned int m_submapper = 0;
+
+        bool m_valid = false;
+
+        bool m_nes2 = false;
+
+        bool m_verticalMirroring = false;
+
+        bool m_fourScreen = false;
+
+        bool m_battery = false;
+
+    public:
+        explicit Cartridge(const std::vector<char> &gameData);
+
+        // False if the header declares sizes no file could hold. Nothing
+        // else about the cartridge is meaningful then.
+        bool isValid() const { return m_valid; }
+
+        const unsigned char *getPRG() const { return m_data.data(); }
+
+        std::size_t getPRGSize() const { return m_prgSize; }
+
+        // Empty for boards with CHR-RAM.
+        const unsigned char *getCHR() const { return m_data.data() + m_prgSize; }
+
+        std::size_t getCHRSize() const { return m_chrSize; }
+
+        unsigned int getMapperNumber() const { return m_mapperNumber; }
+
+        // Only set by NES 2.0 headers.
+        unsigned int getSubmapper() const { return m_submapper; }
+
+        bool isNES2() const { return m_nes2; }
+
+        // Hard-wired nametable layout, for mappers that cannot change it.
+        bool hasVerticalMirroring() const { return m_verticalMirroring; }
+
+        bool hasFourScreen() const { return m_fourScreen; }
+
+        // Whether PRG-RAM is battery backed and worth keeping in a save file.
+        bool hasBattery() const { return m_battery; }
+    };
+}
+
+#endif
@@ -1,14 +1,18 @@
 #ifndef NEMUS_COMPONENTHELPER_H
 #define NEMUS_COMPONENTHELPER_H
 
+#include <cstdint>
+
 namespace nemus::comp {
+    // Registers wrap at their hardware width, so arithmetic on them needs
+    // no masking.
     struct Registers {
-        unsigned int x;
-        unsigned int y;
-        unsigned int a;
-        unsigned int pc;
-        unsigned int sp;
-        unsigned int p;
+        uint16_t pc;
+        uint8_t a;
+        uint8_t x;
+        uint8_t y;
+        uint8_t sp;
+        uint8_t p;
     };
 
     enum AddressMode {
@@ -42,6 +46,58 @@ namespace nemus::comp {
         INT_RESET,
         INT_IRQ
     };
+
+    // Devices sharing the IRQ line.
+    enum IrqSource {
+        IRQ_FRAME_COUNTER = 0x1,
+        IRQ_DMC = 0x2,
+        IRQ_MAPPER = 0x4
+    };
+
+    // How the CPU is stepped. The instruction engine runs whole
+    // instructions at once; the cycle engine runs one bus cycle at a time
+    // so the PPU sees every access at its exact cycle.
+    enum CPUEngine {
+        ENGINE_INSTRUCTION,
+        ENGINE_CYCLE
+    };
+
+    // Whether the instruction engine runs hot PRG-ROM blocks as native
+    // code. JIT_CHECK also runs every compiled block through the
+    // interpreter and halts the CPU when the two disagree.
+    enum JitMode {
+        JIT_OFF,
+        JIT_ON,
+        JIT_CHECK
+    };
+
+    // Pixels written by the PPU. PIXEL_FORMAT_INDEX8 stores the palette
+    // index itself, for consumers that never look at colors.
+    enum PixelFormat {
+        PIXEL_FORMAT_ARGB32,
+        PIXEL_FORMAT_RGB565,
+        PIXEL_FORMAT_INDEX8
+    };
+
+    // How a frontend paces emulation. Wall clock runs the CPU at its real
+    // clock rate; audio keeps the sample queue near a target fill instead,
+    // nudging the resampling ratio so playback never drifts into a gap.
+    enum PacingMode {
+        PACING_UNTHROTTLED,
+        PACING_WALL_CLOCK,
+        PACING_AUDIO
+    };
+
+    constexpr unsigned int getPixelSize(PixelFormat format) {
+        switch (format) {
+        case PIXEL_FORMAT_RGB565:
+            return 2;
+        case PIXEL_FORMAT_INDEX8:
+            return 1;
+        default:
+            return 4;
+        }
+    }
 }
 
 #endif
@@ -0,0 +1,235 @@
+#include <algorithm>
+
+#include "Console.h"
+
+nemus::core::Console::Console()
+{
+    m_ppu = std::make_unique<PPU>();
+    m_apu = std::make_unique<APU>();
+    m_input = std::make_unique<Input>();
+}
+
+nemus::core::Console::~Console() = default;
+
+bool nemus::core::Console::loadGame(const std::vector<char> &gameData)
+{
+    return loadGame(std::make_shared<const Cartridge>(gameData));
+}
+
+bool nemus::core::Console::loadGame(std::shared_ptr<const Cartridge> cartridge)
+{
+    if (!cartridge->isValid())
+    {
+        return false;
+    }
+
+    reset();
+
+    m_logger = std::make_unique<debug::Logger>();
+    // m_logger->enable();
+
+    m_memory = std::make_unique<Memory>(m_logger.get(), m_ppu.get(), m_apu.get(), m_input.get(), std::move(cartridge));
+
+    m_cpu = std::make_unique<CPU>(m_memory.get(), m_logger.get());
+
+    m_memory->setCPU(m_cpu.get());
+
+    m_cpu->setTrace(m_trace);
+
+    m_cpu->setJitMode(m_jitMode);
+
+    m_ppu->setCPU(m_cpu.get());
+
+    m_ppu->setMemory(m_memory.get());
+
+    m_apu->setCPU(m_cpu.get());
+
+    m_apu->setMemory(m_memory.get());
+
+    m_gameLoaded = true;
+
+    return true;
+}
+
+void nemus::core::Console::reset()
+{
+    m_gameLoaded = false;
+
+    // The PPU's reset would otherwise look at the freed mapper.
+    m_ppu->setMemory(nullptr);
+
+    m_cpu.reset();
+    m_memory.reset();
+    m_logger.reset();
+
+    m_ppu->reset();
+    m_apu->reset();
+}
+
+void nemus::core::Console::setTrace(debug::TraceBuffer *trace)
+{
+    m_trace = trace;
+
+    if (m_cpu)
+    {
+        m_cpu->setTrace(trace);
+    }
+}
+
+void nemus::core::Console::setJitMode(comp::JitMode mode)
+{
+    m_jitMode = mode;
+
+    if (m_cpu)
+    {
+        m_cpu->setJitMode(mode);
+    }
+}
+
+bool nemus::core::Console::runFrame()
+{
+    // Picking the instantiation once per frame keeps tracing and the
+    // engine choice out of the per-instruction path.
+    if (m_engine == comp::ENGINE_CYCLE)
+    {
+        return m_trace ? stepFrame<true, comp::ENGINE_CYCLE>() : stepFrame<false, comp::ENGINE_CYCLE>();
+    }
+
+    return m_trace ? stepFrame<true, comp::ENGINE_INSTRUCTION>() : stepFrame<false, comp::ENGINE_INSTRUCTION>();
+}
+
+template <bool Trace, nemus::comp::CPUEngine Engine>
+bool nemus::core::Console::stepFrame()
+{
+    if (!isRunning())
+    {
+        return false;
+    }
+
+    const unsigned long frame = m_ppu->getFrameCount();
+
+    // Frames end between instructions, so save states and engine changes
+    // never land in the middle of one.
+    while (m_ppu->getFrameCount() == frame || !m_cpu->isInstructionBoundary())
+    {
+        if constexpr (Engine == comp::ENGINE_CYCLE)
+        {
+            m_cpu->cycle<Trace>();
+        }
+        else
+        {
+            // PPU events sit at fixed dots of the frame, so the deadline
+            // holds even if a register access catches the PPU up on the way.
+            m_cpu->run<Trace>(std::min((m_ppu->getNextEvent() + 2) / 3, m_apu->getNextEvent()));
+        }
+
+        // The PPU and APU only run when they have something the CPU can
+        // observe. Register accesses catch them up through Memory.
+        if (m_cpu->getCycles() * 3 >= m_ppu->getNextEvent())
+        {
+            m_ppu->catchUp();
+        }
+
+        if (m_cpu->getCycles() >= m_apu->getNextEvent())
+        {
+            m_apu->catchUp();
+        }
+
+        if (!m_cpu->isRunning())
+        {
+            if (m_errorHandler)
+            {
+                m_errorHandler(m_cpu->getError());
+            }
+
+            return false;
+        }
+    }
+
+    m_apu->endFrame();
+
+    return true;
+}
+
+void nemus::core::Console::writeState(StateWriter &state)
+{
+    state.write(static_cast<uint32_t>(STATE_MAGIC));
+    state.write(static_cast<uint32_t>(STATE_VERSION));
+    state.write(static_cast<uint32_t>(getStateSize()));
+
+    m_cpu->saveState(state);
+    m_memory->saveState(state);
+    m_ppu->saveState(state);
+    m_apu->saveState(state);
+    m_input->saveState(state);
+}
+
+std::size_t nemus::core::Console::getStateSize()
+{
+    if (!m_gameLoaded)
+    {
+        return 0;
+    }
+
+    // The size depends on the mapper, so measure it with a counting pass.
+    StateWriter counter;
+    counter.write(static_cast<uint32_t>(STATE_MAGIC));
+    counter.write(static_cast<uint32_t>(STATE_VERSION));
+    counter.write(static_cast<uint32_t>(0));
+
+    m_cpu->saveState(counter);
+    m_memory->saveState(counter);
+    m_ppu->saveState(counter);
+    m_apu->saveState(counter);
+    m_input->saveState(counter);
+
+    return counter.getOffset();
+}
+
+void nemus::core::Console::saveState(std::vector<unsigned char> &buffer)
+{
+    if (!m_gameLoaded)
+    {
+        buffer.clear();
+        return;
+    }
+
+    const std::size_t size = getStateSize();
+    if (buffer.size() != size)
+    {
+        buffer.resize(size);
+    }
+
+    StateWriter state(buffer.data(), buffer.size());
+    writeState(state);
+}
+
+bool nemus::core::Console::loadState(const std::vector<unsigned char> &buffer)
+{
+    if (!m_gameLoaded)
+    {
+        return false;
+    }
+
+    StateReader state(buffer.data(), buffer.size());
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t size = 0;
+    state.read(magic);
+    state.read(version);
+    state.read(size);
+
+    if (!state.isValid() || magic != STATE_MAGIC || version != STATE_VERSION || size != buffer.size() || size != getStateSize())
+    {
+        return false;
+    }
+
+    m_cpu->loadState(state);
+    m_memory->loadState(state);
+    m_ppu->loadState(state);
+    m_apu->loadState(state);
+    m_input->loadState(state);
+
+    return state.isValid();
+}
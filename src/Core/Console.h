@@ -0,0 +1,147 @@
+#ifndef NEMUS_CONSOLE_H
+#define NEMUS_CONSOLE_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../Debug/Logger.h"
+#include "APU.h"
+#include "CPU.h"
+#include "Input.h"
+#include "Memory.h"
+#include "PPU.h"
+
+namespace nemus::core
+{
+    // The emulated machine without any frontend attached. Both the Qt
+    // window and the headless runner drive the hardware through this.
+    class Console
+    {
+    public:
+        using ErrorHandler = std::function<void(const std::string &error)>;
+
+    private:
+        std::unique_ptr<debug::Logger> m_logger;
+
+        std::unique_ptr<PPU> m_ppu;
+
+        std::unique_ptr<APU> m_apu;
+
+        std::unique_ptr<Input> m_input;
+
+        std::unique_ptr<Memory> m_memory;
+
+        std::unique_ptr<CPU> m_cpu;
+
+        debug::TraceBuffer *m_trace = nullptr;
+
+        comp::CPUEngine m_engine = comp::ENGINE_INSTRUCTION;
+
+        comp::JitMode m_jitMode = comp::JIT_OFF;
+
+        bool m_gameLoaded = false;
+
+        ErrorHandler m_errorHandler;
+
+        template <bool Trace, comp::CPUEngine Engine>
+        bool stepFrame();
+
+        void writeState(StateWriter &state);
+
+    public:
+        Console();
+
+        ~Console();
+
+        // Returns false, leaving the console untouched, if gameData is not
+        // a usable ROM image.
+        bool loadGame(const std::vector<char> &gameData);
+
+        // Consoles loading the same Cartridge share its ROM data.
+        bool loadGame(std::shared_ptr<const Cartridge> cartridge);
+
+        void reset();
+
+        // Runs until the PPU finishes the current frame or the CPU halts.
+        // Returns false if the CPU is not running.
+        bool runFrame();
+
+        // Called on the thread running frames when the CPU halts, once per
+        // halt, with the same message getError() returns. Frontends use it
+        // to report the problem without polling or blocking emulation.
+        void setErrorHandler(ErrorHandler handler) { m_errorHandler = std::move(handler); }
+
+        // Records every executed instruction into trace while attached.
+        // Pass nullptr to detach.
+        void setTrace(debug::TraceBuffer *trace);
+
+        // Takes effect from the next frame. The cycle engine is slower but
+        // lets the PPU observe every CPU access at its exact cycle.
+        void setEngine(comp::CPUEngine engine) { m_engine = engine; }
+
+        comp::CPUEngine getEngine() { return m_engine; }
+
+        // Only affects the instruction engine. Kept across game loads.
+        void setJitMode(comp::JitMode mode);
+
+        comp::JitMode getJitMode() { return m_jitMode; }
+
+        // Moves the CPU to address instead of the reset vector, as CPU test
+        // ROMs like nestest expect. Only valid while a game is loaded.
+        void setEntryPoint(uint16_t address) { m_cpu->setProgramCounter(address); }
+
+        // Size in bytes of a save state for the loaded game.
+        std::size_t getStateSize();
+
+        // Writes a save state into buffer. The buffer is only resized when
+        // it has the wrong size, so reusing one buffer never allocates.
+        void saveState(std::vector<unsigned char> &buffer);
+
+        // Returns false, leaving the console untouched, if the buffer is not
+        // a state of this version with the loaded game's mapper layout.
+        bool loadState(const std::vector<unsigned char> &buffer);
+
+        bool isRunning() { return m_gameLoaded && m_cpu->isRunning(); }
+
+        bool isGameLoaded() { return m_gameLoaded; }
+
+        // CPU cycles since the game was loaded or reset.
+        uint64_t getCycles() { return m_gameLoaded ? m_cpu->getCycles() : 0; }
+
+        const std::string &getError() { return m_cpu->getError(); }
+
+        PPU *getPPU() { return m_ppu.get(); }
+
+        // Only valid while a game is loaded.
+        CPU *getCPU() { return m_cpu.get(); }
+
+        // See PPU::setFramebuffer(). Kept across game loads, like the format.
+        void setFramebuffer(void *pixels, std::size_t stride = 0) { m_ppu->setFramebuffer(pixels, stride); }
+
+        void setPixelFormat(comp::PixelFormat format) { m_ppu->setPixelFormat(format); }
+
+        // See APU::setSampleRate(). Kept across game loads.
+        void setSampleRate(unsigned int rate) { m_apu->setSampleRate(rate); }
+
+        unsigned int getSampleRate() { return m_apu->getSampleRate(); }
+
+        // See Synth::setResampleRatio(). Reset by setSampleRate().
+        void setResampleRatio(double ratio) { m_apu->setResampleRatio(ratio); }
+
+        // Audio for the frames run so far, if a sample rate is set.
+        SampleQueue *getSampleQueue() { return m_apu->getSampleQueue(); }
+
+        Input *getInput() { return m_input.get(); }
+
+        // The 2 KB of internal RAM. Only valid while a game is loaded.
+        const unsigned char *getRam() { return m_memory->getRam(); }
+
+        // Only valid while a game is loaded.
+        debug::Logger *getLogger() { return m_logger.get(); }
+    };
+}
+
+#endif
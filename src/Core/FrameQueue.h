@@ -0,0 +1,63 @@
+#ifndef NEMUS_FRAMEQUEUE_H
+#define NEMUS_FRAMEQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+namespace nemus::core
+{
+    // Lock-free triple buffer between the thread rendering frames and the
+    // thread displaying them. The producer always owns the back buffer and
+    // the consumer always owns the front buffer; the third buffer is swapped
+    // atomically between them, so neither side ever waits on the other.
+    class FrameQueue
+    {
+    private:
+        // Set in m_middle while it holds a frame the consumer has not seen.
+        static constexpr unsigned int FRESH = 0x4;
+
+        std::array<std::vector<unsigned int>, 3> m_buffers;
+
+        unsigned int m_back = 0;
+
+        alignas(64) std::atomic<unsigned int> m_middle = 1;
+
+        alignas(64) unsigned int m_front = 2;
+
+    public:
+        explicit FrameQueue(std::size_t size)
+        {
+            for (auto &buffer : m_buffers)
+            {
+                buffer.assign(size, 0);
+            }
+        }
+
+        // Producer side.
+        unsigned int *getBackBuffer() { return m_buffers[m_back].data(); }
+
+        // Hands the back buffer to the consumer and takes the stale one.
+        void publish()
+        {
+            m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+        }
+
+        // Consumer side. Returns true if a newer frame was picked up.
+        bool acquire()
+        {
+            if (!(m_middle.load(std::memory_order_relaxed) & FRESH))
+            {
+                return false;
+            }
+
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & ~FRESH;
+
+            return true;
+        }
+
+        const unsigned int *getFrontBuffer() const { return m_buffers[m_front].data(); }
+    };
+}
+
+#endif
@@ -18,6 +18,12 @@ void nemus::core::Input::unsetButton(int button) {
     m_buttons[button] = false;
 }
 
+void nemus::core::Input::setButtons(unsigned char buttons) {
+    for(int i = 0; i < 8; i++) {
+        m_buttons[i] = (buttons >> i) & 1;
+    }
+}
+
 unsigned char nemus::core::Input::read() {
     unsigned char ret = 0;
 
@@ -41,3 +47,13 @@ void nemus::core::Input::write(unsigned char value) {
         m_currentButton = 0;
     }
 }
+
+void nemus::core::Input::saveState(StateWriter &state) {
+    state.write(m_currentButton);
+    state.write(m_strobe);
+}
+
+void nemus::core::Input::loadState(StateReader &state) {
+    state.read(m_currentButton);
+    state.read(m_strobe);
+}
@@ -1,6 +1,10 @@
 #ifndef INPUT_H
 #define INPUT_H
 
+#include <atomic>
+
+#include "State.h"
+
 #define BUTTON_A      0
 #define BUTTON_B      1
 #define BUTTON_START  2
@@ -13,7 +17,8 @@
 namespace nemus::core {
     class Input {
     private:
-        bool m_buttons[8];
+        // Set from the UI thread, read by the emulation thread.
+        std::atomic<bool> m_buttons[8];
         int  m_currentButton;
         bool m_strobe;
 
@@ -23,8 +28,15 @@ namespace nemus::core {
         void setButton(int button);
         void unsetButton(int button);
 
+        // Sets every button at once, bit n holding button n.
+        void setButtons(unsigned char buttons);
+
         unsigned char read();
         void write(unsigned char value);
+
+        // Button states come from the host and are not saved.
+        void saveState(StateWriter &state);
+        void loadState(StateReader &state);
     };
 }
 
@@ -0,0 +1,1265 @@
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#include "Jit.h"
+#include "Mappers/Mapper.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define NEMUS_JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+#ifdef NEMUS_JIT_X86_64
+namespace
+{
+    constexpr std::size_t CODE_BUFFER_SIZE = 4 << 20;
+
+    // Blocks shorter than this run faster in the interpreter than the
+    // native call and state copy cost.
+    constexpr unsigned int MIN_INSTRUCTIONS = 2;
+
+    enum Reg : unsigned int
+    {
+        RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+        R8, R9, R10, R11
+    };
+
+    // Register use inside compiled code. A, X and Y live in host registers
+    // for the whole block; the flags stay in JitState. RDX counts the
+    // cycles only known at run time, rcx carries the operand value and rbx
+    // its address. rax and r11 are scratch.
+    constexpr Reg STATE = RDI;
+    constexpr Reg RAM = RSI;
+    constexpr Reg EXTRA = RDX;
+    constexpr std::array<Reg, 3> REGISTERS = {R8, R9, R10};
+
+    constexpr int32_t OFFSET_PC = offsetof(nemus::core::JitState, reg) + offsetof(nemus::comp::Registers, pc);
+    constexpr int32_t OFFSET_A = offsetof(nemus::core::JitState, reg) + offsetof(nemus::comp::Registers, a);
+    constexpr int32_t OFFSET_X = offsetof(nemus::core::JitState, reg) + offsetof(nemus::comp::Registers, x);
+    constexpr int32_t OFFSET_Y = offsetof(nemus::core::JitState, reg) + offsetof(nemus::comp::Registers, y);
+    constexpr int32_t OFFSET_SP = offsetof(nemus::core::JitState, reg) + offsetof(nemus::comp::Registers, sp);
+    constexpr int32_t OFFSET_P = offsetof(nemus::core::JitState, reg) + offsetof(nemus::comp::Registers, p);
+    constexpr int32_t OFFSET_NEGATIVE = offsetof(nemus::core::JitState, negative);
+    constexpr int32_t OFFSET_ZERO = offsetof(nemus::core::JitState, zero);
+    constexpr int32_t OFFSET_INSTRUCTIONS = offsetof(nemus::core::JitState, instructions);
+    constexpr int32_t OFFSET_BUDGET = offsetof(nemus::core::JitState, budget);
+    constexpr int32_t OFFSET_RAM = offsetof(nemus::core::JitState, ram);
+    constexpr int32_t OFFSET_READ_PAGES = offsetof(nemus::core::JitState, readPages);
+    constexpr int32_t OFFSET_WRITE_PAGES = offsetof(nemus::core::JitState, writePages);
+
+    // Opcodes for the "op r/m32, r32" forms.
+    enum AluOp : uint8_t
+    {
+        OP_ADD = 0x01,
+        OP_OR = 0x09,
+        OP_AND = 0x21,
+        OP_SUB = 0x29,
+        OP_XOR = 0x31,
+        OP_CMP = 0x39,
+        OP_TEST = 0x85,
+        OP_MOV = 0x89
+    };
+
+    // The /digit of the immediate group opcodes 0x80, 0x81 and 0xC1.
+    enum Extension : unsigned int
+    {
+        EXT_ADD = 0,
+        EXT_OR = 1,
+        EXT_AND = 4,
+        EXT_SHL = 4,
+        EXT_SHR = 5,
+        EXT_SUB = 5,
+        EXT_XOR = 6
+    };
+
+    enum Condition : uint8_t
+    {
+        CC_B = 0x2,
+        CC_AE = 0x3,
+        CC_E = 0x4,
+        CC_NE = 0x5
+    };
+
+    // Just enough of an x86-64 assembler for the code below. Byte
+    // registers are only ever al, cl, bl and r8b-r11b.
+    class Emitter
+    {
+    private:
+        std::vector<unsigned char> &m_code;
+
+        void rex(bool wide, unsigned int reg, unsigned int index, unsigned int base)
+        {
+            const unsigned int prefix = 0x40 | wide << 3 | (reg >> 3) << 2 | (index >> 3) << 1 | base >> 3;
+
+            if (prefix != 0x40)
+            {
+                byte(prefix);
+            }
+        }
+
+        void modrm(unsigned int reg, unsigned int rm) { byte(0xC0 | (reg & 7) << 3 | (rm & 7)); }
+
+        // [base + disp32]
+        void memory(unsigned int reg, unsigned int base, int32_t disp)
+        {
+            byte(0x80 | (reg & 7) << 3 | (base & 7));
+            imm32(disp);
+        }
+
+        // [base + index << scale]
+        void indexed(unsigned int reg, unsigned int base, unsigned int index, unsigned int scale)
+        {
+            byte(0x04 | (reg & 7) << 3);
+            byte(scale << 6 | (index & 7) << 3 | (base & 7));
+        }
+
+    public:
+        explicit Emitter(std::vector<unsigned char> &code) : m_code(code) {}
+
+        std::size_t size() const { return m_code.size(); }
+
+        void truncate(std::size_t size) { m_code.resize(size); }
+
+        void byte(unsigned int value) { m_code.push_back(static_cast<unsigned char>(value)); }
+
+        void imm16(unsigned int value)
+        {
+            byte(value);
+            byte(value >> 8);
+        }
+
+        void imm32(uint32_t value)
+        {
+            imm16(value);
+            imm16(value >> 16);
+        }
+
+        // movzx dst, byte [base + disp]
+        void loadByte(Reg dst, Reg base, int32_t disp)
+        {
+            rex(false, dst, 0, base);
+            byte(0x0F);
+            byte(0xB6);
+            memory(dst, base, disp);
+        }
+
+        // movzx dst, byte [base + index]
+        void loadByte(Reg dst, Reg base, Reg index)
+        {
+            rex(false, dst, index, base);
+            byte(0x0F);
+            byte(0xB6);
+            indexed(dst, base, index, 0);
+        }
+
+        // mov byte [base + disp], src
+        void storeByte(Reg base, int32_t disp, Reg src)
+        {
+            rex(false, src, 0, base);
+            byte(0x88);
+            memory(src, base, disp);
+        }
+
+        // mov byte [base + index], src
+        void storeByte(Reg base, Reg index, Reg src)
+        {
+            rex(false, src, index, base);
+            byte(0x88);
+            indexed(src, base, index, 0);
+        }
+
+        // mov dword [base + disp], value
+        void storeDword(Reg base, int32_t disp, uint32_t value)
+        {
+            rex(false, 0, 0, base);
+            byte(0xC7);
+            memory(0, base, disp);
+            imm32(value);
+        }
+
+        // add dword [base + disp], value
+        void addDword(Reg base, int32_t disp, uint32_t value)
+        {
+            rex(false, 0, 0, base);
+            byte(0x81);
+            memory(EXT_ADD, base, disp);
+            imm32(value);
+        }
+
+        // cmp reg, dword [base + disp]
+        void compare(Reg reg, Reg base, int32_t disp)
+        {
+            rex(false, reg, 0, base);
+            byte(0x3B);
+            memory(reg, base, disp);
+        }
+
+        // cmp word [base + disp], value
+        void compareWord(Reg base, int32_t disp, uint16_t value)
+        {
+            byte(0x66);
+            rex(false, 0, 0, base);
+            byte(0x81);
+            memory(7, base, disp);
+            imm16(value);
+        }
+
+        // mov word [base + disp], value
+        void storeWord(Reg base, int32_t disp, uint16_t value)
+        {
+            byte(0x66);
+            rex(false, 0, 0, base);
+            byte(0xC7);
+            memory(0, base, disp);
+            imm16(value);
+        }
+
+        // add word [base + disp], value
+        void addWord(Reg base, int32_t disp, uint16_t value)
+        {
+            byte(0x66);
+            rex(false, 0, 0, base);
+            byte(0x81);
+            memory(EXT_ADD, base, disp);
+            imm16(value);
+        }
+
+        // mov dst, qword [base + disp]
+        void loadPointer(Reg dst, Reg base, int32_t disp)
+        {
+            rex(true, dst, 0, base);
+            byte(0x8B);
+            memory(dst, base, disp);
+        }
+
+        // mov dst, qword [base + index * 8]
+        void loadPointer(Reg dst, Reg base, Reg index)
+        {
+            rex(true, dst, index, base);
+            byte(0x8B);
+            indexed(dst, base, index, 3);
+        }
+
+        // op byte [base + disp], value
+        void aluByte(Extension op, Reg base, int32_t disp, uint8_t value)
+        {
+            rex(false, 0, 0, base);
+            byte(0x80);
+            memory(op, base, disp);
+            byte(value);
+        }
+
+        // or byte [base + disp], src
+        void orByte(Reg base, int32_t disp, Reg src)
+        {
+            rex(false, src, 0, base);
+            byte(0x08);
+            memory(src, base, disp);
+        }
+
+        // test byte [base + disp], value
+        void testByte(Reg base, int32_t disp, uint8_t value)
+        {
+            rex(false, 0, 0, base);
+            byte(0xF6);
+            memory(0, base, disp);
+            byte(value);
+        }
+
+        // op dst, src
+        void alu(AluOp op, Reg dst, Reg src, bool wide = false)
+        {
+            rex(wide, src, 0, dst);
+            byte(op);
+            modrm(src, dst);
+        }
+
+        // op dst, value
+        void alu(Extension op, Reg dst, uint32_t value)
+        {
+            rex(false, 0, 0, dst);
+            byte(0x81);
+            modrm(op, dst);
+            imm32(value);
+        }
+
+        // mov dst, value
+        void move(Reg dst, uint32_t value)
+        {
+            rex(false, 0, 0, dst);
+            byte(0xB8 | (dst & 7));
+            imm32(value);
+        }
+
+        // movzx dst, src8
+        void zeroExtend(Reg dst, Reg src)
+        {
+            rex(false, dst, 0, src);
+            byte(0x0F);
+            byte(0xB6);
+            modrm(dst, src);
+        }
+
+        // shl/shr dst, count
+        void shift(Extension op, Reg dst, uint8_t count)
+        {
+            rex(false, 0, 0, dst);
+            byte(0xC1);
+            modrm(op, dst);
+            byte(count);
+        }
+
+        // not dst
+        void invert(Reg dst)
+        {
+            rex(false, 0, 0, dst);
+            byte(0xF7);
+            modrm(2, dst);
+        }
+
+        // setcc dst8
+        void set(Condition condition, Reg dst)
+        {
+            rex(false, 0, 0, dst);
+            byte(0x0F);
+            byte(0x90 | condition);
+            modrm(0, dst);
+        }
+
+        // jcc rel32. Returns where the displacement goes for patch().
+        std::size_t jump(Condition condition)
+        {
+            byte(0x0F);
+            byte(0x80 | condition);
+            imm32(0);
+            return size() - 4;
+        }
+
+        // jcc rel32 back to an earlier position.
+        void jump(Condition condition, std::size_t target)
+        {
+            byte(0x0F);
+            byte(0x80 | condition);
+            imm32(static_cast<uint32_t>(target - (size() + 4)));
+        }
+
+        // Points the jump at position to the current end of the code.
+        void patch(std::size_t position)
+        {
+            const auto displacement = static_cast<int32_t>(size() - (position + 4));
+            std::memcpy(m_code.data() + position, &displacement, sizeof(displacement));
+        }
+
+        void push(Reg reg)
+        {
+            rex(false, 0, 0, reg);
+            byte(0x50 | (reg & 7));
+        }
+
+        void pop(Reg reg)
+        {
+            rex(false, 0, 0, reg);
+            byte(0x58 | (reg & 7));
+        }
+
+        void ret() { byte(0xC3); }
+    };
+
+    enum Kind : uint8_t
+    {
+        UNSUPPORTED,
+        LOAD,
+        STORE,
+        ORA,
+        AND,
+        EOR,
+        ADC,
+        SBC,
+        COMPARE,
+        BIT,
+        INC,
+        DEC,
+        ASL,
+        LSR,
+        ROL,
+        ROR,
+        TRANSFER,
+        INCREMENT,
+        DECREMENT,
+        TXS,
+        TSX,
+        SET_FLAG,
+        CLEAR_FLAG,
+        NOP,
+        BRANCH,
+        JUMP
+    };
+
+    enum Mode : uint8_t
+    {
+        IMP,
+        ACC,
+        IMM,
+        ZP,
+        ZPX,
+        ZPY,
+        ABS,
+        ABX,
+        ABY,
+        IZX,
+        IZY,
+        REL
+    };
+
+    // reg is 0-2 for A, X and Y. arg is the destination register of a
+    // transfer, the flag of a flag change or branch, or for a branch with
+    // reg set, that it is taken on a set flag.
+    struct OpInfo
+    {
+        Kind kind = UNSUPPORTED;
+        Mode mode = IMP;
+        uint8_t reg = 0;
+        uint8_t arg = 0;
+    };
+
+    constexpr unsigned int getSize(Mode mode)
+    {
+        switch (mode)
+        {
+        case IMP:
+        case ACC:
+            return 1;
+        case ABS:
+        case ABX:
+        case ABY:
+            return 3;
+        default:
+            return 2;
+        }
+    }
+
+    constexpr std::array<OpInfo, 256> buildOpTable()
+    {
+        std::array<OpInfo, 256> table{};
+
+        // The eight addressing modes of the ALU column, from (zp,x) at base.
+        auto group = [&table](unsigned int base, Kind kind, uint8_t reg = 0) {
+            table[base + 0x00] = {kind, IZX, reg};
+            table[base + 0x04] = {kind, ZP, reg};
+            table[base + 0x08] = {kind, IMM, reg};
+            table[base + 0x0C] = {kind, ABS, reg};
+            table[base + 0x10] = {kind, IZY, reg};
+            table[base + 0x14] = {kind, ZPX, reg};
+            table[base + 0x18] = {kind, ABY, reg};
+            table[base + 0x1C] = {kind, ABX, reg};
+        };
+
+        group(0x01, ORA);
+        group(0x21, AND);
+        group(0x41, EOR);
+        group(0x61, ADC);
+        group(0xA1, LOAD, 0);
+        group(0xC1, COMPARE, 0);
+        group(0xE1, SBC);
+
+        table[0xA2] = {LOAD, IMM, 1};
+        table[0xA6] = {LOAD, ZP, 1};
+        table[0xB6] = {LOAD, ZPY, 1};
+        table[0xAE] = {LOAD, ABS, 1};
+        table[0xBE] = {LOAD, ABY, 1};
+
+        table[0xA0] = {LOAD, IMM, 2};
+        table[0xA4] = {LOAD, ZP, 2};
+        table[0xB4] = {LOAD, ZPX, 2};
+        table[0xAC] = {LOAD, ABS, 2};
+        table[0xBC] = {LOAD, ABX, 2};
+
+        table[0x81] = {STORE, IZX, 0};
+        table[0x85] = {STORE, ZP, 0};
+        table[0x8D] = {STORE, ABS, 0};
+        table[0x91] = {STORE, IZY, 0};
+        table[0x95] = {STORE, ZPX, 0};
+        table[0x99] = {STORE, ABY, 0};
+        table[0x9D] = {STORE, ABX, 0};
+
+        table[0x86] = {STORE, ZP, 1};
+        table[0x96] = {STORE, ZPY, 1};
+        table[0x8E] = {STORE, ABS, 1};
+
+        table[0x84] = {STORE, ZP, 2};
+        table[0x94] = {STORE, ZPX, 2};
+        table[0x8C] = {STORE, ABS, 2};
+
+        table[0xE0] = {COMPARE, IMM, 1};
+        table[0xE4] = {COMPARE, ZP, 1};
+        table[0xEC] = {COMPARE, ABS, 1};
+
+        table[0xC0] = {COMPARE, IMM, 2};
+        table[0xC4] = {COMPARE, ZP, 2};
+        table[0xCC] = {COMPARE, ABS, 2};
+
+        table[0x24] = {BIT, ZP};
+        table[0x2C] = {BIT, ABS};
+
+        // Read-modify-write instructions only on RAM known at compile time.
+        const Kind shifts[] = {ASL, ROL, LSR, ROR};
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            table[0x0A + i * 0x20] = {shifts[i], ACC};
+            table[0x06 + i * 0x20] = {shifts[i], ZP};
+            table[0x16 + i * 0x20] = {shifts[i], ZPX};
+            table[0x0E + i * 0x20] = {shifts[i], ABS};
+        }
+
+        table[0xE6] = {INC, ZP};
+        table[0xF6] = {INC, ZPX};
+        table[0xEE] = {INC, ABS};
+
+        table[0xC6] = {DEC, ZP};
+        table[0xD6] = {DEC, ZPX};
+        table[0xCE] = {DEC, ABS};
+
+        table[0xAA] = {TRANSFER, IMP, 0, 1};
+        table[0xA8] = {TRANSFER, IMP, 0, 2};
+        table[0x8A] = {TRANSFER, IMP, 1, 0};
+        table[0x98] = {TRANSFER, IMP, 2, 0};
+        table[0x9A] = {TXS, IMP};
+        table[0xBA] = {TSX, IMP};
+
+        table[0xE8] = {INCREMENT, IMP, 1};
+        table[0xC8] = {INCREMENT, IMP, 2};
+        table[0xCA] = {DECREMENT, IMP, 1};
+        table[0x88] = {DECREMENT, IMP, 2};
+
+        table[0x18] = {CLEAR_FLAG, IMP, 0, nemus::comp::FLAG_CARRY};
+        table[0x38] = {SET_FLAG, IMP, 0, nemus::comp::FLAG_CARRY};
+        table[0x58] = {CLEAR_FLAG, IMP, 0, nemus::comp::FLAG_INTERRUPT};
+        table[0x78] = {SET_FLAG, IMP, 0, nemus::comp::FLAG_INTERRUPT};
+        table[0xB8] = {CLEAR_FLAG, IMP, 0, nemus::comp::FLAG_OVERFLOW};
+        table[0xD8] = {CLEAR_FLAG, IMP, 0, nemus::comp::FLAG_DECIMAL};
+        table[0xF8] = {SET_FLAG, IMP, 0, nemus::comp::FLAG_DECIMAL};
+
+        table[0xEA] = {NOP, IMP};
+
+        table[0x10] = {BRANCH, REL, 0, nemus::comp::FLAG_NEGATIVE};
+        table[0x30] = {BRANCH, REL, 1, nemus::comp::FLAG_NEGATIVE};
+        table[0x50] = {BRANCH, REL, 0, nemus::comp::FLAG_OVERFLOW};
+        table[0x70] = {BRANCH, REL, 1, nemus::comp::FLAG_OVERFLOW};
+        table[0x90] = {BRANCH, REL, 0, nemus::comp::FLAG_CARRY};
+        table[0xB0] = {BRANCH, REL, 1, nemus::comp::FLAG_CARRY};
+        table[0xD0] = {BRANCH, REL, 0, nemus::comp::FLAG_ZERO};
+        table[0xF0] = {BRANCH, REL, 1, nemus::comp::FLAG_ZERO};
+
+        table[0x4C] = {JUMP, ABS};
+
+        return table;
+    }
+
+    constexpr std::array<OpInfo, 256> s_ops = buildOpTable();
+
+    // Translates one block. Instructions either compile completely or
+    // leave the code untouched so the block can end before them.
+    class BlockCompiler
+    {
+    private:
+        // A page lookup that found no memory, returning before the
+        // instruction at offset.
+        struct Bail
+        {
+            std::size_t jump;
+            unsigned int offset;
+            unsigned int cycles;
+            unsigned int instructions;
+        };
+
+        Emitter m_emit;
+
+        std::vector<Bail> m_bails;
+
+        // Position of the instruction being compiled in the block.
+        unsigned int m_offset = 0;
+
+        unsigned int m_cycles = 0;
+
+        unsigned int m_instructions = 0;
+
+        // Most cycles beyond the base counts the block can take.
+        unsigned int m_extra = 0;
+
+        // Pages the compiled stores can reach.
+        nemus::core::Jit::PageMask m_writes;
+
+        // Where the first instruction's code starts.
+        std::size_t m_start = 0;
+
+        void setNZ(Reg reg)
+        {
+            m_emit.storeByte(STATE, OFFSET_NEGATIVE, reg);
+            m_emit.storeByte(STATE, OFFSET_ZERO, reg);
+        }
+
+        // Replaces the carry with bit 0 of reg.
+        void setCarry(Reg reg)
+        {
+            m_emit.aluByte(EXT_AND, STATE, OFFSET_P, static_cast<uint8_t>(~nemus::comp::FLAG_CARRY));
+            m_emit.orByte(STATE, OFFSET_P, reg);
+        }
+
+        // Accesses that always hit internal RAM leave their offset into it
+        // in rbx.
+        bool ramAddress(Mode mode, uint16_t operand)
+        {
+            switch (mode)
+            {
+            case ZP:
+                m_emit.move(RBX, operand & 0xFF);
+                return true;
+            case ZPX:
+            case ZPY:
+                m_emit.alu(OP_MOV, RBX, REGISTERS[mode == ZPX ? 1 : 2]);
+                m_emit.alu(EXT_ADD, RBX, operand & 0xFF);
+                m_emit.zeroExtend(RBX, RBX);
+                return true;
+            case ABS:
+                if (operand >= 0x2000)
+                {
+                    return false;
+                }
+
+                m_emit.move(RBX, operand & 0x7FF);
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        // Sets bit 16 of rbx when its address is on another page than base.
+        void markPageCross(Reg base)
+        {
+            m_emit.alu(OP_MOV, RAX, RBX);
+            m_emit.alu(OP_XOR, RAX, base);
+            m_emit.shift(EXT_SHR, RAX, 8);
+            m_emit.set(CC_NE, RAX);
+            m_emit.zeroExtend(RAX, RAX);
+            m_emit.shift(EXT_SHL, RAX, 16);
+            m_emit.alu(OP_OR, RBX, RAX);
+        }
+
+        // Other accesses leave the full address in rbx for a page lookup.
+        // Addresses fixed on the I/O registers, or for writes on the
+        // mapper, are not compiled at all.
+        bool pagedAddress(Mode mode, uint16_t operand, bool write)
+        {
+            switch (mode)
+            {
+            case ABS:
+                if ((operand >= 0x2000 && operand < 0x6000) || (write && operand >= 0x8000))
+                {
+                    return false;
+                }
+
+                m_emit.move(RBX, operand);
+                return true;
+            case ABX:
+            case ABY:
+                m_emit.alu(OP_MOV, RBX, REGISTERS[mode == ABX ? 1 : 2]);
+                m_emit.alu(EXT_ADD, RBX, operand);
+                m_emit.alu(EXT_AND, RBX, 0xFFFF);
+
+                if (!write)
+                {
+                    m_emit.move(R11, operand);
+                    markPageCross(R11);
+                }
+                return true;
+            case IZX:
+                m_emit.alu(OP_MOV, RAX, REGISTERS[1]);
+                m_emit.alu(EXT_ADD, RAX, operand & 0xFF);
+                m_emit.zeroExtend(RAX, RAX);
+                m_emit.loadByte(RBX, RAM, RAX);
+                m_emit.alu(EXT_ADD, RAX, 1);
+                m_emit.zeroExtend(RAX, RAX);
+                m_emit.loadByte(RAX, RAM, RAX);
+                m_emit.shift(EXT_SHL, RAX, 8);
+                m_emit.alu(OP_OR, RBX, RAX);
+                return true;
+            case IZY:
+                m_emit.loadByte(RBX, RAM, static_cast<int32_t>(operand & 0xFF));
+                m_emit.loadByte(RAX, RAM, static_cast<int32_t>((operand + 1) & 0xFF));
+                m_emit.shift(EXT_SHL, RAX, 8);
+                m_emit.alu(OP_OR, RBX, RAX);
+                m_emit.alu(OP_MOV, R11, RBX);
+                m_emit.alu(OP_ADD, RBX, REGISTERS[2]);
+                m_emit.alu(EXT_AND, RBX, 0xFFFF);
+
+                if (!write)
+                {
+                    markPageCross(R11);
+                }
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        // Looks up the page of the address in rbx, leaving its memory in
+        // r11 and the offset into it in rax. Unmapped pages return to the
+        // interpreter before the current instruction.
+        void lookupPage(int32_t pages)
+        {
+            m_emit.alu(OP_MOV, RAX, RBX);
+            m_emit.shift(EXT_SHR, RAX, 8);
+            m_emit.alu(EXT_AND, RAX, 0xFF);
+            m_emit.loadPointer(R11, STATE, pages);
+            m_emit.loadPointer(R11, R11, RAX);
+            m_emit.alu(OP_TEST, R11, R11, true);
+            m_bails.push_back({m_emit.jump(CC_E), m_offset, m_cycles, m_instructions});
+            m_emit.zeroExtend(RAX, RBX);
+        }
+
+        // Loads the operand into rcx, counting the page crossing cycle the
+        // access may take.
+        bool readOperand(Mode mode, uint16_t operand)
+        {
+            if (mode == IMM)
+            {
+                m_emit.move(RCX, operand & 0xFF);
+                return true;
+            }
+
+            if (ramAddress(mode, operand))
+            {
+                m_emit.loadByte(RCX, RAM, RBX);
+                return true;
+            }
+
+            if (!pagedAddress(mode, operand, false))
+            {
+                return false;
+            }
+
+            lookupPage(OFFSET_READ_PAGES);
+            m_emit.loadByte(RCX, R11, RAX);
+
+            if (mode == ABX || mode == ABY || mode == IZY)
+            {
+                m_emit.shift(EXT_SHR, RBX, 16);
+                m_emit.alu(OP_ADD, EXTRA, RBX);
+                m_extra++;
+            }
+
+            return true;
+        }
+
+        // Marks the pages a store with this operand can reach. RAM mirrors
+        // share their memory, so a page of any mirror stands for all of
+        // them.
+        void addWrite(Mode mode, uint16_t operand)
+        {
+            switch (mode)
+            {
+            case ZP:
+            case ZPX:
+            case ZPY:
+                m_writes.set(0);
+                break;
+            case ABS:
+                m_writes.set(operand >> 8);
+                break;
+            case ABX:
+            case ABY:
+                m_writes.set(operand >> 8);
+                m_writes.set(((operand >> 8) + 1) & 0xFF);
+                break;
+            default:
+                // Pointers are only known at run time.
+                m_writes.set();
+                break;
+            }
+        }
+
+        bool writeOperand(Mode mode, uint16_t operand, Reg src)
+        {
+            if (ramAddress(mode, operand))
+            {
+                m_emit.storeByte(RAM, RBX, src);
+                return true;
+            }
+
+            if (!pagedAddress(mode, operand, true))
+            {
+                return false;
+            }
+
+            lookupPage(OFFSET_WRITE_PAGES);
+            m_emit.storeByte(R11, RAX, src);
+
+            return true;
+        }
+
+        void adc()
+        {
+            const Reg a = REGISTERS[0];
+
+            // result = A + value + C
+            m_emit.loadByte(RAX, STATE, OFFSET_P);
+            m_emit.alu(EXT_AND, RAX, nemus::comp::FLAG_CARRY);
+            m_emit.alu(OP_ADD, RAX, a);
+            m_emit.alu(OP_ADD, RAX, RCX);
+
+            // V = ~(A ^ value) & (A ^ result) & 0x80, moved to bit 6.
+            m_emit.alu(OP_MOV, R11, a);
+            m_emit.alu(OP_XOR, R11, RCX);
+            m_emit.invert(R11);
+            m_emit.alu(OP_XOR, a, RAX);
+            m_emit.alu(OP_AND, R11, a);
+            m_emit.alu(EXT_AND, R11, 0x80);
+            m_emit.shift(EXT_SHR, R11, 1);
+
+            // C = bit 8 of the result.
+            m_emit.alu(OP_MOV, RCX, RAX);
+            m_emit.shift(EXT_SHR, RCX, 8);
+            m_emit.alu(OP_OR, R11, RCX);
+
+            m_emit.aluByte(EXT_AND, STATE, OFFSET_P,
+                           static_cast<uint8_t>(~(nemus::comp::FLAG_CARRY | nemus::comp::FLAG_OVERFLOW)));
+            m_emit.orByte(STATE, OFFSET_P, R11);
+
+            m_emit.zeroExtend(a, RAX);
+            setNZ(a);
+        }
+
+        // Shifts and rotates reg in place and sets the carry.
+        void shift(Kind kind, Reg reg)
+        {
+            switch (kind)
+            {
+            case ASL:
+                m_emit.alu(OP_MOV, RAX, reg);
+                m_emit.shift(EXT_SHR, RAX, 7);
+                setCarry(RAX);
+                m_emit.shift(EXT_SHL, reg, 1);
+                break;
+            case LSR:
+                m_emit.alu(OP_MOV, RAX, reg);
+                m_emit.alu(EXT_AND, RAX, 1);
+                setCarry(RAX);
+                m_emit.shift(EXT_SHR, reg, 1);
+                break;
+            case ROL:
+                m_emit.loadByte(RAX, STATE, OFFSET_P);
+                m_emit.alu(EXT_AND, RAX, nemus::comp::FLAG_CARRY);
+                m_emit.alu(OP_MOV, R11, reg);
+                m_emit.shift(EXT_SHR, R11, 7);
+                m_emit.shift(EXT_SHL, reg, 1);
+                m_emit.alu(OP_OR, reg, RAX);
+                setCarry(R11);
+                break;
+            case ROR:
+                m_emit.loadByte(RAX, STATE, OFFSET_P);
+                m_emit.alu(EXT_AND, RAX, nemus::comp::FLAG_CARRY);
+                m_emit.shift(EXT_SHL, RAX, 7);
+                m_emit.alu(OP_MOV, R11, reg);
+                m_emit.alu(EXT_AND, R11, 1);
+                m_emit.shift(EXT_SHR, reg, 1);
+                m_emit.alu(OP_OR, reg, RAX);
+                setCarry(R11);
+                break;
+            case INC:
+                m_emit.alu(EXT_ADD, reg, 1);
+                break;
+            default:
+                m_emit.alu(EXT_SUB, reg, 1);
+                break;
+            }
+
+            m_emit.zeroExtend(reg, reg);
+            setNZ(reg);
+        }
+
+        // Goes around a block that ends by returning to its start again as
+        // long as another pass of at most passCycles fits in the budget.
+        void loop(unsigned int cycles, unsigned int passCycles)
+        {
+            m_emit.alu(EXT_ADD, EXTRA, cycles);
+            m_emit.addDword(STATE, OFFSET_INSTRUCTIONS, m_instructions + 1);
+            m_emit.alu(OP_MOV, RAX, EXTRA);
+            m_emit.alu(EXT_ADD, RAX, passCycles);
+            m_emit.compare(RAX, STATE, OFFSET_BUDGET);
+            m_emit.jump(CC_B, m_start);
+            exit(0, 0, 0);
+        }
+
+        void branch(const OpInfo &info, uint16_t address, int8_t displacement, unsigned int base)
+        {
+            // Z is set while the zero byte is 0; the other flags while their bit is.
+            Condition flagSet = CC_NE;
+            if (info.arg == nemus::comp::FLAG_ZERO)
+            {
+                m_emit.testByte(STATE, OFFSET_ZERO, 0xFF);
+                flagSet = CC_E;
+            }
+            else if (info.arg == nemus::comp::FLAG_NEGATIVE)
+            {
+                m_emit.testByte(STATE, OFFSET_NEGATIVE, 0x80);
+            }
+            else
+            {
+                m_emit.testByte(STATE, OFFSET_P, info.arg);
+            }
+
+            const Condition taken = info.reg ? flagSet : static_cast<Condition>(flagSet ^ 1);
+            const std::size_t notTaken = m_emit.jump(static_cast<Condition>(taken ^ 1));
+
+            const uint16_t next = address + m_offset + 2;
+            const unsigned int pageCycle = ((next ^ static_cast<uint16_t>(next + displacement)) >> 8) != 0;
+
+            const uint16_t target = m_offset + 2 + displacement;
+            const unsigned int takenCycles = m_cycles + base + 1 + pageCycle;
+
+            m_extra += 1 + pageCycle;
+
+            if (target == 0)
+            {
+                loop(takenCycles, m_cycles + base + m_extra);
+            }
+            else
+            {
+                exit(target, takenCycles, m_instructions + 1);
+            }
+
+            m_emit.patch(notTaken);
+            exit(m_offset + 2, m_cycles + base, m_instructions + 1);
+        }
+
+    public:
+        explicit BlockCompiler(std::vector<unsigned char> &code) : m_emit(code) {}
+
+        unsigned int getInstructions() { return m_instructions; }
+
+        // Most cycles one pass through the block can take.
+        unsigned int getMaxCycles() { return m_cycles + m_extra; }
+
+        const nemus::core::Jit::PageMask &getWrites() { return m_writes; }
+
+        void prologue()
+        {
+            m_emit.push(RBX);
+            m_emit.loadPointer(RAM, STATE, OFFSET_RAM);
+            m_emit.loadByte(REGISTERS[0], STATE, OFFSET_A);
+            m_emit.loadByte(REGISTERS[1], STATE, OFFSET_X);
+            m_emit.loadByte(REGISTERS[2], STATE, OFFSET_Y);
+            m_emit.alu(OP_XOR, EXTRA, EXTRA);
+            m_emit.storeDword(STATE, OFFSET_INSTRUCTIONS, 0);
+
+            m_start = m_emit.size();
+        }
+
+        // Writes the registers back and returns. pc is relative to the
+        // start of the block unless absolute is set.
+        void exit(uint16_t pc, unsigned int cycles, unsigned int instructions, bool absolute = false)
+        {
+            m_emit.storeByte(STATE, OFFSET_A, REGISTERS[0]);
+            m_emit.storeByte(STATE, OFFSET_X, REGISTERS[1]);
+            m_emit.storeByte(STATE, OFFSET_Y, REGISTERS[2]);
+
+            if (absolute)
+            {
+                m_emit.storeWord(STATE, OFFSET_PC, pc);
+            }
+            else if (pc != 0)
+            {
+                m_emit.addWord(STATE, OFFSET_PC, pc);
+            }
+
+            if (instructions != 0)
+            {
+                m_emit.addDword(STATE, OFFSET_INSTRUCTIONS, instructions);
+            }
+
+            m_emit.move(RAX, cycles);
+            m_emit.alu(OP_ADD, RAX, EXTRA);
+            m_emit.pop(RBX);
+            m_emit.ret();
+        }
+
+        void exitCurrent() { exit(m_offset, m_cycles, m_instructions); }
+
+        // Emits the returns of the page lookups that found nothing mapped.
+        void bails()
+        {
+            for (const Bail &bail : m_bails)
+            {
+                m_emit.patch(bail.jump);
+                exit(bail.offset, bail.cycles, bail.instructions);
+            }
+        }
+
+        // Compiles the instruction at the current offset. Returns false,
+        // leaving no code behind, if it cannot be compiled. Sets ends after
+        // a branch or jump, which emit their own returns.
+        bool instruction(const unsigned char *code, uint16_t address, unsigned int base, bool &ends)
+        {
+            const OpInfo &info = s_ops[code[0]];
+            const unsigned int size = getSize(info.mode);
+            const uint16_t operand = size == 1 ? 0 : size == 2 ? code[1] : code[1] | code[2] << 8;
+            const Reg reg = REGISTERS[info.reg];
+
+            const std::size_t mark = m_emit.size();
+            const std::size_t bailMark = m_bails.size();
+
+            bool compiled = true;
+            ends = false;
+
+            switch (info.kind)
+            {
+            case LOAD:
+            case ORA:
+            case AND:
+            case EOR:
+            case ADC:
+            case SBC:
+            case COMPARE:
+            case BIT:
+                compiled = readOperand(info.mode, operand);
+                if (!compiled)
+                {
+                    break;
+                }
+
+                if (info.kind == LOAD)
+                {
+                    m_emit.alu(OP_MOV, reg, RCX);
+                    setNZ(reg);
+                }
+                else if (info.kind == ORA || info.kind == AND || info.kind == EOR)
+                {
+                    const AluOp op = info.kind == ORA ? OP_OR : info.kind == AND ? OP_AND : OP_XOR;
+                    m_emit.alu(op, REGISTERS[0], RCX);
+                    setNZ(REGISTERS[0]);
+                }
+                else if (info.kind == ADC || info.kind == SBC)
+                {
+                    if (info.kind == SBC)
+                    {
+                        m_emit.alu(EXT_XOR, RCX, 0xFF);
+                    }
+
+                    adc();
+                }
+                else if (info.kind == COMPARE)
+                {
+                    m_emit.alu(OP_CMP, reg, RCX);
+                    m_emit.set(CC_AE, R11);
+                    setCarry(R11);
+                    m_emit.alu(OP_MOV, RAX, reg);
+                    m_emit.alu(OP_SUB, RAX, RCX);
+                    setNZ(RAX);
+                }
+                else
+                {
+                    // N and V come from the operand, Z from A & operand.
+                    m_emit.storeByte(STATE, OFFSET_NEGATIVE, RCX);
+                    m_emit.aluByte(EXT_AND, STATE, OFFSET_P, static_cast<uint8_t>(~nemus::comp::FLAG_OVERFLOW));
+                    m_emit.alu(OP_MOV, RAX, RCX);
+                    m_emit.alu(EXT_AND, RAX, nemus::comp::FLAG_OVERFLOW);
+                    m_emit.orByte(STATE, OFFSET_P, RAX);
+                    m_emit.alu(OP_MOV, RAX, REGISTERS[0]);
+                    m_emit.alu(OP_AND, RAX, RCX);
+                    m_emit.storeByte(STATE, OFFSET_ZERO, RAX);
+                }
+                break;
+            case STORE:
+                compiled = writeOperand(info.mode, operand, reg);
+                if (compiled)
+                {
+                    addWrite(info.mode, operand);
+                }
+                break;
+            case INC:
+            case DEC:
+            case ASL:
+            case LSR:
+            case ROL:
+            case ROR:
+                if (info.mode == ACC)
+                {
+                    shift(info.kind, REGISTERS[0]);
+                    break;
+                }
+
+                compiled = ramAddress(info.mode, operand);
+                if (compiled)
+                {
+                    m_emit.loadByte(RCX, RAM, RBX);
+                    shift(info.kind, RCX);
+                    m_emit.storeByte(RAM, RBX, RCX);
+                    addWrite(info.mode, operand);
+                }
+                break;
+            case TRANSFER:
+                m_emit.alu(OP_MOV, REGISTERS[info.arg], reg);
+                setNZ(REGISTERS[info.arg]);
+                break;
+            case INCREMENT:
+                shift(INC, reg);
+                break;
+            case DECREMENT:
+                shift(DEC, reg);
+                break;
+            case TXS:
+                m_emit.storeByte(STATE, OFFSET_SP, REGISTERS[1]);
+                break;
+            case TSX:
+                m_emit.loadByte(REGISTERS[1], STATE, OFFSET_SP);
+                setNZ(REGISTERS[1]);
+                break;
+            case SET_FLAG:
+                m_emit.aluByte(EXT_OR, STATE, OFFSET_P, info.arg);
+                break;
+            case CLEAR_FLAG:
+                m_emit.aluByte(EXT_AND, STATE, OFFSET_P, static_cast<uint8_t>(~info.arg));
+                break;
+            case NOP:
+                break;
+            case BRANCH:
+                branch(info, address, static_cast<int8_t>(operand), base);
+                ends = true;
+                break;
+            case JUMP:
+                // Only a loop where the block is mapped at the address it
+                // was compiled for.
+                if (operand == address)
+                {
+                    m_emit.compareWord(STATE, OFFSET_PC, operand);
+                    const std::size_t elsewhere = m_emit.jump(CC_NE);
+                    loop(m_cycles + base, m_cycles + base + m_extra);
+                    m_emit.patch(elsewhere);
+                }
+
+                exit(operand, m_cycles + base, m_instructions + 1, true);
+                ends = true;
+                break;
+            default:
+                compiled = false;
+                break;
+            }
+
+            if (!compiled)
+            {
+                m_emit.truncate(mark);
+                m_bails.resize(bailMark);
+                return false;
+            }
+
+            m_offset += size;
+            m_cycles += base;
+            m_instructions++;
+
+            return true;
+        }
+    };
+}
+#endif
+
+nemus::core::Jit::Jit(const int *cycles) : m_cycles(cycles)
+{
+#ifdef NEMUS_JIT_X86_64
+    void *buffer = mmap(nullptr, CODE_BUFFER_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (buffer != MAP_FAILED)
+    {
+        m_buffer = static_cast<unsigned char *>(buffer);
+    }
+#endif
+}
+
+nemus::core::Jit::~Jit()
+{
+#ifdef NEMUS_JIT_X86_64
+    if (m_buffer != nullptr)
+    {
+        munmap(m_buffer, CODE_BUFFER_SIZE);
+    }
+#endif
+}
+
+bool nemus::core::Jit::isAvailable()
+{
+#ifdef NEMUS_JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+nemus::core::Jit::Function nemus::core::Jit::compile(const unsigned char *code, uint16_t address,
+                                                     unsigned int length, unsigned int &maxCycles,
+                                                     PageMask &writes)
+{
+#ifdef NEMUS_JIT_X86_64
+    if (m_buffer == nullptr)
+    {
+        return nullptr;
+    }
+
+    m_code.clear();
+
+    BlockCompiler compiler(m_code);
+    compiler.prologue();
+
+    // Like the interpreter's blocks, compiled code stays in its page.
+    const unsigned int end = CPU_PAGE_SIZE - address % CPU_PAGE_SIZE;
+    unsigned int offset = 0;
+    bool ends = false;
+
+    while (!ends && compiler.getInstructions() < length)
+    {
+        const unsigned int op = code[offset];
+        const unsigned int size = getSize(s_ops[op].mode);
+        if (offset + size > end ||
+            !compiler.instruction(code + offset, address, m_cycles[op], ends))
+        {
+            break;
+        }
+
+        offset += size;
+    }
+
+    if (compiler.getInstructions() < MIN_INSTRUCTIONS)
+    {
+        return nullptr;
+    }
+
+    if (!ends)
+    {
+        compiler.exitCurrent();
+    }
+
+    compiler.bails();
+
+    maxCycles = compiler.getMaxCycles();
+    writes = compiler.getWrites();
+
+    // Starting over frees every earlier function, which callers notice
+    // through the generation.
+    const std::size_t start = (m_used + 15) & ~static_cast<std::size_t>(15);
+    std::size_t position = start;
+    if (start + m_code.size() > CODE_BUFFER_SIZE)
+    {
+        position = 0;
+        m_generation++;
+    }
+
+    mprotect(m_buffer, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE);
+    std::memcpy(m_buffer + position, m_code.data(), m_code.size());
+    mprotect(m_buffer, CODE_BUFFER_SIZE, PROT_READ | PROT_EXEC);
+
+    m_used = position + m_code.size();
+
+    return reinterpret_cast<Function>(m_buffer + position);
+#else
+    return nullptr;
+#endif
+}
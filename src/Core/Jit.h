@@ -0,0 +1,86 @@
+#ifndef NEMUS_JIT_H
+#define NEMUS_JIT_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ComponentHelper.h"
+
+namespace nemus::core
+{
+    // CPU state handed to compiled code. Generated code addresses the
+    // fields by offset, so this must stay standard layout.
+    struct JitState
+    {
+        comp::Registers reg;
+        uint8_t negative;
+        uint8_t zero;
+        // Instructions the compiled code ran before returning.
+        uint32_t instructions;
+        // Cycles available. A block that loops onto itself only starts
+        // another pass while its worst case stays below this.
+        uint32_t budget;
+        unsigned char *ram;
+        unsigned char *const *readPages;
+        unsigned char *const *writePages;
+    };
+
+    // Translates straight-line 6502 code in PRG-ROM into x86-64 code.
+    // Only loads, stores, ALU operations and flag changes on mapped memory
+    // are compiled; a block ends before anything else and hands over to
+    // the interpreter. An access to a page without memory behind it (the
+    // I/O registers) returns before the instruction, so the interpreter
+    // repeats it through Memory. A branch back to the start of the block
+    // loops inside the compiled code. Compiled code returns the cycles it
+    // ran and leaves PC at the next instruction to execute.
+    class Jit
+    {
+    public:
+        using Function = unsigned int (*)(JitState *state);
+
+        // One bit per 256-byte CPU page.
+        using PageMask = std::bitset<0x100>;
+
+        // cycles is the CPU's base cycle count per opcode.
+        explicit Jit(const int *cycles);
+
+        ~Jit();
+
+        Jit(const Jit &) = delete;
+
+        Jit &operator=(const Jit &) = delete;
+
+        // False on hosts other than x86-64 Linux, where compile() always
+        // fails and the CPU keeps interpreting.
+        static bool isAvailable();
+
+        // Compiles up to length instructions from code, which is mapped at
+        // address, stopping at the end of its 256-byte page. The code only
+        // depends on where address sits in its page, so it runs wherever
+        // the bank is mapped. maxCycles receives the most cycles the
+        // function can take and writes the pages it can store to. Returns
+        // nullptr when nothing worth running natively was found.
+        Function compile(const unsigned char *code, uint16_t address, unsigned int length, unsigned int &maxCycles,
+                         PageMask &writes);
+
+        // Changes when the code buffer fills up and is reused, which frees
+        // every function compiled before.
+        uint32_t getGeneration() { return m_generation; }
+
+    private:
+        const int *m_cycles;
+
+        unsigned char *m_buffer = nullptr;
+
+        std::size_t m_used = 0;
+
+        uint32_t m_generation = 0;
+
+        // Code is assembled here and copied to m_buffer when complete.
+        std::vector<unsigned char> m_code;
+    };
+}
+
+#endif
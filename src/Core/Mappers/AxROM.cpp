@@ -0,0 +1,37 @@
+#include "AxROM.h"
+#include "MapperRegistry.h"
+
+NEMUS_REGISTER_MAPPER(7, "AxROM", AxROM)
+
+nemus::core::AxROM::AxROM(std::shared_ptr<const Cartridge> cartridge) : BankedMapper(std::move(cartridge))
+{
+    setCHRBank(0x0000, 0x2000, 0);
+    updateBanks();
+}
+
+void nemus::core::AxROM::writeRegister(unsigned char data, unsigned int)
+{
+    m_register = data;
+
+    updateBanks();
+}
+
+void nemus::core::AxROM::updateBanks()
+{
+    setPRGBank(0x8000, 0x8000, m_register & 0x07);
+    setMirroring(m_register & 0x10 ? MIRROR_OS_UPPER : MIRROR_OS_LOWER);
+}
+
+void nemus::core::AxROM::saveState(StateWriter &state)
+{
+    BankedMapper::saveState(state);
+
+    state.write(m_register);
+}
+
+void nemus::core::AxROM::loadState(StateReader &state)
+{
+    BankedMapper::loadState(state);
+
+    state.read(m_register);
+}
@@ -0,0 +1,34 @@
+#ifndef NEMUS_AXROM_H
+#define NEMUS_AXROM_H
+
+#include <cstdint>
+#include <memory>
+
+#include "BankedMapper.h"
+
+namespace nemus::core
+{
+
+    // Nintendo AxROM: one switchable 32 KB PRG bank, CHR-RAM and a
+    // register-selected single-screen nametable.
+    class AxROM : public BankedMapper
+    {
+    private:
+        uint8_t m_register = 0;
+
+        void updateBanks();
+
+    protected:
+        void writeRegister(unsigned char data, unsigned int address) override;
+
+    public:
+        explicit AxROM(std::shared_ptr<const Cartridge> cartridge);
+
+        void saveState(StateWriter &state) override;
+
+        void loadState(StateReader &state) override;
+    };
+
+}
+
+#endif
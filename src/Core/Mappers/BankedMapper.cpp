@@ -0,0 +1,240 @@
+#include <algorithm>
+
+#include "BankedMapper.h"
+
+namespace
+{
+    // Window index of the size-byte bank number bank in memory holding
+    // count windows of window bytes.
+    uint32_t getWindow(int bank, unsigned int size, unsigned int window, std::size_t count)
+    {
+        const long banks = std::max<long>(static_cast<long>(count * window / size), 1);
+        long index = bank % banks;
+
+        if (index < 0)
+        {
+            index += banks;
+        }
+
+        return static_cast<uint32_t>(index * (size / window));
+    }
+}
+
+nemus::core::BankedMapper::BankedMapper(std::shared_ptr<const Cartridge> cartridge)
+    : m_cartridge(std::move(cartridge)), m_prgRam(PRG_RAM_SIZE, 0)
+{
+    if (m_cartridge->getCHRSize() == 0)
+    {
+        m_chrRam.assign(CHR_RAM_SIZE, 0);
+    }
+
+    for (unsigned int i = 0; i < m_prgBanks.size(); i++)
+    {
+        m_prgBanks[i] = i;
+    }
+
+    for (unsigned int i = 0; i < m_chrBanks.size(); i++)
+    {
+        m_chrBanks[i] = i;
+    }
+
+    if (m_cartridge->hasFourScreen())
+    {
+        m_mirroring = MIRROR_FOUR_SCREEN;
+    }
+    else
+    {
+        m_mirroring = m_cartridge->hasVerticalMirroring() ? MIRROR_VERTICAL : MIRROR_HORIZONTAL;
+    }
+
+    updatePages();
+}
+
+const unsigned char *nemus::core::BankedMapper::getCHRMemory()
+{
+    return m_chrRam.empty() ? m_cartridge->getCHR() : m_chrRam.data();
+}
+
+std::size_t nemus::core::BankedMapper::getCHRSize()
+{
+    return m_chrRam.empty() ? m_cartridge->getCHRSize() : m_chrRam.size();
+}
+
+void nemus::core::BankedMapper::updatePages()
+{
+    const std::size_t prgWindows = m_cartridge->getPRGSize() / PRG_WINDOW_SIZE;
+    const std::size_t chrWindows = getCHRSize() / CHR_WINDOW_SIZE;
+
+    // Banks restored from a state may not fit this cartridge.
+    for (unsigned int i = 0; i < m_prgBanks.size(); i++)
+    {
+        m_prgPages[i] = m_cartridge->getPRG() + (m_prgBanks[i] % prgWindows) * PRG_WINDOW_SIZE;
+    }
+
+    for (unsigned int i = 0; i < m_chrBanks.size(); i++)
+    {
+        m_chrPages[i] = getCHRMemory() + (m_chrBanks[i] % chrWindows) * CHR_WINDOW_SIZE;
+    }
+
+    unsigned char *tables = m_nametables.data();
+
+    switch (m_mirroring)
+    {
+    case MIRROR_VERTICAL:
+        m_nametablePages = {tables, tables + 0x400, tables, tables + 0x400};
+        break;
+    case MIRROR_OS_LOWER:
+        m_nametablePages = {tables, tables, tables, tables};
+        break;
+    case MIRROR_OS_UPPER:
+        m_nametablePages = {tables + 0x400, tables + 0x400, tables + 0x400, tables + 0x400};
+        break;
+    case MIRROR_FOUR_SCREEN:
+        m_nametablePages = {tables, tables + 0x400, tables + 0x800, tables + 0xC00};
+        break;
+    default:
+        m_nametablePages = {tables, tables, tables + 0x400, tables + 0x400};
+        break;
+    }
+
+    mapPages();
+}
+
+void nemus::core::BankedMapper::setPRGBank(unsigned int address, unsigned int size, int bank)
+{
+    const std::size_t windows = m_cartridge->getPRGSize() / PRG_WINDOW_SIZE;
+    const uint32_t window = getWindow(bank, size, PRG_WINDOW_SIZE, windows);
+    const unsigned int first = (address - 0x8000) / PRG_WINDOW_SIZE;
+
+    // A bank larger than the whole ROM repeats it.
+    for (unsigned int i = 0; i < size / PRG_WINDOW_SIZE; i++)
+    {
+        m_prgBanks[first + i] = (window + i) % windows;
+        m_prgPages[first + i] = m_cartridge->getPRG() + m_prgBanks[first + i] * PRG_WINDOW_SIZE;
+    }
+
+    mapPages();
+}
+
+void nemus::core::BankedMapper::setCHRBank(unsigned int address, unsigned int size, int bank)
+{
+    const std::size_t windows = getCHRSize() / CHR_WINDOW_SIZE;
+    const uint32_t window = getWindow(bank, size, CHR_WINDOW_SIZE, windows);
+    const unsigned int first = address / CHR_WINDOW_SIZE;
+
+    for (unsigned int i = 0; i < size / CHR_WINDOW_SIZE; i++)
+    {
+        m_chrBanks[first + i] = (window + i) % windows;
+        m_chrPages[first + i] = getCHRMemory() + m_chrBanks[first + i] * CHR_WINDOW_SIZE;
+    }
+}
+
+void nemus::core::BankedMapper::setMirroring(int mirroring)
+{
+    if (mirroring != m_mirroring)
+    {
+        m_mirroring = mirroring;
+        updatePages();
+    }
+}
+
+void nemus::core::BankedMapper::mapPages()
+{
+    mapCPU(0x6000, PRG_RAM_SIZE, m_prgRam.data(), true);
+
+    for (unsigned int i = 0; i < m_prgPages.size(); i++)
+    {
+        mapCPU(0x8000 + i * PRG_WINDOW_SIZE, PRG_WINDOW_SIZE, m_prgPages[i]);
+    }
+}
+
+unsigned char nemus::core::BankedMapper::readByte(unsigned int address)
+{
+    if (address < 0x8000)
+    {
+        return m_prgRam[(address - 0x6000) % PRG_RAM_SIZE];
+    }
+
+    return m_prgPages[(address - 0x8000) / PRG_WINDOW_SIZE][address % PRG_WINDOW_SIZE];
+}
+
+void nemus::core::BankedMapper::writeByte(unsigned char data, unsigned int address)
+{
+    if (address < 0x8000)
+    {
+        m_prgRam[(address - 0x6000) % PRG_RAM_SIZE] = data;
+    }
+    else
+    {
+        writeRegister(data, address);
+    }
+}
+
+unsigned char nemus::core::BankedMapper::readBytePPU(unsigned int address)
+{
+    address &= 0x3FFF;
+
+    if (address < 0x2000)
+    {
+        return m_chrPages[address / CHR_WINDOW_SIZE][address % CHR_WINDOW_SIZE];
+    }
+
+    if (address < 0x3F00)
+    {
+        return getNametableByte(address);
+    }
+
+    return getPaletteByte(address);
+}
+
+void nemus::core::BankedMapper::writeBytePPU(unsigned char data, unsigned int address)
+{
+    address &= 0x3FFF;
+
+    if (address < 0x2000)
+    {
+        // CHR-ROM ignores writes. With CHR-RAM the pages point into
+        // m_chrRam, which is ours to write.
+        if (!m_chrRam.empty())
+        {
+            const_cast<unsigned char *>(m_chrPages[address / CHR_WINDOW_SIZE])[address % CHR_WINDOW_SIZE] = data;
+        }
+    }
+    else if (address < 0x3F00)
+    {
+        getNametableByte(address) = data;
+    }
+    else
+    {
+        getPaletteByte(address) = data;
+    }
+}
+
+void nemus::core::BankedMapper::loadSaveRam(const char *data, std::size_t size)
+{
+    std::copy_n(data, std::min(size, m_prgRam.size()), m_prgRam.begin());
+}
+
+void nemus::core::BankedMapper::saveState(StateWriter &state)
+{
+    state.write(m_prgRam.data(), m_prgRam.size());
+    state.write(m_chrRam.data(), m_chrRam.size());
+    state.write(m_nametables);
+    state.write(m_palette);
+    state.write(m_prgBanks);
+    state.write(m_chrBanks);
+    state.write(m_mirroring);
+}
+
+void nemus::core::BankedMapper::loadState(StateReader &state)
+{
+    state.read(m_prgRam.data(), m_prgRam.size());
+    state.read(m_chrRam.data(), m_chrRam.size());
+    state.read(m_nametables);
+    state.read(m_palette);
+    state.read(m_prgBanks);
+    state.read(m_chrBanks);
+    state.read(m_mirroring);
+
+    updatePages();
+}
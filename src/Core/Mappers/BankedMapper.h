@@ -0,0 +1,114 @@
+#ifndef NEMUS_BANKEDMAPPER_H
+#define NEMUS_BANKEDMAPPER_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Mapper.h"
+#include "../Cartridge.h"
+
+// Granularity of the PRG and CHR windows. Mappers with larger banks
+// switch several windows at once.
+#define PRG_WINDOW_SIZE 0x2000
+#define CHR_WINDOW_SIZE 0x400
+
+#define PRG_RAM_SIZE 0x2000
+#define CHR_RAM_SIZE 0x2000
+
+namespace nemus::core
+{
+    // Shared base of mappers that switch fixed-size banks. The four PRG
+    // windows at $8000-$FFFF and eight CHR windows at $0000-$1FFF are
+    // pointers into the shared Cartridge, so switching a bank only moves
+    // pointers and no ROM data is copied per console. Boards without
+    // CHR-ROM get CHR-RAM, and 8 KB of PRG-RAM sits at $6000.
+    //
+    // Subclasses decode their registers in writeRegister() and call
+    // setPRGBank()/setCHRBank()/setMirroring(). Their own state goes after
+    // the base's in saveState()/loadState().
+    class BankedMapper : public Mapper
+    {
+    private:
+        std::shared_ptr<const Cartridge> m_cartridge;
+
+        std::vector<unsigned char> m_prgRam;
+
+        // Replaces CHR-ROM on boards that have none; empty otherwise.
+        std::vector<unsigned char> m_chrRam;
+
+        // Two nametables of console VRAM, plus two more on four-screen boards.
+        std::array<unsigned char, 0x1000> m_nametables{};
+
+        std::array<unsigned char, 0x20> m_palette{};
+
+        // Selected banks in window units, which is what gets saved; the
+        // page pointers are derived from them.
+        std::array<uint32_t, 4> m_prgBanks{};
+        std::array<uint32_t, 8> m_chrBanks{};
+
+        int m_mirroring = MIRROR_HORIZONTAL;
+
+        std::array<const unsigned char *, 4> m_prgPages{};
+        std::array<const unsigned char *, 8> m_chrPages{};
+        std::array<unsigned char *, 4> m_nametablePages{};
+
+        const unsigned char *getCHRMemory();
+
+        std::size_t getCHRSize();
+
+        void updatePages();
+
+        unsigned char &getNametableByte(unsigned int address)
+        {
+            return m_nametablePages[(address >> 10) & 3][address & 0x3FF];
+        }
+
+        unsigned char &getPaletteByte(unsigned int address)
+        {
+            // The backdrop entries of the sprite palettes mirror the
+            // background ones.
+            address &= 0x1F;
+            return m_palette[(address & 0x13) == 0x10 ? address & 0x0F : address];
+        }
+
+    protected:
+        // Maps the size bytes at address to bank, counted in units of size.
+        // Negative banks count back from the last one and banks past the end
+        // wrap around, as the unconnected high bank lines do on real boards.
+        void setPRGBank(unsigned int address, unsigned int size, int bank);
+
+        void setCHRBank(unsigned int address, unsigned int size, int bank);
+
+        void setMirroring(int mirroring);
+
+        const Cartridge &getCartridge() { return *m_cartridge; }
+
+        // Called for CPU writes to $8000-$FFFF.
+        virtual void writeRegister(unsigned char data, unsigned int address) = 0;
+
+        void mapPages() override;
+
+    public:
+        explicit BankedMapper(std::shared_ptr<const Cartridge> cartridge);
+
+        unsigned char readByte(unsigned int address) override;
+
+        unsigned char readBytePPU(unsigned int address) override;
+
+        void writeByte(unsigned char data, unsigned int address) override;
+
+        void writeBytePPU(unsigned char data, unsigned int address) override;
+
+        int getMirroring() override { return m_mirroring; }
+
+        void loadSaveRam(const char *data, std::size_t size) override;
+
+        void saveState(StateWriter &state) override;
+
+        void loadState(StateReader &state) override;
+    };
+}
+
+#endif
@@ -0,0 +1,32 @@
+#include "CNROM.h"
+#include "MapperRegistry.h"
+
+NEMUS_REGISTER_MAPPER(3, "CNROM", CNROM)
+
+nemus::core::CNROM::CNROM(std::shared_ptr<const Cartridge> cartridge) : BankedMapper(std::move(cartridge))
+{
+    setPRGBank(0x8000, 0x4000, 0);
+    setPRGBank(0xC000, 0x4000, -1);
+    setCHRBank(0x0000, 0x2000, 0);
+}
+
+void nemus::core::CNROM::writeRegister(unsigned char data, unsigned int)
+{
+    m_chrBank = data;
+
+    setCHRBank(0x0000, 0x2000, m_chrBank);
+}
+
+void nemus::core::CNROM::saveState(StateWriter &state)
+{
+    BankedMapper::saveState(state);
+
+    state.write(m_chrBank);
+}
+
+void nemus::core::CNROM::loadState(StateReader &state)
+{
+    BankedMapper::loadState(state);
+
+    state.read(m_chrBank);
+}
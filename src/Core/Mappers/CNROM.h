@@ -0,0 +1,31 @@
+#ifndef NEMUS_CNROM_H
+#define NEMUS_CNROM_H
+
+#include <cstdint>
+#include <memory>
+
+#include "BankedMapper.h"
+
+namespace nemus::core
+{
+
+    // Nintendo CNROM: fixed PRG like NROM and a switchable 8 KB CHR bank.
+    class CNROM : public BankedMapper
+    {
+    private:
+        uint8_t m_chrBank = 0;
+
+    protected:
+        void writeRegister(unsigned char data, unsigned int address) override;
+
+    public:
+        explicit CNROM(std::shared_ptr<const Cartridge> cartridge);
+
+        void saveState(StateWriter &state) override;
+
+        void loadState(StateReader &state) override;
+    };
+
+}
+
+#endif
@@ -1,73 +1,42 @@
 #ifndef NEMUS_MMC1_H
 #define NEMUS_MMC1_H
 
-#include <vector>
+#include <cstdint>
+#include <memory>
 
-#include "Mapper.h"
+#include "BankedMapper.h"
 
 namespace nemus::core
 {
 
-    class MMC1 : public Mapper
+    // Nintendo SxROM boards. Registers are loaded a bit at a time through
+    // a serial shift register at $8000-$FFFF.
+    class MMC1 : public BankedMapper
     {
     private:
-        unsigned char *m_CPUMemory;
+        // Starts with a marker bit at bit 4; a write that shifts the marker
+        // out of bit 0 completes the register.
+        uint8_t m_shiftRegister = 0x10;
 
-        unsigned char *m_PPUMemory;
+        uint8_t m_control = 0x0C;
 
-        unsigned char *m_tableA;
-        unsigned char *m_tableB;
-        unsigned char *m_tableC;
-        unsigned char *m_tableD;
-
-        int m_prgBank0;
-        int m_prgBank1;
-        int m_chrBank0;
-        int m_chrBank1;
-
-        int m_maxPrgBanks;
-
-        unsigned char m_shiftRegister = 0x10;
-
-        struct
-        {
-            int chr_mode;
-            int prg_mode;
-            int mirroring;
-        } m_control;
-
-        unsigned char m_prgBank;
-        unsigned char m_chrBank;
-
-        void adjustShiftRegister(unsigned char data, unsigned int address);
-
-        void writeControl();
-        void writeCHRBank0();
-        void writeCHRBank1();
-        void writePRGBank();
+        uint8_t m_chrBank0 = 0;
+        uint8_t m_chrBank1 = 0;
+        uint8_t m_prgBank = 0;
 
         void updateBanks();
 
-        unsigned getMirroringTable(unsigned address);
-        void writeNametable(unsigned char data, unsigned address);
-        unsigned char readNametable(unsigned address);
+    protected:
+        void writeRegister(unsigned char data, unsigned int address) override;
 
     public:
-        MMC1(const std::vector<char> &gameData);
-        MMC1(const std::vector<char> &gameData, char *savStart, long savSize);
-        ~MMC1();
-
-        unsigned char readByte(unsigned int address) override;
-
-        unsigned char readBytePPU(unsigned int address) override;
-
-        void writeByte(unsigned char data, unsigned int address) override;
+        explicit MMC1(std::shared_ptr<const Cartridge> cartridge);
 
-        void writeBytePPU(unsigned char data, unsigned int address) override;
+        void saveState(StateWriter &state) override;
 
-        int getMirroring() override { return m_control.mirroring; };
+        void loadState(StateReader &state) override;
     };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,142 @@
+#include "MMC3.h"
+#include "MapperRegistry.h"
+#include "../CPU.h"
+
+NEMUS_REGISTER_MAPPER(4, "MMC3", MMC3)
+
+nemus::core::MMC3::MMC3(std::shared_ptr<const Cartridge> cartridge) : BankedMapper(std::move(cartridge))
+{
+    updateBanks();
+}
+
+void nemus::core::MMC3::writeRegister(unsigned char data, unsigned int address)
+{
+    const bool odd = address & 1;
+
+    switch (address & 0xE000)
+    {
+    case 0x8000:
+        if (odd)
+        {
+            m_registers[m_bankSelect & 7] = data;
+        }
+        else
+        {
+            m_bankSelect = data;
+        }
+
+        updateBanks();
+        break;
+    case 0xA000:
+        // Odd writes protect PRG-RAM, which is left writable.
+        if (!odd && getMirroring() != MIRROR_FOUR_SCREEN)
+        {
+            setMirroring(data & 1 ? MIRROR_HORIZONTAL : MIRROR_VERTICAL);
+        }
+        break;
+    case 0xC000:
+        if (odd)
+        {
+            m_irqCounter = 0;
+            m_irqReload = true;
+        }
+        else
+        {
+            m_irqLatch = data;
+        }
+        break;
+    case 0xE000:
+        m_irqEnabled = odd;
+
+        if (!odd)
+        {
+            getCPU()->setIrq(comp::IRQ_MAPPER, false);
+        }
+        break;
+    }
+}
+
+void nemus::core::MMC3::updateBanks()
+{
+    const unsigned int chrInvert = (m_bankSelect & 0x80) ? 0x1000 : 0;
+
+    // R0 and R1 select 2 KB banks and ignore their low bit.
+    setCHRBank(0x0000 ^ chrInvert, 0x800, m_registers[0] >> 1);
+    setCHRBank(0x0800 ^ chrInvert, 0x800, m_registers[1] >> 1);
+    setCHRBank(0x1000 ^ chrInvert, 0x400, m_registers[2]);
+    setCHRBank(0x1400 ^ chrInvert, 0x400, m_registers[3]);
+    setCHRBank(0x1800 ^ chrInvert, 0x400, m_registers[4]);
+    setCHRBank(0x1C00 ^ chrInvert, 0x400, m_registers[5]);
+
+    if (m_bankSelect & 0x40)
+    {
+        setPRGBank(0x8000, 0x2000, -2);
+        setPRGBank(0xC000, 0x2000, m_registers[6]);
+    }
+    else
+    {
+        setPRGBank(0x8000, 0x2000, m_registers[6]);
+        setPRGBank(0xC000, 0x2000, -2);
+    }
+
+    setPRGBank(0xA000, 0x2000, m_registers[7]);
+    setPRGBank(0xE000, 0x2000, -1);
+}
+
+void nemus::core::MMC3::clockScanline()
+{
+    if (m_irqCounter == 0 || m_irqReload)
+    {
+        m_irqCounter = m_irqLatch;
+        m_irqReload = false;
+    }
+    else
+    {
+        m_irqCounter--;
+    }
+
+    if (m_irqCounter == 0 && m_irqEnabled)
+    {
+        getCPU()->setIrq(comp::IRQ_MAPPER, true);
+    }
+}
+
+unsigned int nemus::core::MMC3::getScanlinesUntilIrq()
+{
+    if (!m_irqEnabled)
+    {
+        return 0;
+    }
+
+    // A reload takes one clock and counts down from the latch after that.
+    if (m_irqCounter == 0 || m_irqReload)
+    {
+        return 1 + m_irqLatch;
+    }
+
+    return m_irqCounter;
+}
+
+void nemus::core::MMC3::saveState(StateWriter &state)
+{
+    BankedMapper::saveState(state);
+
+    state.write(m_bankSelect);
+    state.write(m_registers);
+    state.write(m_irqLatch);
+    state.write(m_irqCounter);
+    state.write(m_irqReload);
+    state.write(m_irqEnabled);
+}
+
+void nemus::core::MMC3::loadState(StateReader &state)
+{
+    BankedMapper::loadState(state);
+
+    state.read(m_bankSelect);
+    state.read(m_registers);
+    state.read(m_irqLatch);
+    state.read(m_irqCounter);
+    state.read(m_irqReload);
+    state.read(m_irqEnabled);
+}
@@ -0,0 +1,49 @@
+#ifndef NEMUS_MMC3_H
+#define NEMUS_MMC3_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "BankedMapper.h"
+
+namespace nemus::core
+{
+
+    // Nintendo TxROM boards. Eight bank registers written through a select
+    // and data pair, plus a scanline counter clocked by PPU A12 that raises
+    // an IRQ when it reaches zero.
+    class MMC3 : public BankedMapper
+    {
+    private:
+        // Bit 6 swaps the fixed PRG bank, bit 7 inverts the CHR halves and
+        // the low bits pick the register $8001 writes.
+        uint8_t m_bankSelect = 0;
+
+        std::array<uint8_t, 8> m_registers = {0, 2, 4, 5, 6, 7, 0, 1};
+
+        uint8_t m_irqLatch = 0;
+        uint8_t m_irqCounter = 0;
+        bool m_irqReload = false;
+        bool m_irqEnabled = false;
+
+        void updateBanks();
+
+    protected:
+        void writeRegister(unsigned char data, unsigned int address) override;
+
+    public:
+        explicit MMC3(std::shared_ptr<const Cartridge> cartridge);
+
+        void clockScanline() override;
+
+        unsigned int getScanlinesUntilIrq() override;
+
+        void saveState(StateWriter &state) override;
+
+        void loadState(StateReader &state) override;
+    };
+
+}
+
+#endif
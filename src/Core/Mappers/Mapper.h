@@ -5,13 +5,72 @@
 #define MIRROR_VERTICAL   1
 #define MIRROR_OS_LOWER   2
 #define MIRROR_OS_UPPER   3
+#define MIRROR_FOUR_SCREEN 4
+
+#define CPU_PAGE_SIZE  0x100
+#define CPU_PAGE_COUNT 0x100
+
+#include <cstddef>
+
+#include "../State.h"
 
 namespace nemus::core {
 
+    class CPU;
+
     class Mapper {
+    private:
+        unsigned char **m_readPages = nullptr;
+        unsigned char **m_writePages = nullptr;
+
+        CPU *m_cpu = nullptr;
+
+    protected:
+        // For mappers that raise IRQs. Set before the game runs.
+        CPU *getCPU() { return m_cpu; }
+
+        // Points the CPU pages covering [address, address + size) at memory so
+        // the bus can access them without calling into the mapper. Pages that
+        // are not writable still send writes through writeByte().
+        void mapCPU(unsigned int address, unsigned int size, unsigned char *memory, bool writable)
+        {
+            if (m_readPages == nullptr)
+            {
+                return;
+            }
+
+            for (unsigned int offset = 0; offset < size; offset += CPU_PAGE_SIZE)
+            {
+                unsigned int page = (address + offset) / CPU_PAGE_SIZE;
+                m_readPages[page] = memory + offset;
+                m_writePages[page] = writable ? memory + offset : nullptr;
+            }
+        }
+
+        // Maps read-only memory such as PRG-ROM. Its pages are never written
+        // through, so the cast is never acted on.
+        void mapCPU(unsigned int address, unsigned int size, const unsigned char *memory)
+        {
+            mapCPU(address, size, const_cast<unsigned char *>(memory), false);
+        }
+
+        // Maps the current banks with mapCPU(). Called when the page table is
+        // attached and whenever the mapper switches PRG banks.
+        virtual void mapPages() = 0;
+
     public:
         virtual ~Mapper() = default;
 
+        void setPageTable(unsigned char **readPages, unsigned char **writePages)
+        {
+            m_readPages = readPages;
+            m_writePages = writePages;
+
+            mapPages();
+        }
+
+        void setCPU(CPU *cpu) { m_cpu = cpu; }
+
         virtual unsigned char readByte(unsigned int address) = 0;
 
         virtual unsigned char readBytePPU(unsigned int address) = 0;
@@ -21,8 +80,27 @@ namespace nemus::core {
         virtual void writeBytePPU(unsigned char data, unsigned int address) = 0;
 
         virtual int getMirroring() = 0;
+
+        // Scanline counters such as MMC3's count rising edges of PPU A12.
+        // The PPU calls this once per rendered scanline on which its
+        // pattern fetches raise A12.
+        virtual void clockScanline() {}
+
+        // How many more clockScanline() calls until the mapper asserts its
+        // IRQ, or 0 if it will not. The PPU schedules the IRQ as an event
+        // from this instead of stopping the CPU at every scanline.
+        virtual unsigned int getScanlinesUntilIrq() { return 0; }
+
+        // Restores battery-backed RAM from a save file.
+        virtual void loadSaveRam(const char *, std::size_t) {}
+
+        // Saves everything that can change at runtime: RAM, CHR memory,
+        // nametables and bank registers. Loading remaps the CPU pages.
+        virtual void saveState(StateWriter &state) = 0;
+
+        virtual void loadState(StateReader &state) = 0;
     };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,33 @@
+#include "MapperRegistry.h"
+#include "../Cartridge.h"
+
+std::unordered_map<unsigned int, nemus::core::MapperRegistry::Entry> &nemus::core::MapperRegistry::getEntries()
+{
+    static std::unordered_map<unsigned int, Entry> entries;
+    return entries;
+}
+
+bool nemus::core::MapperRegistry::add(unsigned int number, const char *name, Factory factory)
+{
+    getEntries().emplace(number, Entry{name, factory});
+    return true;
+}
+
+std::unique_ptr<nemus::core::Mapper> nemus::core::MapperRegistry::create(std::shared_ptr<const Cartridge> cartridge)
+{
+    const auto entry = getEntries().find(cartridge->getMapperNumber());
+
+    if (entry == getEntries().end())
+    {
+        return nullptr;
+    }
+
+    return entry->second.factory(std::move(cartridge));
+}
+
+const char *nemus::core::MapperRegistry::getName(unsigned int number)
+{
+    const auto entry = getEntries().find(number);
+
+    return entry != getEntries().end() ? entry->second.name : nullptr;
+}
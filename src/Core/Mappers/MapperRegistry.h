@@ -0,0 +1,56 @@
+#ifndef NEMUS_MAPPERREGISTRY_H
+#define NEMUS_MAPPERREGISTRY_H
+
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+#include "Mapper.h"
+
+namespace nemus::core
+{
+    class Cartridge;
+
+    // Mapper factories by iNES / NES 2.0 mapper number. Each mapper's source
+    // file registers itself with NEMUS_REGISTER_MAPPER during static
+    // initialization, so adding a mapper touches no other file.
+    class MapperRegistry
+    {
+    public:
+        using Factory = std::unique_ptr<Mapper> (*)(std::shared_ptr<const Cartridge> cartridge);
+
+    private:
+        struct Entry
+        {
+            const char *name;
+            Factory factory;
+        };
+
+        // A function-local static, so registrations from other translation
+        // units never run before it is constructed.
+        static std::unordered_map<unsigned int, Entry> &getEntries();
+
+    public:
+        // Returns true so it can initialize a static. A number registered
+        // twice keeps its first factory.
+        static bool add(unsigned int number, const char *name, Factory factory);
+
+        // The mapper for the cartridge's mapper number, or nullptr if none is
+        // registered.
+        static std::unique_ptr<Mapper> create(std::shared_ptr<const Cartridge> cartridge);
+
+        // nullptr for unregistered numbers.
+        static const char *getName(unsigned int number);
+    };
+}
+
+#define NEMUS_REGISTER_MAPPER(number, name, type)                                                            \
+    namespace                                                                                                \
+    {                                                                                                        \
+        const bool registered##type = nemus::core::MapperRegistry::add(                                      \
+            number, name, [](std::shared_ptr<const nemus::core::Cartridge> cartridge) -> std::unique_ptr<nemus::core::Mapper> { \
+                return std::make_unique<nemus::core::type>(std::move(cartridge));                            \
+            });                                                                                              \
+    }
+
+#endif
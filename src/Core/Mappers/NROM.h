@@ -1,42 +1,22 @@
 #ifndef NEMUS_NROM_H
 #define NEMUS_NROM_H
 
-#include <vector>
+#include <memory>
 
-#include "Mapper.h"
+#include "BankedMapper.h"
 
 namespace nemus::core
 {
 
-    class NROM : public Mapper
+    // No bank switching: 16 or 32 KB of PRG-ROM, the smaller size mirrored
+    // into both halves, and 8 KB of CHR.
+    class NROM : public BankedMapper
     {
-    private:
-        unsigned char *m_fixedCPUMemory;
-
-        unsigned char *m_fixedPPUMemory;
-
-        unsigned char *m_tableA;
-        unsigned char *m_tableB;
-        unsigned char *m_tableC;
-        unsigned char *m_tableD;
-
-        int m_mirroring;
-
-        unsigned char *getMirroringTable(unsigned address);
+    protected:
+        void writeRegister(unsigned char, unsigned int) override {}
 
     public:
-        NROM(const std::vector<char> &romStart);
-        ~NROM();
-
-        unsigned char readByte(unsigned int address) override;
-
-        unsigned char readBytePPU(unsigned int address) override;
-
-        void writeByte(unsigned char data, unsigned int address) override;
-
-        void writeBytePPU(unsigned char data, unsigned int address) override;
-
-        int getMirroring() override { return m_mirroring; }
+        explicit NROM(std::shared_ptr<const Cartridge> cartridge);
     };
 
 }
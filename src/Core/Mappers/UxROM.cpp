@@ -0,0 +1,32 @@
+#include "UxROM.h"
+#include "MapperRegistry.h"
+
+NEMUS_REGISTER_MAPPER(2, "UxROM", UxROM)
+
+nemus::core::UxROM::UxROM(std::shared_ptr<const Cartridge> cartridge) : BankedMapper(std::move(cartridge))
+{
+    setPRGBank(0x8000, 0x4000, 0);
+    setPRGBank(0xC000, 0x4000, -1);
+    setCHRBank(0x0000, 0x2000, 0);
+}
+
+void nemus::core::UxROM::writeRegister(unsigned char data, unsigned int)
+{
+    m_prgBank = data;
+
+    setPRGBank(0x8000, 0x4000, m_prgBank);
+}
+
+void nemus::core::UxROM::saveState(StateWriter &state)
+{
+    BankedMapper::saveState(state);
+
+    state.write(m_prgBank);
+}
+
+void nemus::core::UxROM::loadState(StateReader &state)
+{
+    BankedMapper::loadState(state);
+
+    state.read(m_prgBank);
+}
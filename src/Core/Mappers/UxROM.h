@@ -0,0 +1,32 @@
+#ifndef NEMUS_UXROM_H
+#define NEMUS_UXROM_H
+
+#include <cstdint>
+#include <memory>
+
+#include "BankedMapper.h"
+
+namespace nemus::core
+{
+
+    // Nintendo UNROM and UOROM: a switchable 16 KB PRG bank at $8000 and
+    // the last bank fixed at $C000, usually with CHR-RAM.
+    class UxROM : public BankedMapper
+    {
+    private:
+        uint8_t m_prgBank = 0;
+
+    protected:
+        void writeRegister(unsigned char data, unsigned int address) override;
+
+    public:
+        explicit UxROM(std::shared_ptr<const Cartridge> cartridge);
+
+        void saveState(StateWriter &state) override;
+
+        void loadState(StateReader &state) override;
+    };
+
+}
+
+#endif
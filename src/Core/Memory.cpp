@@ -1,19 +1,30 @@
 #include <fstream>
 #include <cstring>
 #include "Memory.h"
+#include "Mappers/MapperRegistry.h"
 #include "Mappers/NROM.h"
-#include "Mappers/MMC1.h"
 
-nemus::core::Memory::Memory(debug::Logger *logger, core::PPU *ppu, core::Input *input,
-                            const std::vector<char> &gameData)
+nemus::core::Memory::Memory(debug::Logger *logger, core::PPU *ppu, core::APU *apu, core::Input *input,
+                            std::shared_ptr<const Cartridge> cartridge)
 {
     m_logger = logger;
     m_ppu = ppu;
+    m_apu = apu;
     m_input = input;
 
     m_ram = new unsigned char[0x10000];
 
-    loadRom(gameData);
+    m_readPages.fill(nullptr);
+    m_writePages.fill(nullptr);
+
+    // 2KB of internal RAM mirrored through $0000-$1FFF
+    for (unsigned int page = 0; page < 0x2000 / CPU_PAGE_SIZE; page++)
+    {
+        m_readPages[page] = m_ram + (page * CPU_PAGE_SIZE) % 0x800;
+        m_writePages[page] = m_readPages[page];
+    }
+
+    loadRom(std::move(cartridge));
 
     m_logger->write("Memory initialized");
 }
@@ -21,42 +32,38 @@ nemus::core::Memory::Memory(debug::Logger *logger, core::PPU *ppu, core::Input *
 nemus::core::Memory::~Memory()
 {
     delete[] m_ram;
-    delete m_mapper;
 }
 
-void nemus::core::Memory::loadRom(const std::vector<char> &gameData, const std::string &filename)
+void nemus::core::Memory::loadRom(std::shared_ptr<const Cartridge> cartridge, const std::string &filename)
 {
-    unsigned char mapperID = (gameData[6] >> 4) & 0xF;
-    mapperID |= (gameData[7] & 0xF0);
+    m_cartridge = std::move(cartridge);
+    m_mapper = MapperRegistry::create(m_cartridge);
 
-    // TODO: Add a mapper enum for easier implementation.
-    switch (mapperID)
+    if (m_mapper)
     {
-    case 0:
-        m_mapper = new NROM(gameData);
-        break;
-    case 1:
+        m_logger->write("Mapper " + std::to_string(m_cartridge->getMapperNumber()) + " (" +
+                        MapperRegistry::getName(m_cartridge->getMapperNumber()) + ")");
+    }
+    else
     {
-        int extOffset = filename.find('.');
-        FileInfo savFile = filename.length() > 0
-                               ? loadSaveFile(filename.substr(0, extOffset))
-                               : FileInfo{.start_of_file = 0, .size = 0};
+        m_logger->write("Unsupported mapper " + std::to_string(m_cartridge->getMapperNumber()) +
+                        "...using NROM and hoping for the best.");
+        m_mapper = std::make_unique<NROM>(m_cartridge);
+    }
+
+    if (m_cartridge->hasBattery() && filename.length() > 0)
+    {
+        FileInfo savFile = loadSaveFile(filename.substr(0, filename.find('.')));
 
         if (savFile.size > 0)
         {
-            m_mapper = new MMC1(gameData, savFile.start_of_file, savFile.size);
-        }
-        else
-        {
-            m_mapper = new MMC1(gameData);
+            m_mapper->loadSaveRam(savFile.start_of_file, savFile.size);
         }
-        break;
-    }
-    default:
-        m_logger->write("Invalid mapper id...using NROM and hoping for the best.");
-        m_mapper = new NROM(gameData);
-        break;
+
+        delete[] savFile.start_of_file;
     }
+
+    m_mapper->setPageTable(m_readPages.data(), m_writePages.data());
 }
 
 // TODO: extract this functionality to helper functions.
@@ -85,22 +92,27 @@ nemus::core::FileInfo nemus::core::Memory::loadSaveFile(std::string filename)
     return {savRam, size};
 }
 
-unsigned int nemus::core::Memory::readByte(unsigned int address)
+unsigned int nemus::core::Memory::readRegister(unsigned int address)
 {
-    address &= 0xFFFF;
-
     if (address < 0x2000)
     {
         return m_ram[address % 0x800];
     }
     else if (address < 0x4000)
     {
+        m_ppu->catchUp();
         return m_ppu->readPPU(0x2000 + (address % 8));
     }
     else if (address == 0x4014)
     {
+        m_ppu->catchUp();
         return m_ppu->readPPU(0x4014);
     }
+    else if (address == 0x4015)
+    {
+        m_apu->catchUp();
+        return m_apu->readStatus();
+    }
     else if (address == 0x4016)
     {
         return m_input->read();
@@ -116,80 +128,35 @@ unsigned int nemus::core::Memory::readByte(unsigned int address)
     }
 }
 
-unsigned int nemus::core::Memory::readByte(comp::Registers registers, comp::AddressMode addr)
-{
-    unsigned int address = 0;
-
-    switch (addr)
-    {
-    case comp::ADDR_MODE_IMMEDIATE:
-        return readByte(registers.pc + 1);
-    case comp::ADDR_MODE_ZERO_PAGE:
-        address = readByte(registers.pc + 1);
-        return readByte(address & 0xFF);
-    case comp::ADDR_MODE_ZERO_PAGE_X:
-        address = readByte(registers.pc + 1);
-        address += registers.x;
-        return readByte(address & 0xFF);
-    case comp::ADDR_MODE_ZERO_PAGE_Y:
-        address = readByte(registers.pc + 1);
-        address += registers.y;
-        return readByte(address & 0xFF);
-    case comp::ADDR_MODE_ABSOLUTE:
-        address = readWord(registers.pc + 1);
-        return readByte(address);
-    case comp::ADDR_MODE_ABSOLUTE_X:
-        address = readWord(registers.pc + 1) + registers.x;
-        return readByte(address);
-    case comp::ADDR_MODE_ABSOLUTE_Y:
-        address = readWord(registers.pc + 1) + registers.y;
-        return readByte(address);
-    case comp::ADDR_MODE_INDIRECT_X:
-        address = readByte(registers.pc + 1) + registers.x;
-        address &= 0xFF;
-        address = readWordBug(address);
-        return readByte(address);
-    case comp::ADDR_MODE_INDIRECT_Y:
-        address = readByte(registers.pc + 1);
-        address = readWordBug(address) + registers.y;
-        return readByte(address);
-    default:
-        m_logger->write("Unknown address mode!!!");
-        break;
-    }
-
-    return 0;
-}
-
-unsigned int nemus::core::Memory::readWordBug(unsigned int address)
+uint16_t nemus::core::Memory::readWordBug(uint16_t address)
 {
     // Hardware bug causes only low byte to be incremented across pages
-    unsigned int lowByte = readByte(address) & 0xFF;
-    unsigned int highByte = readByte((address & 0xFF00) + ((address + 1) & 0xFF)) & 0xFF;
+    const uint8_t lowByte = readByte(address);
+    const uint8_t highByte = readByte((address & 0xFF00) | static_cast<uint8_t>(address + 1));
     return highByte << 8 | lowByte;
 }
 
-unsigned int nemus::core::Memory::readWord(unsigned int address)
+uint16_t nemus::core::Memory::readWord(uint16_t address)
 {
-    unsigned int lowByte = readByte(address) & 0xFF;
-    unsigned int highByte = readByte(address + 1) & 0xFF;
+    const uint8_t lowByte = readByte(address);
+    const uint8_t highByte = readByte(address + 1);
     return highByte << 8 | lowByte;
 }
 
-bool nemus::core::Memory::writeByte(unsigned char data, unsigned int address)
+bool nemus::core::Memory::writeRegister(unsigned char data, unsigned int address)
 {
-    address &= 0xFFFF;
-
     if (address < 0x2000)
     {
         m_ram[address % 0x800] = data;
     }
     else if (address < 0x4000)
     {
+        m_ppu->catchUp();
         m_ppu->writePPU(data, 0x2000 + (address % 8));
     }
     else if (address == 0x4014)
     {
+        m_ppu->catchUp();
         m_ppu->writePPU(data, address);
     }
     else if (address == 0x4016)
@@ -198,12 +165,25 @@ bool nemus::core::Memory::writeByte(unsigned char data, unsigned int address)
     }
     else if (address < 0x4020)
     {
-        // TODO: Implement IO registers
-        return true;
+        m_apu->catchUp();
+        m_apu->writeRegister(data, address);
     }
     else if (address >= 0x6000)
     {
+        // Mapper registers can switch CHR banks and mirroring under the PPU,
+        // and move its scanline IRQ.
+        if (address >= 0x8000)
+        {
+            m_ppu->catchUp();
+            m_mapGeneration++;
+        }
+
         m_mapper->writeByte(data, address);
+
+        if (address >= 0x8000)
+        {
+            m_ppu->reschedule();
+        }
     }
     else
     {
@@ -214,55 +194,6 @@ bool nemus::core::Memory::writeByte(unsigned char data, unsigned int address)
     return false;
 }
 
-void nemus::core::Memory::writeByte(comp::Registers registers, unsigned int src, comp::AddressMode addr)
-{
-    unsigned int address = 0;
-    switch (addr)
-    {
-    case comp::ADDR_MODE_IMMEDIATE:
-        writeByte(src, registers.pc + 1);
-        break;
-    case comp::ADDR_MODE_ZERO_PAGE:
-        address = readByte(registers.pc + 1);
-        writeByte(src, address & 0xFF);
-        break;
-    case comp::ADDR_MODE_ZERO_PAGE_X:
-        address = readByte(registers.pc + 1) + registers.x;
-        writeByte(src, address & 0xFF);
-        break;
-    case comp::ADDR_MODE_ZERO_PAGE_Y:
-        address = readByte(registers.pc + 1) + registers.y;
-        writeByte(src, address & 0xFF);
-        break;
-    case comp::ADDR_MODE_ABSOLUTE:
-        address = readWord(registers.pc + 1);
-        writeByte(src, address);
-        break;
-    case comp::ADDR_MODE_ABSOLUTE_X:
-        address = readWord(registers.pc + 1) + registers.x;
-        writeByte(src, address);
-        break;
-    case comp::ADDR_MODE_ABSOLUTE_Y:
-        address = readWord(registers.pc + 1) + registers.y;
-        writeByte(src, address);
-        break;
-    case comp::ADDR_MODE_INDIRECT_X:
-        address = readByte(registers.pc + 1) + registers.x;
-        address &= 0xFF;
-        address = readWordBug(address);
-        writeByte(src, address);
-        break;
-    case comp::ADDR_MODE_INDIRECT_Y:
-        address = readByte(registers.pc + 1);
-        address = readWordBug(address) + registers.y;
-        writeByte(src, address);
-        break;
-    default:
-        m_logger->write("Unknown address mode!!!");
-        break;
-    }
-}
-
 unsigned int nemus::core::Memory::readPPUByte(unsigned int address)
 {
     return m_mapper->readBytePPU(address);
@@ -273,58 +204,28 @@ void nemus::core::Memory::writePPUByte(unsigned char data, unsigned address)
     m_mapper->writeBytePPU(data, address);
 }
 
-void nemus::core::Memory::push(unsigned int data, unsigned int &sp)
+void nemus::core::Memory::push16(uint16_t data, uint8_t &sp)
 {
-    m_ram[sp + 0x100] = (unsigned char)data;
-    sp--;
-    sp &= 0xFF;
+    push(data >> 8, sp);
+    push(data & 0xFF, sp);
 }
 
-void nemus::core::Memory::push16(unsigned int data, unsigned int &sp)
+uint16_t nemus::core::Memory::pop16(uint8_t &sp)
 {
-    unsigned int highByte = (data >> 8) & 0xFF;
-    push(highByte, sp);
-    unsigned int lowByte = data & 0xFF;
-    push(lowByte, sp);
-}
+    const uint8_t lowByte = pop(sp);
+    const uint8_t highByte = pop(sp);
 
-unsigned int nemus::core::Memory::pop(unsigned int &sp)
-{
-    sp++;
-    sp &= 0xFF;
-    return (m_ram[sp + 0x100] & 0xFF);
+    return highByte << 8 | lowByte;
 }
 
-unsigned int nemus::core::Memory::pop16(unsigned int &sp)
+void nemus::core::Memory::saveState(StateWriter &state)
 {
-    unsigned int lowByte = pop(sp);
-    unsigned int highByte = pop(sp);
-
-    unsigned int address = ((highByte << 8) & 0xFF00) | (lowByte & 0xFF);
-
-    return address;
+    state.write(m_ram, 0x800);
+    m_mapper->saveState(state);
 }
 
-unsigned int nemus::core::Memory::checkPageCross(comp::Registers registers, comp::AddressMode mode)
+void nemus::core::Memory::loadState(StateReader &state)
 {
-    switch (mode)
-    {
-    case comp::ADDR_MODE_ABSOLUTE_X:
-    {
-        const auto address = readWord(registers.pc + 1);
-        return ((address + registers.x) & 0xFF00) != (address & 0xFF00);
-    }
-    case comp::ADDR_MODE_ABSOLUTE_Y:
-    {
-        const auto address = readWord(registers.pc + 1);
-        return ((address + registers.y) & 0xFF00) != (address & 0xFF00);
-    }
-    case comp::ADDR_MODE_INDIRECT_Y:
-    {
-        auto address = readByte(registers.pc + 1);
-        return (address & 0xFF00) != ((readWordBug(address) + registers.y) & 0xFF00);
-    }
-    default:
-        return 0;
-    }
-}
\ No newline at end of file
+    state.read(m_ram, 0x800);
+    m_mapper->loadState(state);
+}
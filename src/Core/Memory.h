@@ -1,14 +1,19 @@
 #ifndef NEMUS_MEMORY_H
 #define NEMUS_MEMORY_H
 
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include "../Debug/Logger.h"
+#include "APU.h"
+#include "Cartridge.h"
 #include "ComponentHelper.h"
 #include "PPU.h"
 #include "Mappers/Mapper.h"
 #include "Input.h"
+#include "State.h"
 
 namespace nemus::core
 {
@@ -20,6 +25,16 @@ namespace nemus::core
         long size;
     };
 
+    // An instruction's resolved operand. pageCycle is 1 when indexing
+    // carried into the high byte of the address, which costs indexed
+    // reads an extra cycle.
+    struct Operand
+    {
+        uint16_t address;
+        uint8_t value;
+        uint8_t pageCycle;
+    };
+
     class Memory
     {
     private:
@@ -27,55 +42,205 @@ namespace nemus::core
 
         PPU *m_ppu;
 
-        Mapper *m_mapper;
+        APU *m_apu;
+
+        std::unique_ptr<Mapper> m_mapper;
 
         Input *m_input;
 
         unsigned char *m_ram;
 
-        std::shared_ptr<std::vector<char>> m_rom;
+        // CPU address space in 256 byte pages. Pages backed by plain memory
+        // (RAM, PRG banks) are accessed directly; a null page goes through
+        // readRegister()/writeRegister().
+        std::array<unsigned char *, CPU_PAGE_COUNT> m_readPages;
+        std::array<unsigned char *, CPU_PAGE_COUNT> m_writePages;
+
+        std::shared_ptr<const Cartridge> m_cartridge;
+
+        uint32_t m_mapGeneration = 0;
 
         FileInfo loadSaveFile(std::string filename);
 
+        unsigned int readRegister(unsigned int address);
+
+        bool writeRegister(unsigned char data, unsigned int address);
+
     public:
-        Memory(debug::Logger *logger, core::PPU *ppu, core::Input *input,
-               const std::vector<char> &gameData);
+        Memory(debug::Logger *logger, core::PPU *ppu, core::APU *apu, core::Input *input,
+               std::shared_ptr<const Cartridge> cartridge);
 
         ~Memory();
 
-        void loadRom(const std::vector<char> &gameData, const std::string &filename = "");
+        // Creates the cartridge's mapper from the MapperRegistry, falling
+        // back to NROM for unsupported mapper numbers.
+        void loadRom(std::shared_ptr<const Cartridge> cartridge, const std::string &filename = "");
 
-        inline char readRom(int address) { return m_rom->at(address); }
+        const Cartridge &getCartridge() { return *m_cartridge; }
 
         int getMirroring() { return m_mapper->getMirroring(); }
 
-        unsigned int readByte(unsigned int address);
+        // Lets the mapper raise IRQs.
+        void setCPU(CPU *cpu) { m_mapper->setCPU(cpu); }
+
+        void clockScanline() { m_mapper->clockScanline(); }
+
+        unsigned int getScanlinesUntilIrq() { return m_mapper->getScanlinesUntilIrq(); }
+
+        uint8_t readByte(uint16_t address)
+        {
+            if (const unsigned char *page = m_readPages[address / CPU_PAGE_SIZE])
+            {
+                return page[address % CPU_PAGE_SIZE];
+            }
+
+            return readRegister(address);
+        }
+
+        // Computes the effective address and page crossing of the
+        // instruction at registers.pc from its operand bytes, given as a
+        // little endian word. The value is left unset; stores must not
+        // read their target.
+        template <comp::AddressMode mode>
+        Operand resolve(const comp::Registers &registers, uint16_t bytes);
 
-        unsigned int readByte(comp::Registers registers, comp::AddressMode addr);
+        // resolve() followed by reading the value at the address.
+        template <comp::AddressMode mode>
+        Operand fetch(const comp::Registers &registers, uint16_t bytes)
+        {
+            Operand operand = resolve<mode>(registers, bytes);
 
-        unsigned int readWord(unsigned int address);
+            if constexpr (mode == comp::ADDR_MODE_IMMEDIATE)
+            {
+                operand.value = static_cast<uint8_t>(bytes);
+            }
+            else
+            {
+                operand.value = readByte(operand.address);
+            }
 
-        unsigned int readWordBug(unsigned int address);
+            return operand;
+        }
 
-        bool writeByte(unsigned char data, unsigned int address);
+        // Host memory behind address if it is mapped read-only, which
+        // means PRG-ROM. Code found there can be decoded once and cached by
+        // this pointer, which stays valid across bank switches. Returns
+        // nullptr for RAM and registers.
+        const unsigned char *getCodePointer(uint16_t address)
+        {
+            const unsigned char *page = m_readPages[address / CPU_PAGE_SIZE];
 
-        void writeByte(comp::Registers registers, unsigned int src, comp::AddressMode addr);
+            if (page == nullptr || m_writePages[address / CPU_PAGE_SIZE] != nullptr)
+            {
+                return nullptr;
+            }
+
+            return page + address % CPU_PAGE_SIZE;
+        }
+
+        // Changes whenever a mapper register is written and banks may have
+        // moved under the CPU.
+        uint32_t getMapGeneration() { return m_mapGeneration; }
+
+        // Work RAM and the page tables, for compiled code that accesses
+        // mapped memory without going through Memory.
+        unsigned char *getRam() { return m_ram; }
+
+        unsigned char *const *getReadPages() { return m_readPages.data(); }
+
+        unsigned char *const *getWritePages() { return m_writePages.data(); }
+
+        uint16_t readWord(uint16_t address);
+
+        uint16_t readWordBug(uint16_t address);
+
+        bool writeByte(uint8_t data, uint16_t address)
+        {
+            if (unsigned char *page = m_writePages[address / CPU_PAGE_SIZE])
+            {
+                page[address % CPU_PAGE_SIZE] = data;
+                return false;
+            }
+
+            return writeRegister(data, address);
+        }
 
         unsigned int readPPUByte(unsigned int address);
 
         void writePPUByte(unsigned char data, unsigned int address);
 
-        void push(unsigned int data, unsigned int &sp);
+        void push(uint8_t data, uint8_t &sp) { m_ram[0x100 + sp--] = data; }
 
-        void push16(unsigned int data, unsigned int &sp);
+        void push16(uint16_t data, uint8_t &sp);
 
-        unsigned int pop(unsigned int &sp);
+        uint8_t pop(uint8_t &sp) { return m_ram[0x100 + ++sp]; }
 
-        unsigned int pop16(unsigned int &sp);
+        uint16_t pop16(uint8_t &sp);
 
-        unsigned int checkPageCross(comp::Registers registers, comp::AddressMode mode);
+        // Saves work RAM followed by the mapper state.
+        void saveState(StateWriter &state);
+
+        void loadState(StateReader &state);
     };
 
+    template <comp::AddressMode mode>
+    Operand Memory::resolve(const comp::Registers &registers, uint16_t bytes)
+    {
+        Operand operand{};
+
+        if constexpr (mode == comp::ADDR_MODE_IMMEDIATE)
+        {
+            operand.address = registers.pc + 1;
+        }
+        else if constexpr (mode == comp::ADDR_MODE_ZERO_PAGE)
+        {
+            operand.address = static_cast<uint8_t>(bytes);
+        }
+        else if constexpr (mode == comp::ADDR_MODE_ZERO_PAGE_X)
+        {
+            operand.address = static_cast<uint8_t>(bytes + registers.x);
+        }
+        else if constexpr (mode == comp::ADDR_MODE_ZERO_PAGE_Y)
+        {
+            operand.address = static_cast<uint8_t>(bytes + registers.y);
+        }
+        else if constexpr (mode == comp::ADDR_MODE_ABSOLUTE)
+        {
+            operand.address = bytes;
+        }
+        else if constexpr (mode == comp::ADDR_MODE_INDIRECT_X)
+        {
+            operand.address = readWordBug(static_cast<uint8_t>(bytes + registers.x));
+        }
+        else
+        {
+            uint16_t base;
+            uint8_t index;
+
+            if constexpr (mode == comp::ADDR_MODE_ABSOLUTE_X)
+            {
+                base = bytes;
+                index = registers.x;
+            }
+            else if constexpr (mode == comp::ADDR_MODE_ABSOLUTE_Y)
+            {
+                base = bytes;
+                index = registers.y;
+            }
+            else
+            {
+                static_assert(mode == comp::ADDR_MODE_INDIRECT_Y, "Address mode does not reference memory");
+                base = readWordBug(static_cast<uint8_t>(bytes));
+                index = registers.y;
+            }
+
+            operand.address = base + index;
+            operand.pageCycle = (base & 0xFF) + index > 0xFF;
+        }
+
+        return operand;
+    }
+
 }
 
 #endif
@@ -1,78 +1,175 @@
+#include <chrono>
+#include <QApplication>
+
 #include "NES.h"
 
 nemus::NES::NES()
 {
-    m_ppu = new core::PPU();
-    m_input = new core::Input();
-    m_screen = new ui::Screen(m_ppu, this, m_input, nullptr);
+    m_console = std::make_unique<core::Console>();
+    m_screen = new ui::Screen(m_console->getPPU(), this, m_console->getInput(), nullptr);
+
+    m_console->setSampleRate(NES_SAMPLE_RATE);
+    m_audio = std::make_unique<ui::Audio>(m_console->getSampleQueue(), NES_SAMPLE_RATE);
+
+    m_console->setErrorHandler([this](const std::string &) {
+        m_halted = true;
+        QMetaObject::invokeMethod(m_screen, [this] { reportHalt(); }, Qt::QueuedConnection);
+    });
 }
 
 nemus::NES::~NES()
 {
-    delete m_logger;
-    delete m_ppu;
-    delete m_memory;
-    delete m_cpu;
+    m_quit = true;
+    wake();
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
     delete m_screen;
-    delete m_input;
 }
 
-void nemus::NES::run()
+void nemus::NES::emulate()
 {
-    const double clockRatio = 1788908.0 / 60.0;
-    int updateCounter = 0;
-
-    while (!m_screen->getQuit())
+    while (!m_quit)
     {
-        if (m_gameLoaded && m_cpu->isRunning())
+        if (m_consoleWaiters > 0)
         {
-            int cycles = m_cpu->tick();
-
-            for (int i = 0; i < cycles * 3; i++)
-            {
-                m_ppu->tick();
-            }
+            std::this_thread::yield();
+            continue;
+        }
 
-            updateCounter += cycles * 3;
+        std::unique_lock<std::mutex> lock(m_consoleMutex);
 
-            if (static_cast<long>(updateCounter) > (clockRatio))
-            {
-                m_screen->updateFPS();
-                m_screen->updateWindow();
+        if (!canRun())
+        {
+            // Sleep until a game is loaded, reset or rewound.
+            m_pacer.reset();
+            m_wake.wait(lock, [this] { return m_quit || canRun(); });
+            continue;
+        }
 
-                updateCounter = 0;
-            }
+        if (m_rewinding)
+        {
+            // Show the frame after each restored snapshot without recording it.
+            m_rewind.rewind(*m_console);
+            m_pacer.skip(*m_console);
+            m_console->runFrame();
         }
-        else
+        else if (m_console->runFrame())
         {
-            m_screen->updateWindow();
+            m_rewind.capture(*m_console);
         }
+
+        m_screen->requestUpdate();
+
+        const auto due = m_pacer.endFrame(*m_console);
+
+        lock.unlock();
+        std::this_thread::sleep_until(due);
+    }
+}
+
+std::unique_lock<std::mutex> nemus::NES::lockConsole()
+{
+    m_consoleWaiters++;
+    std::unique_lock<std::mutex> lock(m_consoleMutex);
+    m_consoleWaiters--;
+
+    return lock;
+}
+
+void nemus::NES::run()
+{
+    if (!m_audio->start())
+    {
+        // Nothing plays the samples, so stop making them. The audio pacing
+        // mode falls back to the wall clock without a sample rate.
+        m_console->setSampleRate(0);
     }
+
+    m_thread = std::thread(&NES::emulate, this);
+
+    // Everything the window has to do arrives as an event, new frames and
+    // halts included, so this only wakes when there is work.
+    while (!m_screen->getQuit())
+    {
+        QApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+
+    m_quit = true;
+    wake();
+    m_thread.join();
+}
+
+void nemus::NES::wake()
+{
+    // Taking the lock orders the flag change before the emulation thread's
+    // next check, so the notification cannot fall between its check and
+    // its wait.
+    {
+        auto lock = lockConsole();
+    }
+
+    m_wake.notify_one();
 }
 
-void nemus::NES::loadGame(const std::vector<char> &gameData)
+void nemus::NES::reportHalt()
 {
-    reset();
+    if (!m_halted.exchange(false))
+    {
+        return;
+    }
 
-    m_logger = new debug::Logger();
-    // m_logger->enable();
+    std::string error;
+    {
+        auto lock = lockConsole();
+        error = m_console->getError();
+    }
 
-    m_memory = new core::Memory(m_logger, m_ppu, m_input, gameData);
+    m_screen->showError("CPU Halted", error);
+}
 
-    m_cpu = new core::CPU(m_memory, m_logger);
+bool nemus::NES::loadGame(const std::vector<char> &gameData)
+{
+    auto lock = lockConsole();
 
-    m_ppu->setCPU(m_cpu);
+    if (!m_console->loadGame(gameData))
+    {
+        return false;
+    }
 
-    m_ppu->setMemory(m_memory);
+    m_rewind.clear();
+    m_pacer.reset();
+    m_halted = false;
+    m_wake.notify_one();
 
-    m_gameLoaded = true;
+    return true;
 }
 
 void nemus::NES::reset()
 {
-    delete m_logger;
-    delete m_memory;
-    delete m_cpu;
+    auto lock = lockConsole();
+    m_console->reset();
+    m_rewind.clear();
+    m_pacer.reset();
+    m_halted = false;
+    m_wake.notify_one();
+}
+
+void nemus::NES::setPacing(comp::PacingMode mode)
+{
+    auto lock = lockConsole();
+    m_pacer.setMode(mode);
+}
 
-    m_ppu->reset();
+void nemus::NES::setRewinding(bool rewinding)
+{
+    m_rewinding = rewinding;
+
+    if (rewinding)
+    {
+        wake();
+    }
 }
@@ -1,28 +1,78 @@
 #ifndef NEMUS_NES_H
 #define NEMUS_NES_H
 
-#include "Memory.h"
-#include "CPU.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Console.h"
+#include "Pacer.h"
+#include "Rewind.h"
+#include "../UI/Audio.h"
 #include "../UI/Screen.h"
 
+#define NES_SAMPLE_RATE 48000
+
 namespace nemus
 {
     class NES
     {
     private:
-        core::CPU *m_cpu = nullptr;
+        std::unique_ptr<core::Console> m_console;
 
-        core::Input *m_input = nullptr;
+        // Plays the console's sample queue, so it goes before the console.
+        std::unique_ptr<ui::Audio> m_audio;
 
-        core::Memory *m_memory = nullptr;
+        ui::Screen *m_screen = nullptr;
 
-        core::PPU *m_ppu = nullptr;
+        // The console runs on m_thread. The UI thread only touches it
+        // through loadGame()/reset(), which take m_consoleMutex.
+        std::thread m_thread;
 
-        debug::Logger *m_logger = nullptr;
+        std::mutex m_consoleMutex;
 
-        ui::Screen *m_screen = nullptr;
+        // UI-thread callers waiting on m_consoleMutex. The emulation thread
+        // backs off between frames while this is non-zero so it cannot
+        // starve them by relocking immediately.
+        std::atomic<int> m_consoleWaiters = 0;
+
+        // Signalled when there may be something to emulate again, so the
+        // emulation thread can block while no game runs.
+        std::condition_variable m_wake;
+
+        std::atomic<bool> m_quit = false;
+
+        // Set from the console's error handler on the emulation thread so
+        // the UI thread can report the error. Cleared by loads and resets,
+        // which make a report still queued for the UI thread stale.
+        std::atomic<bool> m_halted = false;
+
+        // Snapshots taken by the emulation thread every frame. While
+        // m_rewinding is set it steps back through them instead.
+        core::Rewind m_rewind;
 
-        bool m_gameLoaded = false;
+        std::atomic<bool> m_rewinding = false;
+
+        // Used by the emulation thread between frames, which sleeps without
+        // holding m_consoleMutex until the pacer says the next one is due.
+        core::Pacer m_pacer{comp::PACING_AUDIO};
+
+        void emulate();
+
+        // Whether the emulation thread has frames to run. Needs the console
+        // lock.
+        bool canRun() { return m_console->isRunning() || (m_rewinding && m_console->isGameLoaded()); }
+
+        // Wakes the emulation thread after a flag it waits on was set
+        // without the console lock.
+        void wake();
+
+        // Shows the error of a halt reported since the last load or reset.
+        void reportHalt();
+
+        std::unique_lock<std::mutex> lockConsole();
 
     public:
         NES();
@@ -31,9 +81,15 @@ namespace nemus
 
         void run();
 
-        void loadGame(const std::vector<char> &gameData);
+        // Returns false, keeping the current game, if gameData is not a
+        // usable ROM image.
+        bool loadGame(const std::vector<char> &gameData);
 
         void reset();
+
+        void setRewinding(bool rewinding);
+
+        void setPacing(comp::PacingMode mode);
     };
 }
 
@@ -1,25 +1,13 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include "PPU.h"
 #include "Memory.h"
-#include "../UI/Screen.h"
 
-nemus::core::PPU::PPU()
+nemus::core::PPU::PPU() : m_frames(SCREEN_WIDTH * SCREEN_HEIGHT)
 {
-    m_backBuffer = new unsigned int[SCREEN_WIDTH * SCREEN_HEIGHT];
-
-    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
-    {
-        m_backBuffer[i] = 0;
-    }
-
-    m_frontBuffer = new unsigned int[SCREEN_WIDTH * SCREEN_HEIGHT];
-
-    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
-    {
-        m_frontBuffer[i] = 0;
-    }
-
     reset();
 }
 
@@ -65,16 +53,18 @@ void nemus::core::PPU::reset()
 
     m_scanline = 0;
 
+    m_dot = 0;
+
+    updateTarget();
+
+    updateNextEvent();
+
     m_oamDMA = 2;
 
     m_oamTransfer = 0;
 }
 
-nemus::core::PPU::~PPU()
-{
-    delete[] m_backBuffer;
-    delete[] m_frontBuffer;
-}
+nemus::core::PPU::~PPU() = default;
 
 int nemus::core::PPU::getNameTableAddress(unsigned int cycle, unsigned int scanline)
 {
@@ -97,138 +87,337 @@ int nemus::core::PPU::getNameTableAddress(unsigned int cycle, unsigned int scanl
     return address + offset;
 }
 
-void nemus::core::PPU::renderPixel()
+namespace
 {
-    unsigned int scanline = m_scanline + m_ppuScrollY;
+    // Spreads the bits of a pattern byte into the even bits of a word so
+    // that two bitplanes can be interleaved into eight 2-bit pixels.
+    constexpr std::array<uint16_t, 256> buildInterleaveTable()
+    {
+        std::array<uint16_t, 256> table{};
 
-    unsigned int cycle = m_cycle + m_ppuScrollX;
+        for (unsigned int value = 0; value < 256; value++)
+        {
+            uint16_t spread = 0;
 
+            for (unsigned int bit = 0; bit < 8; bit++)
+            {
+                spread |= ((value >> bit) & 1) << (bit * 2);
+            }
+
+            table[value] = spread;
+        }
+
+        return table;
+    }
+
+    constexpr std::array<uint16_t, 256> interleaveTable = buildInterleaveTable();
+
+    constexpr unsigned int colors[4] = {PPU_COLOR_BLACK, PPU_COLOR_RED, PPU_COLOR_BLUE, PPU_COLOR_WHITE};
+
+    constexpr uint16_t colors565[4] = {0x0000, 0xF800, 0x001F, 0xFFFF};
+
+    constexpr uint8_t indices[4] = {0, 1, 2, 3};
+}
+
+uint16_t nemus::core::PPU::fetchTileRow(unsigned int cycle, unsigned int scanline)
+{
     int x = (cycle % 256) / 8;
     int y = (scanline % 240) / 8;
     int sliver = scanline % 8;
-    int pixel = cycle % 8;
     int tileNum = x + (y * 32);
 
     int nameTableAddress = getNameTableAddress(cycle, scanline);
 
     int tileID = m_memory->readPPUByte(nameTableAddress + tileNum);
 
-    int plane0 = 0, plane1 = 0;
+    unsigned int patternAddress = m_ppuCtrl.bg_tile_select ? PATTERN_TABLE_1 : PATTERN_TABLE_0;
+    patternAddress += (tileID * 0x10) + sliver;
 
-    if (m_ppuMask.bg_enable)
+    unsigned int plane0 = m_memory->readPPUByte(patternAddress) & 0xFF;
+    unsigned int plane1 = m_memory->readPPUByte(patternAddress + 0x08) & 0xFF;
+
+    return interleaveTable[plane0] | (interleaveTable[plane1] << 1);
+}
+
+void nemus::core::PPU::renderSpan(unsigned int start, unsigned int end)
+{
+    // The format is fixed for the frame, so pick the writer once per span.
+    switch (m_format)
     {
-        if (m_ppuCtrl.bg_tile_select)
-        {
-            plane0 = m_memory->readPPUByte(PATTERN_TABLE_1 + (tileID * 0x10) + sliver);
-            plane1 = m_memory->readPPUByte(PATTERN_TABLE_1 + (tileID * 0x10) + sliver + 0x08);
-        }
-        else
-        {
-            plane0 = m_memory->readPPUByte(PATTERN_TABLE_0 + (tileID * 0x10) + sliver);
-            plane1 = m_memory->readPPUByte(PATTERN_TABLE_0 + (tileID * 0x10) + sliver + 0x08);
-        }
+    case comp::PIXEL_FORMAT_RGB565:
+        renderSpan(start, end, colors565);
+        break;
+    case comp::PIXEL_FORMAT_INDEX8:
+        renderSpan(start, end, indices);
+        break;
+    default:
+        renderSpan(start, end, colors);
+        break;
+    }
+}
 
-        int color = 0;
+template <typename Pixel>
+void nemus::core::PPU::renderSpan(unsigned int start, unsigned int end, const Pixel *palette)
+{
+    if (!m_ppuMask.bg_enable)
+    {
+        return;
+    }
 
-        if (m_ppuMask.bg_enable)
-        {
-            color = (plane0 >> (7 - pixel)) & 0x1;
+    end = std::min(end, static_cast<unsigned int>(SCREEN_WIDTH));
 
-            if (pixel < 7)
-            {
-                color |= (plane1 >> (6 - pixel)) & 0x2;
-            }
-            else
-            {
-                color |= (plane1 << 1) & 0x2;
-            }
-        }
+    unsigned int scanline = m_scanline + m_ppuScrollY;
+
+    auto *row = reinterpret_cast<Pixel *>(m_backBuffer + m_scanline * m_stride);
+
+    unsigned int x = start;
+
+    while (x < end)
+    {
+        unsigned int cycle = x + m_ppuScrollX;
+        unsigned int pixel = cycle % 8;
+
+        // Every pixel of a tile row shares one nametable and two pattern reads.
+        uint16_t tileRow = fetchTileRow(cycle, scanline);
+        unsigned int count = std::min(8 - pixel, end - x);
 
-        if (m_ppuMask.sprite_enable)
+        for (unsigned int i = pixel; i < pixel + count; i++, x++)
         {
-            if (m_spriteScanline[m_cycle] > 0)
+            unsigned int color = (tileRow >> ((7 - i) * 2)) & 0x3;
+
+            if (m_ppuMask.sprite_enable && m_spriteScanline[x] > 0)
             {
                 for (unsigned int sprite0Pixel : m_sprite0Pixels)
                 {
-                    if (m_cycle == sprite0Pixel)
+                    if (x == sprite0Pixel)
                     {
                         m_hitNextLine = true;
                     }
                 }
 
-                color = m_spriteScanline[m_cycle];
+                color = m_spriteScanline[x];
+            }
+
+            row[x] = palette[color];
+        }
+    }
+}
+
+void nemus::core::PPU::catchUp()
+{
+    const uint64_t target = m_cpu->getCycles() * 3;
+
+    while (m_dot < target)
+    {
+        const uint64_t remaining = target - m_dot;
+
+        if (m_scanline < 240)
+        {
+            // Render the rest of the visible span in one pass.
+            const auto span = static_cast<unsigned int>(std::min<uint64_t>(remaining, DOTS_PER_SCANLINE - m_cycle));
+
+            renderSpan(m_cycle, m_cycle + span);
+
+            m_cycle += span;
+            m_dot += span;
+        }
+        else if (m_scanline < 261)
+        {
+            unsigned int span = 1;
+
+            if (m_cycle == 1)
+            {
+                if (m_ppuCtrl.nmi)
+                {
+                    m_cpu->setInterrupt(comp::INT_NMI);
+                }
+
+                m_ppuStatus.vblank = true;
+            }
+            else if (m_cycle > 1)
+            {
+                // Nothing happens for the rest of a vblank scanline.
+                span = static_cast<unsigned int>(std::min<uint64_t>(remaining, DOTS_PER_SCANLINE - m_cycle));
             }
+
+            m_cycle += span;
+            m_dot += span;
         }
+        else
+        {
+            // The pre-render line fetches like a visible one.
+            clockScanline();
+
+            m_scanline = 0;
+            m_cycle = 0;
+            m_ppuStatus.s0_hit = false;
+            m_ppuStatus.vblank = false;
+
+            m_sprite0Pixels.clear();
+
+            if (m_framebuffer == nullptr)
+            {
+                m_frames.publish();
+            }
+
+            updateTarget();
+
+            m_frameCount++;
+
+            m_dot++;
 
-        unsigned int videoAddress = m_cycle + (m_scanline * SCREEN_WIDTH);
-        videoAddress %= SCREEN_WIDTH * SCREEN_HEIGHT;
+            continue;
+        }
 
-        switch (color)
+        if (m_cycle >= DOTS_PER_SCANLINE)
         {
-        case 0:
-            m_backBuffer[videoAddress] = PPU_COLOR_BLACK;
-            break;
-        case 1:
-            m_backBuffer[videoAddress] = PPU_COLOR_RED;
-            break;
-        case 2:
-            m_backBuffer[videoAddress] = PPU_COLOR_BLUE;
-            break;
-        case 3:
-            m_backBuffer[videoAddress] = PPU_COLOR_WHITE;
-            break;
+            nextScanline();
         }
     }
+
+    updateNextEvent();
 }
 
-void nemus::core::PPU::tick()
+void nemus::core::PPU::nextScanline()
 {
     if (m_scanline < 240)
     {
-        renderPixel();
+        clockScanline();
     }
-    else if (m_scanline < 261)
+
+    if (m_hitNextLine)
     {
-        if (m_cycle == 1)
-        {
-            if (m_ppuCtrl.nmi)
-            {
-                m_cpu->setInterrupt(comp::INT_NMI);
-            }
+        m_ppuStatus.s0_hit = true;
+        m_hitNextLine = false;
+    }
 
-            m_ppuStatus.vblank = true;
-        }
+    m_scanline++;
+    m_cycle = 0;
+    m_sprite0Pixels.clear();
+
+    if (m_scanline == 1 && m_framebuffer != nullptr)
+    {
+        std::memcpy(m_framebuffer, m_firstRow.data(), SCREEN_WIDTH * comp::getPixelSize(m_format));
+        updateTarget();
+    }
+
+    if (m_scanline < 240)
+    {
+        evaluateSprites();
+    }
+}
+
+void nemus::core::PPU::setFramebuffer(void *pixels, std::size_t stride)
+{
+    m_framebuffer = static_cast<unsigned char *>(pixels);
+    m_framebufferStride = stride;
+    updateTarget();
+}
+
+void nemus::core::PPU::setPixelFormat(comp::PixelFormat format)
+{
+    m_format = format;
+    updateTarget();
+}
+
+void nemus::core::PPU::updateTarget()
+{
+    const std::size_t packed = SCREEN_WIDTH * comp::getPixelSize(m_format);
+
+    if (m_framebuffer == nullptr)
+    {
+        m_backBuffer = reinterpret_cast<unsigned char *>(m_frames.getBackBuffer());
+        m_stride = packed;
+    }
+    else if (m_scanline == 0)
+    {
+        m_backBuffer = reinterpret_cast<unsigned char *>(m_firstRow.data());
+        m_stride = packed;
     }
     else
     {
-        m_scanline = 0;
-        m_cycle = 0;
-        m_ppuStatus.s0_hit = false;
-        m_ppuStatus.vblank = false;
+        m_backBuffer = m_framebuffer;
+        m_stride = m_framebufferStride != 0 ? m_framebufferStride : packed;
+    }
+}
 
-        m_sprite0Pixels.clear();
+void nemus::core::PPU::updateNextEvent()
+{
+    // Events are the vblank dot of scanlines 240-260 and the end of frame
+    // on scanline 261. Positions count dots from the start of the frame.
+    const unsigned int position = m_scanline * DOTS_PER_SCANLINE + m_cycle;
+    unsigned int event = 0;
 
-        unsigned int *tmp = m_backBuffer;
-        m_backBuffer = m_frontBuffer;
-        m_frontBuffer = tmp;
+    if (m_scanline < 240)
+    {
+        event = 240 * DOTS_PER_SCANLINE + 1;
+    }
+    else if (m_scanline < 261 && m_cycle <= 1)
+    {
+        event = m_scanline * DOTS_PER_SCANLINE + 1;
+    }
+    else if (m_scanline < 260)
+    {
+        event = (m_scanline + 1) * DOTS_PER_SCANLINE + 1;
+    }
+    else
+    {
+        event = 261 * DOTS_PER_SCANLINE;
+    }
 
-        return;
+    m_nextEvent = m_dot + (event - position) + 1;
+
+    // A mapper IRQ is an event too, at the clock that asserts it. Register
+    // writes that could move it reschedule().
+    const unsigned int clocks = m_memory != nullptr && clocksScanlines() ? m_memory->getScanlinesUntilIrq() : 0;
+
+    if (clocks > 0)
+    {
+        m_nextEvent = std::min(m_nextEvent, m_dot + getScanlineClockDistance(clocks));
+    }
+}
+
+void nemus::core::PPU::reschedule()
+{
+    updateNextEvent();
+    m_cpu->limitRun((m_nextEvent + 2) / 3);
+}
+
+void nemus::core::PPU::clockScanline()
+{
+    if (m_memory != nullptr && clocksScanlines())
+    {
+        m_memory->clockScanline();
     }
+}
+
+uint64_t nemus::core::PPU::getScanlineClockDistance(unsigned int clocks)
+{
+    // Visible scanlines clock on their last dot and the pre-render line as
+    // the frame wraps, which takes one more dot. Positions count dots from
+    // the start of the frame.
+    constexpr uint64_t FRAME_DOTS = 261 * DOTS_PER_SCANLINE + 1;
+
+    const uint64_t position = m_scanline * DOTS_PER_SCANLINE + m_cycle;
+    uint64_t frameStart = 0;
+    unsigned int scanline = m_scanline;
 
-    if (++m_cycle > 256)
+    while (true)
     {
-        if (m_hitNextLine)
+        if (scanline < 240 || scanline == 261)
         {
-            m_ppuStatus.s0_hit = true;
-            m_hitNextLine = false;
+            const uint64_t clock = scanline == 261 ? FRAME_DOTS : (scanline + 1) * DOTS_PER_SCANLINE;
+
+            if (--clocks == 0)
+            {
+                return frameStart + clock - position;
+            }
         }
 
-        m_scanline++;
-        m_cycle = 0;
-        m_sprite0Pixels.clear();
-        if (m_scanline < 240)
+        if (++scanline > 261)
         {
-            evaluateSprites();
+            scanline = 0;
+            frameStart += FRAME_DOTS;
         }
     }
 }
@@ -337,9 +526,11 @@ void nemus::core::PPU::writePPU(unsigned int data, unsigned int address)
     {
     case 0x2000:
         writePPUCtrl(data);
+        reschedule();
         break;
     case 0x2001:
         writePPUMask(data);
+        reschedule();
         break;
     case 0x2003:
         writeOAMAddr(data);
@@ -559,4 +750,92 @@ void nemus::core::PPU::writeOAMData(unsigned int data)
 unsigned int nemus::core::PPU::readOAMData()
 {
     return m_oam[m_oamAddr];
-}
\ No newline at end of file
+}
+
+void nemus::core::PPU::saveState(StateWriter &state)
+{
+    state.write(m_oam);
+    state.write(m_oamEntries);
+    state.write(m_spriteCount);
+    state.write(m_spriteScanline);
+    state.write(m_hitNextLine);
+
+    // Sprite 0 covers at most eight pixels of a scanline. Saving a fixed
+    // number of slots keeps the state size constant.
+    std::array<unsigned int, 8> sprite0Pixels{};
+    const auto sprite0Count = static_cast<uint32_t>(std::min(m_sprite0Pixels.size(), sprite0Pixels.size()));
+    std::copy_n(m_sprite0Pixels.begin(), sprite0Count, sprite0Pixels.begin());
+    state.write(sprite0Count);
+    state.write(sprite0Pixels);
+
+    state.write(m_cycle);
+    state.write(m_scanline);
+    state.write(m_frameCount);
+    state.write(m_dot);
+    state.write(m_dataBuffer);
+    state.write(m_ppuCtrl);
+    state.write(m_ppuMask);
+    state.write(m_ppuStatus);
+    state.write(m_oamAddr);
+    state.write(m_ppuScrollX);
+    state.write(m_ppuScrollY);
+    state.write(m_ppuAddr);
+    state.write(m_ppuTmpAddr);
+    state.write(m_oamDMA);
+    state.write(m_ppuRegister);
+    state.write(m_oamTransfer);
+    state.write(m_addressLatch);
+
+    // Only the scanline being drawn is kept from the frame in progress.
+    // That covers states taken between frames, where the CPU has already
+    // run a few dots into scanline 0.
+    std::array<unsigned int, SCREEN_WIDTH> row{};
+    if (m_scanline < SCREEN_HEIGHT)
+    {
+        std::memcpy(row.data(), m_backBuffer + m_scanline * m_stride, SCREEN_WIDTH * comp::getPixelSize(m_format));
+    }
+    state.write(row);
+}
+
+void nemus::core::PPU::loadState(StateReader &state)
+{
+    state.read(m_oam);
+    state.read(m_oamEntries);
+    state.read(m_spriteCount);
+    state.read(m_spriteScanline);
+    state.read(m_hitNextLine);
+
+    std::array<unsigned int, 8> sprite0Pixels{};
+    uint32_t sprite0Count = 0;
+    state.read(sprite0Count);
+    state.read(sprite0Pixels);
+    m_sprite0Pixels.assign(sprite0Pixels.begin(), sprite0Pixels.begin() + std::min<std::size_t>(sprite0Count, sprite0Pixels.size()));
+
+    state.read(m_cycle);
+    state.read(m_scanline);
+    state.read(m_frameCount);
+    state.read(m_dot);
+    state.read(m_dataBuffer);
+    state.read(m_ppuCtrl);
+    state.read(m_ppuMask);
+    state.read(m_ppuStatus);
+    state.read(m_oamAddr);
+    state.read(m_ppuScrollX);
+    state.read(m_ppuScrollY);
+    state.read(m_ppuAddr);
+    state.read(m_ppuTmpAddr);
+    state.read(m_oamDMA);
+    state.read(m_ppuRegister);
+    state.read(m_oamTransfer);
+    state.read(m_addressLatch);
+
+    std::array<unsigned int, SCREEN_WIDTH> row{};
+    state.read(row);
+    updateTarget();
+    if (m_scanline < SCREEN_HEIGHT)
+    {
+        std::memcpy(m_backBuffer + m_scanline * m_stride, row.data(), SCREEN_WIDTH * comp::getPixelSize(m_format));
+    }
+
+    updateNextEvent();
+}
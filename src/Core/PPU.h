@@ -1,16 +1,26 @@
 #ifndef NEMUS_PPU_H
 #define NEMUS_PPU_H
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include "CPU.h"
+#include "FrameQueue.h"
+#include "State.h"
 
 #define PATTERN_TABLE_0 0x0000
 #define PATTERN_TABLE_1 0x1000
 
-#define PPU_COLOR_BLACK 0x00000000;
-#define PPU_COLOR_BLUE  0xFF0000FF;
-#define PPU_COLOR_RED   0xFFFF0000;
-#define PPU_COLOR_WHITE 0xFFFFFFFF;
+#define SCREEN_HEIGHT 240
+#define SCREEN_WIDTH  256
+
+#define DOTS_PER_SCANLINE 257
+
+#define PPU_COLOR_BLACK 0x00000000
+#define PPU_COLOR_BLUE  0xFF0000FF
+#define PPU_COLOR_RED   0xFFFF0000
+#define PPU_COLOR_WHITE 0xFFFFFFFF
 
 namespace nemus::core {
     struct OAMEntry {
@@ -27,8 +37,22 @@ namespace nemus::core {
 
         Memory* m_memory = nullptr;
 
-        unsigned int *m_frontBuffer = nullptr;
-        unsigned int *m_backBuffer = nullptr;
+        // Finished frames go to the UI through the queue, or straight into
+        // m_framebuffer when one is attached. m_backBuffer and m_stride
+        // locate the frame being drawn; see updateTarget().
+        FrameQueue m_frames;
+        unsigned char *m_backBuffer = nullptr;
+        std::size_t m_stride = 0;
+
+        unsigned char *m_framebuffer = nullptr;
+        std::size_t m_framebufferStride = 0;
+
+        comp::PixelFormat m_format = comp::PIXEL_FORMAT_ARGB32;
+
+        // Scanline 0 of an attached framebuffer is drawn here and copied
+        // over once complete. Frames end a few dots into scanline 0, and
+        // drawing those in place would overwrite the finished frame.
+        std::array<unsigned int, SCREEN_WIDTH> m_firstRow{};
 
         unsigned char m_oam[0x100];
 
@@ -43,6 +67,14 @@ namespace nemus::core {
 
         unsigned int m_scanline = 0;
 
+        unsigned long m_frameCount = 0;
+
+        // Dots executed since reset and the dot at which the next NMI or
+        // end of frame happens.
+        uint64_t m_dot = 0;
+
+        uint64_t m_nextEvent = 0;
+
         unsigned char m_dataBuffer = 0;
 
         struct {
@@ -88,12 +120,41 @@ namespace nemus::core {
 
         bool m_addressLatch = false;
 
-        void renderPixel();
+        // Returns the background tile row under (cycle, scanline) decoded
+        // into eight 2-bit pixels, leftmost pixel in the top bits.
+        uint16_t fetchTileRow(unsigned int cycle, unsigned int scanline);
+
+        // Renders visible pixels [start, end) of the current scanline.
+        void renderSpan(unsigned int start, unsigned int end);
+
+        template <typename Pixel>
+        void renderSpan(unsigned int start, unsigned int end, const Pixel *palette);
 
         void evaluateSprites();
 
+        void nextScanline();
+
+        // Whether rendering raises PPU A12 once per scanline, which is what
+        // mapper scanline counters count. True whenever a pattern table at
+        // $1000 is in use.
+        bool clocksScanlines()
+        {
+            return (m_ppuMask.bg_enable || m_ppuMask.sprite_enable) &&
+                   (m_ppuCtrl.bg_tile_select || m_ppuCtrl.sprite_select || m_ppuCtrl.sprite_height);
+        }
+
+        void clockScanline();
+
+        // Dots from now until the scanline counter's clocks-th clock.
+        uint64_t getScanlineClockDistance(unsigned int clocks);
+
+        void updateNextEvent();
+
         int getNameTableAddress(unsigned cycle, unsigned scanline);
 
+        // Points m_backBuffer at the frame being drawn.
+        void updateTarget();
+
     public:
         PPU();
 
@@ -105,9 +166,30 @@ namespace nemus::core {
 
         void setMemory(nemus::core::Memory* memory) { m_memory = memory; }
 
-        void tick();
+        // Advances the PPU to the CPU's current cycle count.
+        void catchUp();
+
+        uint64_t getNextEvent() { return m_nextEvent; }
+
+        // Recomputes the next event after a write that can move it, such as
+        // to a mapper's IRQ registers, and stops the CPU's run there.
+        void reschedule();
 
-        unsigned int* getPixels() { return m_frontBuffer; };
+        FrameQueue *getFrameQueue() { return &m_frames; }
+
+        // Draws frames into caller-owned pixels instead of the frame queue,
+        // stride bytes apart per row; 0 packs rows tightly. Between frames
+        // the buffer holds the last finished one. nullptr goes back to the
+        // queue.
+        void setFramebuffer(void *pixels, std::size_t stride = 0);
+
+        // Format of both the queue and attached framebuffers. Set between
+        // frames; queue buffers are sized for the largest format.
+        void setPixelFormat(comp::PixelFormat format);
+
+        comp::PixelFormat getPixelFormat() { return m_format; }
+
+        unsigned long getFrameCount() { return m_frameCount; }
 
         void writePPU(unsigned int data, unsigned int address);
 
@@ -142,6 +224,12 @@ namespace nemus::core {
         void writeVRAM(unsigned char data, int address);
 
         void dumpRam(std::string filename);
+
+        // Of the frame being drawn only the current scanline is saved; a
+        // state loaded mid-frame finishes that frame over the back buffer.
+        void saveState(StateWriter &state);
+
+        void loadState(StateReader &state);
     };
 }
 
@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include "Pacer.h"
+#include "Console.h"
+
+namespace
+{
+    using Seconds = std::chrono::duration<double>;
+
+    // Falling further behind than this, e.g. after the process was
+    // suspended, drops the debt instead of running fast to repay it.
+    constexpr Seconds MAX_LAG{0.1};
+
+    // The most the audio mode moves the resampling ratio. Half a percent
+    // covers any real device's clock error and is too small to hear.
+    constexpr double MAX_RATIO_ADJUSTMENT = 0.005;
+
+    nemus::core::Pacer::Clock::duration toDuration(double seconds)
+    {
+        return std::chrono::duration_cast<nemus::core::Pacer::Clock::duration>(Seconds(seconds));
+    }
+}
+
+void nemus::core::Pacer::setMode(comp::PacingMode mode)
+{
+    m_mode = mode;
+    m_synced = false;
+}
+
+void nemus::core::Pacer::sync(uint64_t cycles)
+{
+    m_start = Clock::now();
+    m_startCycles = cycles;
+    m_lastCycles = cycles;
+    m_synced = true;
+}
+
+void nemus::core::Pacer::skip(Console &console)
+{
+    const uint64_t cycles = console.getCycles();
+
+    // Wraps when the count goes backwards, which still shifts correctly.
+    m_startCycles += cycles - m_lastCycles;
+    m_lastCycles = cycles;
+}
+
+nemus::core::Pacer::Clock::time_point nemus::core::Pacer::endFrame(Console &console)
+{
+    const uint64_t cycles = console.getCycles();
+
+    if (m_mode != comp::PACING_AUDIO)
+    {
+        console.setResampleRatio(1.0);
+    }
+
+    if (m_mode == comp::PACING_UNTHROTTLED)
+    {
+        return Clock::now();
+    }
+
+    if (!m_synced || cycles < m_lastCycles)
+    {
+        sync(cycles);
+        return m_start;
+    }
+
+    const Clock::time_point due = m_mode == comp::PACING_AUDIO ? getAudioDeadline(console, cycles) : getClockDeadline(cycles);
+
+    m_lastCycles = cycles;
+
+    return due;
+}
+
+nemus::core::Pacer::Clock::time_point nemus::core::Pacer::getClockDeadline(uint64_t cycles)
+{
+    const Clock::time_point due = m_start + toDuration(static_cast<double>(cycles - m_startCycles) / APU_CLOCK_RATE);
+
+    if (Clock::now() - due > MAX_LAG)
+    {
+        sync(cycles);
+        return m_start;
+    }
+
+    return due;
+}
+
+nemus::core::Pacer::Clock::time_point nemus::core::Pacer::getAudioDeadline(Console &console, uint64_t cycles)
+{
+    const unsigned int rate = console.getSampleRate();
+
+    if (rate == 0)
+    {
+        return getClockDeadline(cycles);
+    }
+
+    // Emulation still follows the wall clock; the ratio only absorbs the
+    // difference between it and the audio device's clock, which is what
+    // the fill drifting away from the target measures.
+    const double target = rate * PACER_AUDIO_LATENCY_MS / 1000.0;
+    const double fill = static_cast<double>(console.getSampleQueue()->getAvailable());
+    const double error = std::clamp((target - fill) / target, -1.0, 1.0);
+
+    console.setResampleRatio(1 + error * MAX_RATIO_ADJUSTMENT);
+
+    Clock::time_point due = getClockDeadline(cycles);
+
+    if (fill > 2 * target)
+    {
+        // Far more queued than the ratio could drain, e.g. after running
+        // unthrottled. Let the device play it down, at most a frame's time
+        // per frame in case it is not playing at all, and pace on from there.
+        const double frame = static_cast<double>(cycles - m_lastCycles) / APU_CLOCK_RATE;
+        const Clock::time_point drained = Clock::now() + toDuration(std::min((fill - target) / rate, frame));
+
+        if (drained > due)
+        {
+            due = drained;
+            m_start = due;
+            m_startCycles = cycles;
+        }
+    }
+
+    return due;
+}
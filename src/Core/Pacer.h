@@ -0,0 +1,70 @@
+#ifndef NEMUS_PACER_H
+#define NEMUS_PACER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "ComponentHelper.h"
+
+// Sample queue fill the audio mode aims for, on top of what the audio
+// device has already buffered.
+#define PACER_AUDIO_LATENCY_MS 40
+
+namespace nemus::core
+{
+    class Console;
+
+    // Keeps emulation at the console's real speed. The PPU's frames are not
+    // a whole 60th of a second, so time is measured in emulated CPU cycles
+    // rather than frames. Wall-clock pacing sleeps until the cycles run so
+    // far are due. Audio pacing sleeps while the sample queue holds more
+    // than the target latency and moves the resampling ratio a little
+    // toward the target every frame, so the emulated clock follows the
+    // audio device's clock and neither ever drifts into a gap or pile-up.
+    class Pacer
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        comp::PacingMode m_mode;
+
+        bool m_synced = false;
+
+        // Wall-clock time and CPU cycle count pacing started from.
+        Clock::time_point m_start;
+        uint64_t m_startCycles = 0;
+
+        uint64_t m_lastCycles = 0;
+
+        void sync(uint64_t cycles);
+
+        Clock::time_point getClockDeadline(uint64_t cycles);
+
+        Clock::time_point getAudioDeadline(Console &console, uint64_t cycles);
+
+    public:
+        explicit Pacer(comp::PacingMode mode = comp::PACING_WALL_CLOCK) : m_mode(mode) {}
+
+        void setMode(comp::PacingMode mode);
+
+        comp::PacingMode getMode() { return m_mode; }
+
+        // Starts pacing afresh from the next frame. Call after pauses, loads
+        // and resets.
+        void reset() { m_synced = false; }
+
+        // Call after the console's cycle count jumps without time passing,
+        // as when a state is loaded, so pacing carries on from the new count.
+        void skip(Console &console);
+
+        // Call once per emulated frame. Returns when the next frame is due,
+        // which may be in the past; the caller sleeps until then without
+        // holding anything the UI waits on. Also updates the console's
+        // resampling ratio in audio mode.
+        Clock::time_point endFrame(Console &console);
+    };
+}
+
+#endif
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "Rewind.h"
+#include "Console.h"
+
+namespace
+{
+    // Equal bytes needed to end a literal run. Shorter gaps are cheaper to
+    // copy than to encode as a new run.
+    constexpr std::size_t MIN_ZERO_RUN = 4;
+
+    uint64_t load64(const unsigned char *data)
+    {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    unsigned char *writeVarint(unsigned char *out, std::size_t value)
+    {
+        while (value >= 0x80)
+        {
+            *out++ = static_cast<unsigned char>(value | 0x80);
+            value >>= 7;
+        }
+
+        *out++ = static_cast<unsigned char>(value);
+
+        return out;
+    }
+
+    const unsigned char *readVarint(const unsigned char *in, const unsigned char *end, std::size_t &value)
+    {
+        value = 0;
+
+        for (unsigned int shift = 0; in < end; shift += 7)
+        {
+            unsigned char byte = *in++;
+            value |= static_cast<std::size_t>(byte & 0x7F) << shift;
+
+            if (!(byte & 0x80))
+            {
+                break;
+            }
+        }
+
+        return in;
+    }
+}
+
+nemus::core::Rewind::Rewind(std::size_t capacity, unsigned int interval)
+    : m_ring(capacity), m_interval(std::max(interval, 1U))
+{
+}
+
+void nemus::core::Rewind::clear()
+{
+    m_head = 0;
+    m_tail = 0;
+    m_used = 0;
+    m_count = 0;
+    m_frames = 0;
+    m_hasCurrent = false;
+}
+
+void nemus::core::Rewind::capture(Console &console)
+{
+    if (m_hasCurrent && ++m_frames < m_interval)
+    {
+        return;
+    }
+
+    m_frames = 0;
+
+    console.saveState(m_next);
+
+    if (m_hasCurrent && m_next.size() == m_current.size())
+    {
+        // Store what turns the new snapshot back into the current one.
+        push(m_packed.data(), encode(m_next, m_current));
+    }
+    else
+    {
+        clear();
+    }
+
+    std::swap(m_current, m_next);
+    m_hasCurrent = !m_current.empty();
+}
+
+bool nemus::core::Rewind::rewind(Console &console)
+{
+    if (!m_hasCurrent)
+    {
+        return false;
+    }
+
+    // Frames ran since the newest snapshot, so going back starts with it.
+    if (m_frames > 0)
+    {
+        m_frames = 0;
+        return console.loadState(m_current);
+    }
+
+    if (m_count == 0)
+    {
+        console.loadState(m_current);
+        return false;
+    }
+
+    std::size_t size = popNewest();
+    decode(m_packed.data(), size, m_current);
+
+    return console.loadState(m_current);
+}
+
+std::size_t nemus::core::Rewind::encode(const std::vector<unsigned char> &from, const std::vector<unsigned char> &to)
+{
+    const std::size_t size = from.size();
+
+    // Worst case is one literal byte per run of MIN_ZERO_RUN + 1 bytes.
+    m_packed.resize(size * 2 + 16);
+
+    const unsigned char *a = from.data();
+    const unsigned char *b = to.data();
+    unsigned char *out = m_packed.data();
+
+    std::size_t i = 0;
+
+    while (i < size)
+    {
+        const std::size_t zeroStart = i;
+
+        while (i + 8 <= size && load64(a + i) == load64(b + i))
+        {
+            i += 8;
+        }
+
+        while (i < size && a[i] == b[i])
+        {
+            i++;
+        }
+
+        const std::size_t literalStart = i;
+
+        while (i < size)
+        {
+            if (a[i] != b[i])
+            {
+                i++;
+                continue;
+            }
+
+            std::size_t j = i;
+            while (j < size && a[j] == b[j] && j - i < MIN_ZERO_RUN)
+            {
+                j++;
+            }
+
+            if (j - i >= MIN_ZERO_RUN || j == size)
+            {
+                break;
+            }
+
+            i = j;
+        }
+
+        out = writeVarint(out, literalStart - zeroStart);
+        out = writeVarint(out, i - literalStart);
+
+        for (std::size_t k = literalStart; k < i; k++)
+        {
+            *out++ = a[k] ^ b[k];
+        }
+    }
+
+    return out - m_packed.data();
+}
+
+void nemus::core::Rewind::decode(const unsigned char *data, std::size_t size, std::vector<unsigned char> &target)
+{
+    const unsigned char *end = data + size;
+    std::size_t position = 0;
+
+    while (data < end)
+    {
+        std::size_t zeros;
+        std::size_t literals;
+        data = readVarint(data, end, zeros);
+        data = readVarint(data, end, literals);
+
+        position += zeros;
+        literals = std::min({literals, static_cast<std::size_t>(end - data), target.size() - std::min(position, target.size())});
+
+        for (std::size_t k = 0; k < literals; k++)
+        {
+            target[position + k] ^= data[k];
+        }
+
+        data += literals;
+        position += literals;
+    }
+}
+
+void nemus::core::Rewind::copyIn(std::size_t position, const void *data, std::size_t size)
+{
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    const std::size_t first = std::min(size, m_ring.size() - position);
+
+    std::memcpy(m_ring.data() + position, bytes, first);
+    std::memcpy(m_ring.data(), bytes + first, size - first);
+}
+
+void nemus::core::Rewind::copyOut(std::size_t position, void *data, std::size_t size)
+{
+    auto *bytes = static_cast<unsigned char *>(data);
+    const std::size_t first = std::min(size, m_ring.size() - position);
+
+    std::memcpy(bytes, m_ring.data() + position, first);
+    std::memcpy(bytes + first, m_ring.data(), size - first);
+}
+
+void nemus::core::Rewind::push(const unsigned char *data, std::size_t size)
+{
+    const std::size_t entry = size + 2 * sizeof(uint32_t);
+
+    if (entry > m_ring.size())
+    {
+        // Older deltas chain through this one, so they are useless now.
+        m_head = m_tail = m_used = m_count = 0;
+        return;
+    }
+
+    while (m_used + entry > m_ring.size())
+    {
+        dropOldest();
+    }
+
+    const auto header = static_cast<uint32_t>(size);
+
+    copyIn(m_head, &header, sizeof(header));
+    copyIn((m_head + sizeof(header)) % m_ring.size(), data, size);
+    copyIn((m_head + sizeof(header) + size) % m_ring.size(), &header, sizeof(header));
+
+    m_head = (m_head + entry) % m_ring.size();
+    m_used += entry;
+    m_count++;
+}
+
+std::size_t nemus::core::Rewind::popNewest()
+{
+    const std::size_t capacity = m_ring.size();
+
+    uint32_t size;
+    copyOut((m_head + capacity - sizeof(size)) % capacity, &size, sizeof(size));
+
+    const std::size_t entry = size + 2 * sizeof(uint32_t);
+    m_head = (m_head + capacity - entry) % capacity;
+
+    if (m_packed.size() < size)
+    {
+        m_packed.resize(size);
+    }
+
+    copyOut((m_head + sizeof(size)) % capacity, m_packed.data(), size);
+
+    m_used -= entry;
+    m_count--;
+
+    return size;
+}
+
+void nemus::core::Rewind::dropOldest()
+{
+    uint32_t size;
+    copyOut(m_tail, &size, sizeof(size));
+
+    const std::size_t entry = size + 2 * sizeof(uint32_t);
+    m_tail = (m_tail + entry) % m_ring.size();
+
+    m_used -= entry;
+    m_count--;
+}
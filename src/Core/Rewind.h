@@ -0,0 +1,80 @@
+#ifndef NEMUS_REWIND_H
+#define NEMUS_REWIND_H
+
+#include <cstddef>
+#include <vector>
+
+#define REWIND_DEFAULT_CAPACITY (32 * 1024 * 1024)
+#define REWIND_DEFAULT_INTERVAL 2
+
+namespace nemus::core
+{
+    class Console;
+
+    // Rewind history. The newest snapshot is kept in full; each older one
+    // is stored in a fixed-size byte ring as the run-length encoded XOR
+    // against its successor. Stepping back undoes one delta at a time, and
+    // the oldest deltas are dropped when the ring fills up.
+    class Rewind
+    {
+    private:
+        std::vector<unsigned char> m_ring;
+
+        // Write position, oldest entry and bytes in use. Entries are the
+        // encoded delta framed by its size on both sides so the ring can be
+        // walked from either end.
+        std::size_t m_head = 0;
+        std::size_t m_tail = 0;
+        std::size_t m_used = 0;
+
+        std::size_t m_count = 0;
+
+        unsigned int m_interval;
+
+        // Frames run since m_current was captured or loaded.
+        unsigned int m_frames = 0;
+
+        bool m_hasCurrent = false;
+
+        std::vector<unsigned char> m_current;
+
+        // Scratch buffers reused between captures.
+        std::vector<unsigned char> m_next;
+        std::vector<unsigned char> m_packed;
+
+        void copyIn(std::size_t position, const void *data, std::size_t size);
+
+        void copyOut(std::size_t position, void *data, std::size_t size);
+
+        void push(const unsigned char *data, std::size_t size);
+
+        std::size_t popNewest();
+
+        void dropOldest();
+
+        // Encodes from ^ to into m_packed and returns the encoded size.
+        std::size_t encode(const std::vector<unsigned char> &from, const std::vector<unsigned char> &to);
+
+        // XORs an encoded delta back into target.
+        static void decode(const unsigned char *data, std::size_t size, std::vector<unsigned char> &target);
+
+    public:
+        explicit Rewind(std::size_t capacity = REWIND_DEFAULT_CAPACITY,
+                        unsigned int interval = REWIND_DEFAULT_INTERVAL);
+
+        // Call once per emulated frame. Takes a snapshot every interval frames.
+        void capture(Console &console);
+
+        // Restores the previous snapshot. Returns false once there is no
+        // older history; the oldest snapshot is loaded again in that case.
+        bool rewind(Console &console);
+
+        void clear();
+
+        std::size_t getSnapshotCount() { return m_count + (m_hasCurrent ? 1 : 0); }
+
+        std::size_t getUsedBytes() { return m_used + m_current.size(); }
+    };
+}
+
+#endif
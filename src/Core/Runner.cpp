@@ -0,0 +1,123 @@
+#include <algorithm>
+
+#include "Runner.h"
+#include "Console.h"
+
+nemus::core::Runner::Runner(unsigned int threads)
+{
+    if (threads == 0)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+
+    m_threadCount = threads;
+    m_ranges = std::make_unique<Range[]>(threads);
+
+    // The thread calling forEach() takes range 0.
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        m_threads.emplace_back(&Runner::work, this, i);
+    }
+}
+
+nemus::core::Runner::~Runner()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+
+    m_start.notify_all();
+
+    for (auto &thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void nemus::core::Runner::runFrames(unsigned int frames)
+{
+    forEach([frames](std::size_t, Console &console) {
+        for (unsigned int frame = 0; frame < frames; frame++)
+        {
+            if (!console.runFrame())
+            {
+                break;
+            }
+        }
+    });
+}
+
+void nemus::core::Runner::forEach(const Task &task)
+{
+    const std::size_t count = m_consoles.size();
+
+    m_task = &task;
+
+    for (unsigned int i = 0; i < m_threadCount; i++)
+    {
+        m_ranges[i].next.store(count * i / m_threadCount, std::memory_order_relaxed);
+        m_ranges[i].end = count * (i + 1) / m_threadCount;
+    }
+
+    // Publishing the step under the mutex also publishes the ranges.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_step++;
+        m_busy = m_threadCount - 1;
+    }
+
+    m_start.notify_all();
+
+    drain(0);
+
+    // Workers finish under the mutex, which makes everything they wrote
+    // to their consoles visible here.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+}
+
+void nemus::core::Runner::work(unsigned int index)
+{
+    uint64_t step = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [this, step] { return m_quit || m_step != step; });
+
+            if (m_quit)
+            {
+                return;
+            }
+
+            step = m_step;
+        }
+
+        drain(index);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (--m_busy == 0)
+        {
+            m_done.notify_one();
+        }
+    }
+}
+
+void nemus::core::Runner::drain(unsigned int index)
+{
+    // Own range first, then the others in order. Claims past the end of a
+    // range are harmless; they only tell the claimer it is empty.
+    for (unsigned int offset = 0; offset < m_threadCount; offset++)
+    {
+        Range &range = m_ranges[(index + offset) % m_threadCount];
+        std::size_t next;
+
+        while ((next = range.next.fetch_add(1, std::memory_order_relaxed)) < range.end)
+        {
+            (*m_task)(next, *m_consoles[next]);
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef NEMUS_RUNNER_H
+#define NEMUS_RUNNER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nemus::core
+{
+    class Console;
+
+    // Steps many independent consoles in parallel. Each call to forEach()
+    // or runFrames() hands every console to the pool and returns once all
+    // of them are done, so callers can read framebuffers and set inputs
+    // between steps without further synchronisation.
+    //
+    // Consoles are split into one contiguous range per thread. A thread
+    // claims consoles from its own range and, once that is empty, steals
+    // from the others, so slow games or halted consoles don't leave
+    // threads idle while another still has a backlog.
+    class Runner
+    {
+    public:
+        using Task = std::function<void(std::size_t index, Console &console)>;
+
+    private:
+        // A thread's share of the consoles. next is claimed with fetch_add
+        // by the owner and by thieves alike, so no console runs twice.
+        struct alignas(64) Range
+        {
+            std::atomic<std::size_t> next = 0;
+            std::size_t end = 0;
+        };
+
+        std::vector<Console *> m_consoles;
+
+        std::unique_ptr<Range[]> m_ranges;
+
+        std::vector<std::thread> m_threads;
+
+        unsigned int m_threadCount;
+
+        const Task *m_task = nullptr;
+
+        std::mutex m_mutex;
+
+        std::condition_variable m_start;
+
+        std::condition_variable m_done;
+
+        // Bumped for every forEach() so workers can tell a new step from
+        // a spurious wake-up.
+        uint64_t m_step = 0;
+
+        bool m_quit = false;
+
+        // Workers still inside the current step.
+        unsigned int m_busy = 0;
+
+        void work(unsigned int index);
+
+        // Runs the task on consoles until every range is empty.
+        void drain(unsigned int index);
+
+    public:
+        // threads includes the caller of forEach(), which works too.
+        // Zero uses one thread per hardware thread.
+        explicit Runner(unsigned int threads = 0);
+
+        ~Runner();
+
+        Runner(const Runner &) = delete;
+
+        Runner &operator=(const Runner &) = delete;
+
+        // Consoles are not owned and must outlive the runner or be removed
+        // with clear(). Not to be called during forEach().
+        void add(Console *console) { m_consoles.push_back(console); }
+
+        void clear() { m_consoles.clear(); }
+
+        std::size_t getSize() { return m_consoles.size(); }
+
+        Console *getConsole(std::size_t index) { return m_consoles[index]; }
+
+        unsigned int getThreadCount() { return m_threadCount; }
+
+        // Calls task once for every console, in parallel, and waits for all
+        // of them. The task must only touch its own console.
+        void forEach(const Task &task);
+
+        // Runs frames frames on every console and waits for all of them.
+        // Consoles that halt stop early; their error handlers are called on
+        // whichever thread ran them.
+        void runFrames(unsigned int frames = 1);
+    };
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef NEMUS_SAMPLEQUEUE_H
+#define NEMUS_SAMPLEQUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nemus::core
+{
+    // Lock-free ring of audio samples between the thread emulating the APU
+    // and the thread feeding the audio device. Each side only writes its
+    // own index, so a full or empty ring makes a call return short instead
+    // of waiting on the other side.
+    class SampleQueue
+    {
+    private:
+        std::vector<int16_t> m_samples;
+
+        std::size_t m_mask;
+
+        // Total samples ever written and read; the difference is the fill.
+        alignas(64) std::atomic<std::size_t> m_write = 0;
+
+        alignas(64) std::atomic<std::size_t> m_read = 0;
+
+    public:
+        // The capacity is rounded up to a power of two.
+        explicit SampleQueue(std::size_t capacity)
+        {
+            std::size_t size = 1;
+
+            while (size < capacity)
+            {
+                size *= 2;
+            }
+
+            m_samples.assign(size, 0);
+            m_mask = size - 1;
+        }
+
+        // Producer side. Samples that do not fit are dropped; returns how
+        // many were queued.
+        std::size_t push(const int16_t *samples, std::size_t count)
+        {
+            const std::size_t write = m_write.load(std::memory_order_relaxed);
+            const std::size_t read = m_read.load(std::memory_order_acquire);
+
+            count = std::min(count, m_samples.size() - (write - read));
+
+            for (std::size_t i = 0; i < count; i++)
+            {
+                m_samples[(write + i) & m_mask] = samples[i];
+            }
+
+            m_write.store(write + count, std::memory_order_release);
+
+            return count;
+        }
+
+        // Consumer side. Returns how many samples were copied to samples.
+        std::size_t pop(int16_t *samples, std::size_t count)
+        {
+            const std::size_t read = m_read.load(std::memory_order_relaxed);
+            const std::size_t write = m_write.load(std::memory_order_acquire);
+
+            count = std::min(count, write - read);
+
+            for (std::size_t i = 0; i < count; i++)
+            {
+                samples[i] = m_samples[(read + i) & m_mask];
+            }
+
+            m_read.store(read + count, std::memory_order_release);
+
+            return count;
+        }
+
+        // Samples waiting to be popped. Only exact on the consumer side.
+        std::size_t getAvailable() const
+        {
+            return m_write.load(std::memory_order_acquire) - m_read.load(std::memory_order_relaxed);
+        }
+
+        std::size_t getCapacity() const { return m_samples.size(); }
+    };
+}
+
+#endif
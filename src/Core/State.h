@@ -0,0 +1,92 @@
+#ifndef NEMUS_STATE_H
+#define NEMUS_STATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// "NEMS" in little endian.
+#define STATE_MAGIC   0x534D454E
+#define STATE_VERSION 5
+
+namespace nemus::core
+{
+    // Writes component state into a caller-provided buffer. Without a
+    // buffer it only counts bytes, which is how the state size is found.
+    class StateWriter
+    {
+    private:
+        unsigned char *m_data = nullptr;
+
+        std::size_t m_size = 0;
+
+        std::size_t m_offset = 0;
+
+    public:
+        StateWriter() = default;
+
+        StateWriter(unsigned char *data, std::size_t size) : m_data(data), m_size(size) {}
+
+        void write(const void *data, std::size_t size)
+        {
+            if (m_data != nullptr && m_offset + size <= m_size)
+            {
+                std::memcpy(m_data + m_offset, data, size);
+            }
+
+            m_offset += size;
+        }
+
+        template <typename T>
+        void write(const T &value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "State values are copied as raw bytes");
+            write(&value, sizeof(T));
+        }
+
+        std::size_t getOffset() const { return m_offset; }
+    };
+
+    // Reads state written by StateWriter. Reading past the end of the
+    // buffer leaves the destination untouched and marks the reader invalid.
+    class StateReader
+    {
+    private:
+        const unsigned char *m_data;
+
+        std::size_t m_size;
+
+        std::size_t m_offset = 0;
+
+        bool m_valid = true;
+
+    public:
+        StateReader(const unsigned char *data, std::size_t size) : m_data(data), m_size(size) {}
+
+        void read(void *data, std::size_t size)
+        {
+            if (!m_valid || size > m_size - m_offset)
+            {
+                m_valid = false;
+                return;
+            }
+
+            std::memcpy(data, m_data + m_offset, size);
+            m_offset += size;
+        }
+
+        template <typename T>
+        void read(T &value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "State values are copied as raw bytes");
+            read(&value, sizeof(T));
+        }
+
+        bool isValid() const { return m_valid; }
+
+        std::size_t getOffset() const { return m_offset; }
+    };
+}
+
+#endif
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Synth.h"
+
+namespace
+{
+    // Passband as a fraction of the output Nyquist frequency. Leaving some
+    // room below Nyquist keeps the short kernel's transition band from
+    // folding back.
+    constexpr double CUTOFF = 0.9;
+
+    // The running average follows the level with a time constant of
+    // 2^AVERAGE_SHIFT samples, a high-pass well below audible pitch.
+    constexpr unsigned int AVERAGE_SHIFT = 9;
+}
+
+nemus::core::Synth::Synth() : m_kernel(getKernel())
+{
+}
+
+const nemus::core::Synth::Kernel &nemus::core::Synth::getKernel()
+{
+    static const Kernel kernel = [] {
+        Kernel table{};
+        const double pi = std::acos(-1.0);
+        constexpr int HALF = KERNEL_SIZE / 2;
+
+        for (unsigned int phase = 0; phase < PHASE_COUNT; phase++)
+        {
+            // The step lands this far into its sample; tap HALF - 1 is
+            // the sample it lands in.
+            const double fraction = static_cast<double>(phase) / PHASE_COUNT;
+
+            std::array<double, KERNEL_SIZE> taps;
+            double sum = 0;
+
+            for (unsigned int i = 0; i < KERNEL_SIZE; i++)
+            {
+                const double x = static_cast<double>(i) - (HALF - 1) - fraction;
+                const double sinc = x == 0 ? 1.0 : std::sin(pi * CUTOFF * x) / (pi * CUTOFF * x);
+                const double window = 0.42 + 0.5 * std::cos(pi * x / HALF) + 0.08 * std::cos(2 * pi * x / HALF);
+
+                taps[i] = sinc * std::max(window, 0.0);
+                sum += taps[i];
+            }
+
+            // Round each tap and put the rounding error on the centre tap
+            // so the phase sums to exactly one.
+            int total = 0;
+
+            for (unsigned int i = 0; i < KERNEL_SIZE; i++)
+            {
+                table[phase][i] = static_cast<int16_t>(std::lround(taps[i] / sum * (1 << KERNEL_BITS)));
+                total += table[phase][i];
+            }
+
+            table[phase][HALF - 1] += (1 << KERNEL_BITS) - total;
+        }
+
+        return table;
+    }();
+
+    return kernel;
+}
+
+void nemus::core::Synth::setRates(uint32_t clockRate, unsigned int sampleRate)
+{
+    m_baseFactor = sampleRate == 0 ? 0 : static_cast<uint64_t>(std::llround(std::ldexp(static_cast<double>(sampleRate) / clockRate, 32)));
+    m_factor = m_baseFactor;
+
+    // Leave room for the fastest rate setResampleRatio() allows.
+    const std::size_t samples = sampleRate == 0 ? 0 : static_cast<std::size_t>((MAX_FRAME_CLOCKS * m_baseFactor * (1 + MAX_RATIO_DEVIATION)) / 4294967296.0) + 1;
+
+    m_deltas.assign(samples + KERNEL_SIZE, 0);
+    m_samples.assign(samples, 0);
+
+    clear();
+}
+
+void nemus::core::Synth::setResampleRatio(double ratio)
+{
+    ratio = std::clamp(ratio, 1 - MAX_RATIO_DEVIATION, 1 + MAX_RATIO_DEVIATION);
+
+    m_factor = static_cast<uint64_t>(std::llround(m_baseFactor * ratio));
+}
+
+std::size_t nemus::core::Synth::endFrame(uint32_t clocks)
+{
+    if (!isEnabled())
+    {
+        return 0;
+    }
+
+    const uint64_t end = m_offset + std::min(clocks, MAX_FRAME_CLOCKS) * m_factor;
+    const std::size_t count = end >> 32;
+
+    m_offset = end & 0xFFFFFFFF;
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        m_level += m_deltas[i];
+
+        const int32_t level = m_level >> KERNEL_BITS;
+        m_average += ((static_cast<int64_t>(level) << 16) - m_average) >> AVERAGE_SHIFT;
+
+        const int32_t sample = level - static_cast<int32_t>((m_average + 0x8000) >> 16);
+        m_samples[i] = static_cast<int16_t>(std::clamp(sample, -32768, 32767));
+    }
+
+    // The kernel tails of the last steps belong to the next frame.
+    std::memmove(m_deltas.data(), m_deltas.data() + count, KERNEL_SIZE * sizeof(int32_t));
+    std::fill(m_deltas.begin() + KERNEL_SIZE, m_deltas.end(), 0);
+
+    return count;
+}
+
+void nemus::core::Synth::clear()
+{
+    std::fill(m_deltas.begin(), m_deltas.end(), 0);
+
+    m_offset = 0;
+    m_level = 0;
+    m_average = 0;
+}
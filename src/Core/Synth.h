@@ -0,0 +1,106 @@
+#ifndef NEMUS_SYNTH_H
+#define NEMUS_SYNTH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nemus::core
+{
+    // Band-limited step synthesis. Sound channels only report the clock at
+    // which their level changes; each change is spread over the output
+    // samples around it as a windowed-sinc step, so square waves and noise
+    // come out without aliasing however fast they switch. Samples are
+    // produced a frame at a time by integrating the accumulated steps.
+    class Synth
+    {
+    public:
+        static constexpr unsigned int KERNEL_SIZE = 16;
+
+        static constexpr unsigned int PHASE_BITS = 6;
+
+        static constexpr unsigned int PHASE_COUNT = 1 << PHASE_BITS;
+
+        // Each kernel phase sums to 1 << KERNEL_BITS, so steps integrate
+        // to exactly their size.
+        static constexpr unsigned int KERNEL_BITS = 12;
+
+        // The longest frame endFrame() accepts.
+        static constexpr uint32_t MAX_FRAME_CLOCKS = 1 << 16;
+
+        // How far setResampleRatio() may move the output rate.
+        static constexpr double MAX_RATIO_DEVIATION = 0.01;
+
+        using Kernel = std::array<std::array<int16_t, KERNEL_SIZE>, PHASE_COUNT>;
+
+    private:
+        const Kernel &m_kernel;
+
+        // Steps not yet turned into samples, one slot per output sample of
+        // the current frame plus the kernel's tail.
+        std::vector<int32_t> m_deltas;
+
+        std::vector<int16_t> m_samples;
+
+        // Output samples per clock and the position of the frame's first
+        // clock, both in 32.32 fixed point. m_baseFactor is the factor at the
+        // nominal sample rate, before any resampling adjustment.
+        uint64_t m_baseFactor = 0;
+        uint64_t m_factor = 0;
+        uint64_t m_offset = 0;
+
+        // Integrated level and its running average, which is subtracted
+        // from the output to keep it centred.
+        int32_t m_level = 0;
+        int64_t m_average = 0;
+
+        static const Kernel &getKernel();
+
+    public:
+        Synth();
+
+        // A sample rate of 0 disables synthesis.
+        void setRates(uint32_t clockRate, unsigned int sampleRate);
+
+        bool isEnabled() { return m_factor != 0; }
+
+        // Produces ratio times as many samples per clock as the nominal rate,
+        // so a consumer running at a slightly different rate can be matched
+        // without a gap or pile-up. Clamped to MAX_RATIO_DEVIATION; takes
+        // effect from the next frame.
+        void setResampleRatio(double ratio);
+
+        // Adds a level change of delta at clock time of the current frame.
+        void addDelta(uint32_t time, int delta)
+        {
+            const uint64_t position = m_offset + time * m_factor;
+            const std::size_t index = position >> 32;
+
+            if (index + KERNEL_SIZE > m_deltas.size())
+            {
+                return;
+            }
+
+            const auto &kernel = m_kernel[(position >> (32 - PHASE_BITS)) & (PHASE_COUNT - 1)];
+            int32_t *out = &m_deltas[index];
+
+            for (unsigned int i = 0; i < KERNEL_SIZE; i++)
+            {
+                out[i] += kernel[i] * delta;
+            }
+        }
+
+        // Ends the frame after clocks clocks and turns it into samples,
+        // available from getSamples() until the next call. Returns how many
+        // there are.
+        std::size_t endFrame(uint32_t clocks);
+
+        const int16_t *getSamples() { return m_samples.data(); }
+
+        // Drops pending steps and restarts from silence.
+        void clear();
+    };
+}
+
+#endif
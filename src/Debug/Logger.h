@@ -1,11 +1,11 @@
 #ifndef NEMUS_LOGGER_H
 #define NEMUS_LOGGER_H
 
+#include <cstddef>
 #include <string>
 #include <fstream>
-#include "../Core/ComponentHelper.h"
 
-#define FILE_BUFFER_SIZE 10000000
+#include "Trace.h"
 
 namespace nemus::debug
 {
@@ -15,11 +15,11 @@ namespace nemus::debug
         std::ofstream m_fileOut;
         bool m_enable = false;
 
-        char *m_fileBuffer;
-        int m_bufferPtr;
+        // Binary instruction trace, see Trace.h for the layout.
+        std::ofstream m_traceOut;
 
     public:
-        Logger();
+        Logger() = default;
         ~Logger();
 
         void enable()
@@ -31,13 +31,17 @@ namespace nemus::debug
             }
         }
 
+        // Opens filename for binary trace output and writes its header.
+        bool enableTrace(const std::string &filename);
+
+        bool isTracing() { return m_traceOut.is_open(); }
+
         void write(std::string message);
         void writeError(std::string message, unsigned int address);
-        void writeInstruction(comp::Registers registers,
-                              std::string instruction,
-                              unsigned int result,
-                              comp::AddressMode mode);
+
+        // Appends a block of records to the trace file.
+        void writeTrace(const TraceRecord *records, std::size_t count);
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,22 @@
+#include <algorithm>
+
+#include "Trace.h"
+#include "Logger.h"
+
+void nemus::debug::TraceBuffer::flush()
+{
+    if (m_logger == nullptr)
+    {
+        return;
+    }
+
+    // The pending records wrap around the end of the ring at most once.
+    std::size_t start = m_flushed & m_mask;
+    std::size_t count = m_written - m_flushed;
+    std::size_t first = std::min(count, m_records.size() - start);
+
+    m_logger->writeTrace(m_records.data() + start, first);
+    m_logger->writeTrace(m_records.data(), count - first);
+
+    m_flushed = m_written;
+}
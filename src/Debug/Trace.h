@@ -0,0 +1,109 @@
+#ifndef NEMUS_TRACE_H
+#define NEMUS_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// "NETR" in little endian.
+#define TRACE_MAGIC   0x5254454E
+#define TRACE_VERSION 1
+
+namespace nemus::debug
+{
+    class Logger;
+
+    // Start of a binary trace file, followed by the records back to back.
+    struct TraceHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t recordSize;
+    };
+
+    // CPU state before an instruction executes. Records are plain bytes
+    // so they can be copied around and written out as they are.
+    struct TraceRecord
+    {
+        // Low 32 bits of the CPU cycle count.
+        uint32_t cycle;
+        uint16_t pc;
+        uint8_t opcode;
+        uint8_t operand[2];
+        uint8_t a;
+        uint8_t x;
+        uint8_t y;
+        uint8_t sp;
+        uint8_t p;
+        uint8_t reserved[2];
+    };
+
+    static_assert(sizeof(TraceRecord) == 16, "Trace records are written as 16 byte blocks");
+
+    // Fixed-size ring of the most recent trace records. Recording is a
+    // store and an increment; the oldest records are overwritten unless a
+    // logger is attached, in which case the ring is written out in one
+    // block each time it fills up.
+    class TraceBuffer
+    {
+    private:
+        std::vector<TraceRecord> m_records;
+
+        std::size_t m_mask;
+
+        uint64_t m_written = 0;
+
+        Logger *m_logger = nullptr;
+
+        // Records already handed to the logger.
+        uint64_t m_flushed = 0;
+
+    public:
+        // The capacity is rounded up to a power of two.
+        explicit TraceBuffer(std::size_t capacity)
+        {
+            std::size_t size = 1;
+            while (size < capacity)
+            {
+                size <<= 1;
+            }
+
+            m_records.resize(size);
+            m_mask = size - 1;
+        }
+
+        TraceRecord &next()
+        {
+            if (m_logger != nullptr && m_written - m_flushed == m_records.size())
+            {
+                flush();
+            }
+
+            return m_records[m_written++ & m_mask];
+        }
+
+        void setLogger(Logger *logger)
+        {
+            m_logger = logger;
+            m_flushed = m_written;
+        }
+
+        // Writes the records not yet written to the logger.
+        void flush();
+
+        void clear() { m_written = m_flushed = 0; }
+
+        // Total records written since the last clear, including overwritten ones.
+        uint64_t getWritten() const { return m_written; }
+
+        std::size_t getSize() const { return m_written < m_records.size() ? m_written : m_records.size(); }
+
+        // Records in order, 0 being the oldest still held.
+        const TraceRecord &operator[](std::size_t index) const
+        {
+            return m_records[(m_written - getSize() + index) & m_mask];
+        }
+    };
+}
+
+#endif
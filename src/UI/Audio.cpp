@@ -0,0 +1,71 @@
+#include <cstring>
+#include <QAudioDevice>
+#include <QAudioFormat>
+#include <QMediaDevices>
+
+#include "Audio.h"
+
+// Enough for a few frames, so short stalls of the emulation thread don't
+// underrun the device, without adding noticeable latency.
+#define AUDIO_BUFFER_MS 50
+
+nemus::ui::Audio::Audio(core::SampleQueue *queue, unsigned int sampleRate, QObject *parent) : QIODevice(parent)
+{
+    m_queue = queue;
+
+    QAudioFormat format;
+    format.setSampleRate(sampleRate);
+    format.setChannelCount(1);
+    format.setSampleFormat(QAudioFormat::Int16);
+
+    const QAudioDevice device = QMediaDevices::defaultAudioOutput();
+
+    if (device.isFormatSupported(format))
+    {
+        m_sink = new QAudioSink(device, format, this);
+        m_sink->setBufferSize(sampleRate * sizeof(int16_t) * AUDIO_BUFFER_MS / 1000);
+    }
+}
+
+nemus::ui::Audio::~Audio()
+{
+    if (m_sink)
+    {
+        m_sink->stop();
+    }
+}
+
+bool nemus::ui::Audio::start()
+{
+    if (!m_sink)
+    {
+        return false;
+    }
+
+    open(QIODevice::ReadOnly);
+    m_sink->start(this);
+
+    return true;
+}
+
+qint64 nemus::ui::Audio::readData(char *data, qint64 maxSize)
+{
+    auto *samples = reinterpret_cast<int16_t *>(data);
+    const std::size_t wanted = maxSize / sizeof(int16_t);
+    const std::size_t count = m_queue->pop(samples, wanted);
+
+    std::memset(samples + count, 0, (wanted - count) * sizeof(int16_t));
+
+    return wanted * sizeof(int16_t);
+}
+
+qint64 nemus::ui::Audio::writeData(const char *, qint64)
+{
+    return -1;
+}
+
+qint64 nemus::ui::Audio::bytesAvailable() const
+{
+    // Always ready: missing samples are filled with silence.
+    return m_sink ? m_sink->bufferSize() + QIODevice::bytesAvailable() : 0;
+}
@@ -0,0 +1,41 @@
+#ifndef NEMUS_AUDIO_H
+#define NEMUS_AUDIO_H
+
+#include <QAudioSink>
+#include <QIODevice>
+#include "../Core/SampleQueue.h"
+
+namespace nemus::ui {
+    // Plays the console's samples on the default output device. The sink
+    // pulls from the sample queue on the UI thread, and plays silence
+    // whenever the emulation thread has fallen behind rather than waiting
+    // for it.
+    class Audio : public QIODevice {
+
+    Q_OBJECT
+
+    private:
+        core::SampleQueue* m_queue;
+
+        QAudioSink* m_sink = nullptr;
+
+    protected:
+        qint64 readData(char* data, qint64 maxSize) override;
+
+        qint64 writeData(const char* data, qint64 maxSize) override;
+
+    public:
+        Audio(core::SampleQueue* queue, unsigned int sampleRate, QObject* parent = nullptr);
+        ~Audio();
+
+        // False if the device can't play 16-bit mono at the sample rate,
+        // in which case the game runs silent.
+        bool start();
+
+        bool isSequential() const override { return true; }
+
+        qint64 bytesAvailable() const override;
+    };
+}
+
+#endif
@@ -20,7 +20,7 @@ nemus::ui::Screen::Screen(core::PPU *ppu, NES *nes, core::Input *input, QWidget
     m_nes = nes;
     m_input = input;
 
-    m_state = new SettingsState(SCALE_1X);
+    m_state = new SettingsState(SCALE_1X, comp::PACING_AUDIO);
 
     QWidget *widget = new QWidget;
     setCentralWidget(widget);
@@ -62,8 +62,22 @@ nemus::ui::Screen::~Screen()
 
 void nemus::ui::Screen::updateWindow()
 {
-    QApplication::processEvents();
-    update();
+    m_updatePending = false;
+
+    // Only repaint when the emulation thread has published a new frame.
+    if (m_ppu->getFrameQueue()->acquire())
+    {
+        updateFPS();
+        update();
+    }
+}
+
+void nemus::ui::Screen::requestUpdate()
+{
+    if (!m_updatePending.exchange(true))
+    {
+        QMetaObject::invokeMethod(this, &Screen::updateWindow, Qt::QueuedConnection);
+    }
 }
 
 void nemus::ui::Screen::keyPressEvent(QKeyEvent *event)
@@ -95,6 +109,9 @@ void nemus::ui::Screen::keyPressEvent(QKeyEvent *event)
     case Qt::Key_Right:
         m_input->setButton(BUTTON_RIGHT);
         break;
+    case Qt::Key_Backspace:
+        m_nes->setRewinding(true);
+        break;
     }
 }
 
@@ -127,6 +144,12 @@ void nemus::ui::Screen::keyReleaseEvent(QKeyEvent *event)
     case Qt::Key_Right:
         m_input->unsetButton(BUTTON_RIGHT);
         break;
+    case Qt::Key_Backspace:
+        if (!event->isAutoRepeat())
+        {
+            m_nes->setRewinding(false);
+        }
+        break;
     }
 }
 
@@ -142,6 +165,18 @@ void nemus::ui::Screen::updateFPS()
     m_oldTime = newTime;
 }
 
+void nemus::ui::Screen::showError(const std::string &title, const std::string &message)
+{
+    // Modeless, so the window keeps repainting and loading a new ROM does
+    // not wait for the box to be dismissed.
+    auto *box = new QMessageBox(QMessageBox::Icon::Critical,
+                                QString::fromStdString(title),
+                                QString::fromStdString(message), QMessageBox::StandardButton::Ok, this);
+    box->setAttribute(Qt::WA_DeleteOnClose);
+    box->setModal(false);
+    box->show();
+}
+
 void nemus::ui::Screen::create_menu()
 {
     m_loadRomAction = new QAction(tr("&Load ROM..."), this);
@@ -182,7 +217,25 @@ void nemus::ui::Screen::paintEvent(QPaintEvent *)
 
     painter.fillRect(rect(), Qt::black);
 
-    QImage image((unsigned char *)m_ppu->getPixels(), SCREEN_WIDTH, SCREEN_HEIGHT, QImage::Format_ARGB32);
+    const auto *pixels = (const unsigned char *)m_ppu->getFrameQueue()->getFrontBuffer();
+    const auto format = m_ppu->getPixelFormat();
+    const int stride = SCREEN_WIDTH * nemus::comp::getPixelSize(format);
+
+    QImage image;
+
+    switch (format)
+    {
+    case nemus::comp::PIXEL_FORMAT_RGB565:
+        image = QImage(pixels, SCREEN_WIDTH, SCREEN_HEIGHT, stride, QImage::Format_RGB16);
+        break;
+    case nemus::comp::PIXEL_FORMAT_INDEX8:
+        image = QImage(pixels, SCREEN_WIDTH, SCREEN_HEIGHT, stride, QImage::Format_Indexed8);
+        image.setColorTable({PPU_COLOR_BLACK, PPU_COLOR_RED, PPU_COLOR_BLUE, PPU_COLOR_WHITE});
+        break;
+    default:
+        image = QImage(pixels, SCREEN_WIDTH, SCREEN_HEIGHT, stride, QImage::Format_ARGB32);
+        break;
+    }
 
     switch (m_state->getScale())
     {
@@ -211,7 +264,14 @@ void nemus::ui::Screen::openRom()
         try
         {
             auto romContents = utils::loadFile(filename);
-            m_nes->loadGame(romContents);
+
+            if (!m_nes->loadGame(romContents))
+            {
+                QMessageBox(QMessageBox::Icon::Critical,
+                            "File Loading Error",
+                            "Not a valid NES ROM image.", QMessageBox::StandardButton::Ok, this)
+                    .exec();
+            }
         }
         catch (const utils::FilesystemException &e)
         {
@@ -231,6 +291,8 @@ void nemus::ui::Screen::openSettings()
 
 void nemus::ui::Screen::applySettings()
 {
+    m_nes->setPacing(m_state->getPacing());
+
     switch (m_state->getScale())
     {
     case SCALE_1X:
@@ -1,14 +1,13 @@
 #ifndef NEMUS_SCREEN_H
 #define NEMUS_SCREEN_H
 
+#include <atomic>
 #include <QMainWindow>
 #include "SettingsState.h"
 #include "../Core/PPU.h"
 #include "../Core/Input.h"
 
 #define SCREEN_OFFSET 21
-#define SCREEN_HEIGHT 240
-#define SCREEN_WIDTH  256
 
 namespace nemus {
     class NES;
@@ -32,6 +31,10 @@ namespace nemus::ui {
         SettingsState* m_state;
 
         bool m_quit = false;
+
+        // Set while an updateWindow() call is queued, so frames published
+        // faster than the window repaints do not pile up events.
+        std::atomic<bool> m_updatePending = false;
         std::chrono::system_clock::time_point m_oldTime;
 
         void applySettings();
@@ -44,10 +47,17 @@ namespace nemus::ui {
         Screen(core::PPU *ppu, NES* nes, core::Input* input, QWidget* parent);
         ~Screen();
 
+        // Shows the newest published frame.
         void updateWindow();
 
+        // Queues updateWindow() on the UI thread. Safe to call from the
+        // emulation thread.
+        void requestUpdate();
+
         void updateFPS();
 
+        void showError(const std::string &title, const std::string &message);
+
         bool getQuit() { return m_quit; }
 
         void create_menu();
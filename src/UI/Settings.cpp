@@ -10,11 +10,13 @@ nemus::ui::Settings::Settings(QWidget *parent, SettingsState *state) : QDialog(p
     layout->setContentsMargins(QMargins(5, 5, 5, 5));
 
     createScaleGroup(state->getScale());
+    createSpeedGroup(state->getPacing());
 
     QPushButton *apply = new QPushButton;
     apply->setText(tr("Apply"));
 
     layout->addWidget(m_scaleGroup);
+    layout->addWidget(m_speedGroup);
     layout->addWidget(apply);
     centralWidget->setLayout(layout);
 
@@ -41,7 +43,18 @@ void nemus::ui::Settings::applySettings()
         scale = SCALE_4X;
     }
 
-    m_state->setState(scale);
+    comp::PacingMode pacing = comp::PACING_AUDIO;
+
+    if (m_unthrottled->isChecked())
+    {
+        pacing = comp::PACING_UNTHROTTLED;
+    }
+    else if (m_realTime->isChecked())
+    {
+        pacing = comp::PACING_WALL_CLOCK;
+    }
+
+    m_state->setState(scale, pacing);
 
     this->close();
 }
@@ -81,3 +94,34 @@ QGroupBox *nemus::ui::Settings::createScaleGroup(Scale def)
 
     return m_scaleGroup;
 }
+
+QGroupBox *nemus::ui::Settings::createSpeedGroup(comp::PacingMode def)
+{
+    m_speedGroup = new QGroupBox(tr("Speed"));
+
+    m_unthrottled = new QRadioButton(tr("Unthrottled"));
+    m_realTime = new QRadioButton(tr("Real time"));
+    m_audioSync = new QRadioButton(tr("Real time, synced to audio"));
+
+    switch (def)
+    {
+    case comp::PACING_UNTHROTTLED:
+        m_unthrottled->setChecked(true);
+        break;
+    case comp::PACING_WALL_CLOCK:
+        m_realTime->setChecked(true);
+        break;
+    case comp::PACING_AUDIO:
+        m_audioSync->setChecked(true);
+        break;
+    }
+
+    QVBoxLayout *layout = new QVBoxLayout;
+    layout->addWidget(m_unthrottled);
+    layout->addWidget(m_realTime);
+    layout->addWidget(m_audioSync);
+    layout->addStretch(1);
+    m_speedGroup->setLayout(layout);
+
+    return m_speedGroup;
+}
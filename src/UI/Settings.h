@@ -19,10 +19,18 @@ namespace nemus::ui {
         QRadioButton* m_timesThree;
         QRadioButton* m_timesFour;
 
+        QGroupBox* m_speedGroup;
+
+        QRadioButton* m_unthrottled;
+        QRadioButton* m_realTime;
+        QRadioButton* m_audioSync;
+
         SettingsState* m_state;
 
         QGroupBox* createScaleGroup(Scale def);
 
+        QGroupBox* createSpeedGroup(comp::PacingMode def);
+
     public:
         Settings(QWidget* parent, SettingsState* state);
 
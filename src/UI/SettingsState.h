@@ -1,6 +1,8 @@
 #ifndef NEMUS_SETTINGS_STATE_H
 #define NEMUS_SETTINGS_STATE_H
 
+#include "../Core/ComponentHelper.h"
+
 enum Scale {
     SCALE_1X = 0,
     SCALE_2X = 1,
@@ -12,14 +14,18 @@ namespace nemus::ui {
     class SettingsState {
     private:
         Scale m_scale;
+        comp::PacingMode m_pacing;
 
     public:
-        SettingsState(Scale scale) : m_scale(scale) {}
+        SettingsState(Scale scale, comp::PacingMode pacing) : m_scale(scale), m_pacing(pacing) {}
 
         Scale getScale() { return m_scale; }
 
-        void setState(Scale scale) {
+        comp::PacingMode getPacing() { return m_pacing; }
+
+        void setState(Scale scale, comp::PacingMode pacing) {
             m_scale = scale;
+            m_pacing = pacing;
         }
     };
 }
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "Core/Console.h"
+
+static constexpr unsigned long DefaultInstructionCount = 50000000;
+
+static constexpr unsigned int DefaultRepeatCount = 5;
+
+// A fixed NROM program for timing the instruction dispatch. The loop mixes
+// loads, stores, read-modify-write and ALU operations over most addressing
+// modes, plus the stack, a subroutine call and a taken branch. It only
+// touches RAM, so no PPU or APU work is timed along with the CPU.
+static const unsigned char BenchProgram[] = {
+    0x78,             // 8000 SEI
+    0xD8,             // 8001 CLD
+    0xA2, 0xFF,       // 8002 LDX #$FF
+    0x9A,             // 8004 TXS
+    0xA9, 0x00,       // 8005 LDA #$00
+    0x85, 0x10,       // 8007 STA $10
+    0xA9, 0x03,       // 8009 LDA #$03
+    0x85, 0x11,       // 800B STA $11
+    0xA2, 0x00,       // 800D LDX #$00      outer
+    0xA9, 0x5A,       // 800F LDA #$5A      inner
+    0x75, 0x20,       // 8011 ADC $20,X
+    0x9D, 0x00, 0x03, // 8013 STA $0300,X
+    0x5D, 0x00, 0x04, // 8016 EOR $0400,X
+    0xA0, 0x07,       // 8019 LDY #$07
+    0x31, 0x10,       // 801B AND ($10),Y
+    0x85, 0x30,       // 801D STA $30
+    0x06, 0x30,       // 801F ASL $30
+    0x6A,             // 8021 ROR A
+    0xE9, 0x13,       // 8022 SBC #$13
+    0xC5, 0x30,       // 8024 CMP $30
+    0x24, 0x30,       // 8026 BIT $30
+    0x48,             // 8028 PHA
+    0x8A,             // 8029 TXA
+    0x48,             // 802A PHA
+    0xA2, 0x00,       // 802B LDX #$00
+    0x01, 0x10,       // 802D ORA ($10,X)
+    0x68,             // 802F PLA
+    0xAA,             // 8030 TAX
+    0x68,             // 8031 PLA
+    0x20, 0x4C, 0x80, // 8032 JSR $804C
+    0xEE, 0x00, 0x02, // 8035 INC $0200
+    0xDE, 0x00, 0x06, // 8038 DEC $0600,X
+    0x2E, 0x01, 0x02, // 803B ROL $0201
+    0x46, 0x32,       // 803E LSR $32
+    0xB9, 0x00, 0x05, // 8040 LDA $0500,Y
+    0x8D, 0x02, 0x02, // 8043 STA $0202
+    0xE8,             // 8046 INX
+    0xD0, 0xC6,       // 8047 BNE $800F
+    0x4C, 0x0D, 0x80, // 8049 JMP $800D
+    0xC8,             // 804C INY           subroutine
+    0x88,             // 804D DEY
+    0x18,             // 804E CLC
+    0x60,             // 804F RTS
+};
+
+static void printUsage(const char *program)
+{
+    fmt::print(stderr, "Usage: {} [-i instructions] [-r repeats]\n", program);
+}
+
+// A 32 KB NROM image with the program at $8000 and the reset vector
+// pointing at it.
+static std::vector<char> buildRom()
+{
+    std::vector<char> rom(INES_HEADER_SIZE + 0x8000 + 0x2000, 0);
+
+    std::memcpy(rom.data(), "NES\x1A", 4);
+    rom[4] = 2;
+    rom[5] = 1;
+
+    std::copy(std::begin(BenchProgram), std::end(BenchProgram), rom.begin() + INES_HEADER_SIZE);
+
+    rom[INES_HEADER_SIZE + 0x7FFC] = 0x00;
+    rom[INES_HEADER_SIZE + 0x7FFD] = static_cast<char>(0x80);
+
+    return rom;
+}
+
+// Times instructions executed one at a time through CPU::tick(), which is
+// the opcode dispatch with nothing around it: no block cache, no JIT and
+// no frame loop. The best of several repeats is reported, since the
+// slower ones only measure interference from the rest of the system.
+int main(int argc, char **argv)
+{
+    unsigned long instructions = DefaultInstructionCount;
+    unsigned int repeats = DefaultRepeatCount;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+        {
+            instructions = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            repeats = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (instructions == 0 || repeats == 0)
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::vector<char> rom = buildRom();
+
+    double best = 0;
+    uint64_t cycles = 0;
+
+    for (unsigned int repeat = 0; repeat < repeats; repeat++)
+    {
+        auto console = std::make_unique<nemus::core::Console>();
+        console->loadGame(rom);
+
+        nemus::core::CPU *cpu = console->getCPU();
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (unsigned long i = 0; i < instructions; i++)
+        {
+            cpu->tick();
+        }
+
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (!cpu->isRunning())
+        {
+            fmt::print(stderr, "CPU halted: {}\n", cpu->getError());
+            return EXIT_FAILURE;
+        }
+
+        if (repeat == 0 || elapsed.count() < best)
+        {
+            best = elapsed.count();
+        }
+
+        cycles = cpu->getCycles();
+    }
+
+    fmt::print("instructions: {}\n", instructions);
+    fmt::print("cycles:       {}\n", cycles);
+    fmt::print("seconds:      {:.3f}\n", best);
+    fmt::print("mips:         {:.1f}\n", instructions / best / 1e6);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "Core/Batch.h"
+#include "Core/Console.h"
+#include "Debug/Trace.h"
+
+static constexpr unsigned long DefaultFrameCount = 600;
+
+static constexpr unsigned long TraceBlockSize = 1 << 16;
+
+static constexpr unsigned int WavSampleRate = 48000;
+
+static void printUsage(const char *program)
+{
+    fmt::print(stderr, "Usage: {} <rom.nes> [-f frames] [-c] [-j | -J] [-e entry] [-t instructions] [-T trace.bin] [-n instances] [-p threads] [-F argb32|rgb565|index8] [-w audio.wav]\n", program);
+}
+
+static void printTrace(const nemus::debug::TraceBuffer &trace, std::size_t count)
+{
+    for (std::size_t i = trace.getSize() - std::min(count, trace.getSize()); i < trace.getSize(); i++)
+    {
+        const auto &record = trace[i];
+        fmt::print("{:04X}  {:02X} {:02X} {:02X}  A:{:02X} X:{:02X} Y:{:02X} P:{:02X} SP:{:02X} CYC:{}\n",
+                   record.pc, record.opcode, record.operand[0], record.operand[1],
+                   record.a, record.x, record.y, record.p, record.sp, record.cycle);
+    }
+}
+
+static bool parsePixelFormat(const char *name, nemus::comp::PixelFormat &format)
+{
+    if (std::strcmp(name, "argb32") == 0)
+    {
+        format = nemus::comp::PIXEL_FORMAT_ARGB32;
+    }
+    else if (std::strcmp(name, "rgb565") == 0)
+    {
+        format = nemus::comp::PIXEL_FORMAT_RGB565;
+    }
+    else if (std::strcmp(name, "index8") == 0)
+    {
+        format = nemus::comp::PIXEL_FORMAT_INDEX8;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// 16-bit mono PCM. Written once with no data and again with the final
+// size when the run ends.
+static void writeWavHeader(std::ofstream &file, uint32_t dataSize)
+{
+    auto write16 = [&file](uint16_t value) { file.put(value & 0xFF).put(value >> 8); };
+    auto write32 = [&](uint32_t value) { write16(value & 0xFFFF); write16(value >> 16); };
+
+    file.seekp(0);
+    file.write("RIFF", 4);
+    write32(36 + dataSize);
+    file.write("WAVEfmt ", 8);
+    write32(16);
+    write16(1);
+    write16(1);
+    write32(WavSampleRate);
+    write32(WavSampleRate * 2);
+    write16(2);
+    write16(16);
+    file.write("data", 4);
+    write32(dataSize);
+}
+
+static bool loadRom(const std::string &filename, std::vector<char> &contents)
+{
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    auto size = file.tellg();
+    file.seekg(file.beg);
+
+    contents.resize(size);
+    file.read(contents.data(), size);
+
+    return static_cast<bool>(file);
+}
+
+// Runs copies of the ROM side by side as a Batch, stepping one frame at a
+// time with observations written to shared buffers as a training loop
+// would, and reports the combined frame rate.
+static int runInstances(const std::vector<char> &romContents, unsigned long instances, unsigned int threads,
+                        unsigned long frames, nemus::comp::CPUEngine engine, nemus::comp::JitMode jitMode,
+                        nemus::comp::PixelFormat format, long entryPoint)
+{
+    std::atomic<unsigned long> halted = 0;
+
+    nemus::core::Batch batch(instances, romContents, threads);
+
+    if (!batch.isGameLoaded())
+    {
+        fmt::print(stderr, "Not a valid ROM image\n");
+        return EXIT_FAILURE;
+    }
+
+    for (unsigned long i = 0; i < instances; i++)
+    {
+        nemus::core::Console &console = batch.getConsole(i);
+        console.setEngine(engine);
+        console.setJitMode(jitMode);
+
+        if (entryPoint >= 0)
+        {
+            console.setEntryPoint(static_cast<uint16_t>(entryPoint));
+        }
+
+        console.setErrorHandler([i, &halted](const std::string &error) {
+            fmt::print(stderr, "Instance {} halted: {}\n", i, error);
+            halted++;
+        });
+    }
+
+    std::vector<unsigned char> pixels(instances * nemus::core::Batch::FRAME_SIZE * nemus::comp::getPixelSize(format));
+    std::vector<unsigned char> ram(instances * nemus::core::Batch::RAM_SIZE);
+    batch.setBuffers(pixels.data(), format, ram.data());
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (unsigned long frame = 0; frame < frames; frame++)
+    {
+        batch.step(nullptr);
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    unsigned long total = 0;
+    for (unsigned long i = 0; i < instances; i++)
+    {
+        total += batch.getConsole(i).getPPU()->getFrameCount();
+    }
+
+    fmt::print("instances: {}\n", instances);
+    fmt::print("threads:   {}\n", batch.getThreadCount());
+    fmt::print("frames:    {}\n", total);
+    fmt::print("seconds:   {:.3f}\n", elapsed.count());
+    fmt::print("fps:       {:.1f}\n", total / elapsed.count());
+    fmt::print("speed:     {:.2f}x\n", total / elapsed.count() / 60.0);
+
+    return halted > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    std::string romFile;
+    unsigned long frames = DefaultFrameCount;
+    unsigned long traceLength = 0;
+    std::string traceFile;
+    long entryPoint = -1;
+    auto engine = nemus::comp::ENGINE_INSTRUCTION;
+    auto jitMode = nemus::comp::JIT_OFF;
+    auto format = nemus::comp::PIXEL_FORMAT_ARGB32;
+    unsigned long instances = 1;
+    unsigned int threads = 0;
+    std::string wavFile;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            frames = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "-c") == 0)
+        {
+            engine = nemus::comp::ENGINE_CYCLE;
+        }
+        else if (std::strcmp(argv[i], "-j") == 0)
+        {
+            jitMode = nemus::comp::JIT_ON;
+        }
+        else if (std::strcmp(argv[i], "-J") == 0)
+        {
+            jitMode = nemus::comp::JIT_CHECK;
+        }
+        else if (std::strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+        {
+            entryPoint = std::strtol(argv[++i], nullptr, 16) & 0xFFFF;
+        }
+        else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            traceLength = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "-T") == 0 && i + 1 < argc)
+        {
+            traceFile = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            instances = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "-F") == 0 && i + 1 < argc && parsePixelFormat(argv[i + 1], format))
+        {
+            i++;
+        }
+        else if (std::strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            wavFile = argv[++i];
+        }
+        else if (argv[i][0] != '-' && romFile.empty())
+        {
+            romFile = argv[i];
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Traces and audio are per console, so they only work with a single
+    // instance.
+    if (romFile.empty() || instances == 0 ||
+        (instances > 1 && (traceLength > 0 || !traceFile.empty() || !wavFile.empty())))
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<char> romContents;
+    if (!loadRom(romFile, romContents))
+    {
+        fmt::print(stderr, "Unable to open file: {}\n", romFile);
+        return EXIT_FAILURE;
+    }
+
+    if (instances > 1)
+    {
+        return runInstances(romContents, instances, threads, frames, engine, jitMode, format, entryPoint);
+    }
+
+    auto console = std::make_unique<nemus::core::Console>();
+    console->setEngine(engine);
+    console->setJitMode(jitMode);
+    console->setPixelFormat(format);
+
+    if (!console->loadGame(romContents))
+    {
+        fmt::print(stderr, "Not a valid ROM image\n");
+        return EXIT_FAILURE;
+    }
+
+    // CPU test ROMs such as nestest run unattended from a fixed address,
+    // so their trace can be compared against a reference log.
+    if (entryPoint >= 0)
+    {
+        console->setEntryPoint(static_cast<uint16_t>(entryPoint));
+    }
+
+    // Keeps the last instructions executed to print at exit, and streams
+    // every instruction to traceFile in blocks of the buffer's size.
+    std::unique_ptr<nemus::debug::TraceBuffer> trace;
+    if (traceLength > 0 || !traceFile.empty())
+    {
+        trace = std::make_unique<nemus::debug::TraceBuffer>(std::max(traceLength, TraceBlockSize));
+        console->setTrace(trace.get());
+    }
+
+    if (!traceFile.empty())
+    {
+        if (!console->getLogger()->enableTrace(traceFile))
+        {
+            fmt::print(stderr, "Unable to open file: {}\n", traceFile);
+            return EXIT_FAILURE;
+        }
+
+        trace->setLogger(console->getLogger());
+    }
+
+    std::ofstream wav;
+    std::vector<int16_t> samples(APU_SAMPLE_QUEUE_SIZE);
+    uint32_t wavSize = 0;
+
+    if (!wavFile.empty())
+    {
+        wav.open(wavFile, std::ios::binary);
+
+        if (!wav)
+        {
+            fmt::print(stderr, "Unable to open file: {}\n", wavFile);
+            return EXIT_FAILURE;
+        }
+
+        writeWavHeader(wav, 0);
+        console->setSampleRate(WavSampleRate);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    unsigned long frame = 0;
+
+    console->setErrorHandler([&frame](const std::string &error) {
+        fmt::print(stderr, "CPU halted in frame {}: {}\n", frame, error);
+    });
+
+    while (frame < frames && console->runFrame())
+    {
+        frame++;
+
+        // Drained every frame, so the queue never fills and drops samples.
+        if (wav)
+        {
+            const std::size_t count = console->getSampleQueue()->pop(samples.data(), samples.size());
+
+            for (std::size_t i = 0; i < count; i++)
+            {
+                wav.put(samples[i] & 0xFF).put((samples[i] >> 8) & 0xFF);
+            }
+
+            wavSize += count * 2;
+        }
+    }
+
+    if (wav)
+    {
+        writeWavHeader(wav, wavSize);
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    fmt::print("frames:  {}\n", frame);
+    fmt::print("seconds: {:.3f}\n", elapsed.count());
+    fmt::print("fps:     {:.1f}\n", frame / elapsed.count());
+    fmt::print("speed:   {:.2f}x\n", frame / elapsed.count() / 60.0);
+
+    if (trace)
+    {
+        trace->flush();
+        printTrace(*trace, traceLength);
+    }
+
+    if (frame < frames)
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <fmt/core.h>
+
+#include "Debug/Trace.h"
+
+namespace
+{
+    enum Mode
+    {
+        IMP,
+        ACC,
+        IMM,
+        ZP,
+        ZPX,
+        ZPY,
+        ABS,
+        ABX,
+        ABY,
+        IND,
+        IZX,
+        IZY,
+        REL
+    };
+
+    struct Opcode
+    {
+        const char *name;
+        Mode mode;
+    };
+
+    // Unofficial opcodes carry the '*' prefix nestest.log uses.
+    constexpr std::array<Opcode, 256> opcodes = {{
+        {"BRK", IMP}, {"ORA", IZX}, {"*KIL", IMP}, {"*SLO", IZX}, {"*NOP", ZP}, {"ORA", ZP}, {"ASL", ZP}, {"*SLO", ZP},
+        {"PHP", IMP}, {"ORA", IMM}, {"ASL", ACC}, {"*ANC", IMM}, {"*NOP", ABS}, {"ORA", ABS}, {"ASL", ABS}, {"*SLO", ABS},
+        {"BPL", REL}, {"ORA", IZY}, {"*KIL", IMP}, {"*SLO", IZY}, {"*NOP", ZPX}, {"ORA", ZPX}, {"ASL", ZPX}, {"*SLO", ZPX},
+        {"CLC", IMP}, {"ORA", ABY}, {"*NOP", IMP}, {"*SLO", ABY}, {"*NOP", ABX}, {"ORA", ABX}, {"ASL", ABX}, {"*SLO", ABX},
+        {"JSR", ABS}, {"AND", IZX}, {"*KIL", IMP}, {"*RLA", IZX}, {"BIT", ZP}, {"AND", ZP}, {"ROL", ZP}, {"*RLA", ZP},
+        {"PLP", IMP}, {"AND", IMM}, {"ROL", ACC}, {"*ANC", IMM}, {"BIT", ABS}, {"AND", ABS}, {"ROL", ABS}, {"*RLA", ABS},
+        {"BMI", REL}, {"AND", IZY}, {"*KIL", IMP}, {"*RLA", IZY}, {"*NOP", ZPX}, {"AND", ZPX}, {"ROL", ZPX}, {"*RLA", ZPX},
+        {"SEC", IMP}, {"AND", ABY}, {"*NOP", IMP}, {"*RLA", ABY}, {"*NOP", ABX}, {"AND", ABX}, {"ROL", ABX}, {"*RLA", ABX},
+        {"RTI", IMP}, {"EOR", IZX}, {"*KIL", IMP}, {"*SRE", IZX}, {"*NOP", ZP}, {"EOR", ZP}, {"LSR", ZP}, {"*SRE", ZP},
+        {"PHA", IMP}, {"EOR", IMM}, {"LSR", ACC}, {"*ALR", IMM}, {"JMP", ABS}, {"EOR", ABS}, {"LSR", ABS}, {"*SRE", ABS},
+        {"BVC", REL}, {"EOR", IZY}, {"*KIL", IMP}, {"*SRE", IZY}, {"*NOP", ZPX}, {"EOR", ZPX}, {"LSR", ZPX}, {"*SRE", ZPX},
+        {"CLI", IMP}, {"EOR", ABY}, {"*NOP", IMP}, {"*SRE", ABY}, {"*NOP", ABX}, {"EOR", ABX}, {"LSR", ABX}, {"*SRE", ABX},
+        {"RTS", IMP}, {"ADC", IZX}, {"*KIL", IMP}, {"*RRA", IZX}, {"*NOP", ZP}, {"ADC", ZP}, {"ROR", ZP}, {"*RRA", ZP},
+        {"PLA", IMP}, {"ADC", IMM}, {"ROR", ACC}, {"*ARR", IMM}, {"JMP", IND}, {"ADC", ABS}, {"ROR", ABS}, {"*RRA", ABS},
+        {"BVS", REL}, {"ADC", IZY}, {"*KIL", IMP}, {"*RRA", IZY}, {"*NOP", ZPX}, {"ADC", ZPX}, {"ROR", ZPX}, {"*RRA", ZPX},
+        {"SEI", IMP}, {"ADC", ABY}, {"*NOP", IMP}, {"*RRA", ABY}, {"*NOP", ABX}, {"ADC", ABX}, {"ROR", ABX}, {"*RRA", ABX},
+        {"*NOP", IMM}, {"STA", IZX}, {"*NOP", IMM}, {"*SAX", IZX}, {"STY", ZP}, {"STA", ZP}, {"STX", ZP}, {"*SAX", ZP},
+        {"DEY", IMP}, {"*NOP", IMM}, {"TXA", IMP}, {"*XAA", IMM}, {"STY", ABS}, {"STA", ABS}, {"STX", ABS}, {"*SAX", ABS},
+        {"BCC", REL}, {"STA", IZY}, {"*KIL", IMP}, {"*AHX", IZY}, {"STY", ZPX}, {"STA", ZPX}, {"STX", ZPY}, {"*SAX", ZPY},
+        {"TYA", IMP}, {"STA", ABY}, {"TXS", IMP}, {"*TAS", ABY}, {"*SHY", ABX}, {"STA", ABX}, {"*SHX", ABY}, {"*AHX", ABY},
+        {"LDY", IMM}, {"LDA", IZX}, {"LDX", IMM}, {"*LAX", IZX}, {"LDY", ZP}, {"LDA", ZP}, {"LDX", ZP}, {"*LAX", ZP},
+        {"TAY", IMP}, {"LDA", IMM}, {"TAX", IMP}, {"*LAX", IMM}, {"LDY", ABS}, {"LDA", ABS}, {"LDX", ABS}, {"*LAX", ABS},
+        {"BCS", REL}, {"LDA", IZY}, {"*KIL", IMP}, {"*LAX", IZY}, {"LDY", ZPX}, {"LDA", ZPX}, {"LDX", ZPY}, {"*LAX", ZPY},
+        {"CLV", IMP}, {"LDA", ABY}, {"TSX", IMP}, {"*LAS", ABY}, {"LDY", ABX}, {"LDA", ABX}, {"LDX", ABY}, {"*LAX", ABY},
+        {"CPY", IMM}, {"CMP", IZX}, {"*NOP", IMM}, {"*DCP", IZX}, {"CPY", ZP}, {"CMP", ZP}, {"DEC", ZP}, {"*DCP", ZP},
+        {"INY", IMP}, {"CMP", IMM}, {"DEX", IMP}, {"*AXS", IMM}, {"CPY", ABS}, {"CMP", ABS}, {"DEC", ABS}, {"*DCP", ABS},
+        {"BNE", REL}, {"CMP", IZY}, {"*KIL", IMP}, {"*DCP", IZY}, {"*NOP", ZPX}, {"CMP", ZPX}, {"DEC", ZPX}, {"*DCP", ZPX},
+        {"CLD", IMP}, {"CMP", ABY}, {"*NOP", IMP}, {"*DCP", ABY}, {"*NOP", ABX}, {"CMP", ABX}, {"DEC", ABX}, {"*DCP", ABX},
+        {"CPX", IMM}, {"SBC", IZX}, {"*NOP", IMM}, {"*ISB", IZX}, {"CPX", ZP}, {"SBC", ZP}, {"INC", ZP}, {"*ISB", ZP},
+        {"INX", IMP}, {"SBC", IMM}, {"NOP", IMP}, {"*SBC", IMM}, {"CPX", ABS}, {"SBC", ABS}, {"INC", ABS}, {"*ISB", ABS},
+        {"BEQ", REL}, {"SBC", IZY}, {"*KIL", IMP}, {"*ISB", IZY}, {"*NOP", ZPX}, {"SBC", ZPX}, {"INC", ZPX}, {"*ISB", ZPX},
+        {"SED", IMP}, {"SBC", ABY}, {"*NOP", IMP}, {"*ISB", ABY}, {"*NOP", ABX}, {"SBC", ABX}, {"INC", ABX}, {"*ISB", ABX},
+    }};
+
+    unsigned int operandSize(Mode mode)
+    {
+        switch (mode)
+        {
+        case IMP:
+        case ACC:
+            return 0;
+        case ABS:
+        case ABX:
+        case ABY:
+        case IND:
+            return 2;
+        default:
+            return 1;
+        }
+    }
+
+    std::string formatOperand(const nemus::debug::TraceRecord &record, Mode mode)
+    {
+        const unsigned int low = record.operand[0];
+        const unsigned int word = low | (record.operand[1] << 8);
+
+        switch (mode)
+        {
+        case ACC:
+            return "A";
+        case IMM:
+            return fmt::format("#${:02X}", low);
+        case ZP:
+            return fmt::format("${:02X}", low);
+        case ZPX:
+            return fmt::format("${:02X},X", low);
+        case ZPY:
+            return fmt::format("${:02X},Y", low);
+        case ABS:
+            return fmt::format("${:04X}", word);
+        case ABX:
+            return fmt::format("${:04X},X", word);
+        case ABY:
+            return fmt::format("${:04X},Y", word);
+        case IND:
+            return fmt::format("(${:04X})", word);
+        case IZX:
+            return fmt::format("(${:02X},X)", low);
+        case IZY:
+            return fmt::format("(${:02X}),Y", low);
+        case REL:
+            return fmt::format("${:04X}", (record.pc + 2 + static_cast<int8_t>(low)) & 0xFFFF);
+        default:
+            return "";
+        }
+    }
+
+    void printRecord(const nemus::debug::TraceRecord &record)
+    {
+        const Opcode &opcode = opcodes[record.opcode];
+        const unsigned int size = operandSize(opcode.mode);
+
+        std::string bytes = fmt::format("{:02X}", record.opcode);
+        for (unsigned int i = 0; i < size; i++)
+        {
+            bytes += fmt::format(" {:02X}", record.operand[i]);
+        }
+
+        // Official mnemonics get a leading space so they line up with the
+        // starred unofficial ones, as in nestest.log.
+        std::string instruction = fmt::format("{:>4} {}", opcode.name, formatOperand(record, opcode.mode));
+
+        fmt::print("{:04X}  {:<8} {:<32} A:{:02X} X:{:02X} Y:{:02X} P:{:02X} SP:{:02X} CYC:{}\n",
+                   record.pc, bytes, instruction, record.a, record.x, record.y, record.p, record.sp, record.cycle);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fmt::print(stderr, "Usage: {} <trace.bin>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *file = std::fopen(argv[1], "rb");
+    if (file == nullptr)
+    {
+        fmt::print(stderr, "Unable to open file: {}\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    nemus::debug::TraceHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 || header.magic != TRACE_MAGIC)
+    {
+        fmt::print(stderr, "Not a trace file: {}\n", argv[1]);
+        std::fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    if (header.version != TRACE_VERSION || header.recordSize != sizeof(nemus::debug::TraceRecord))
+    {
+        fmt::print(stderr, "Unsupported trace version {}\n", header.version);
+        std::fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    std::array<nemus::debug::TraceRecord, 4096> records;
+    std::size_t count;
+
+    while ((count = std::fread(records.data(), sizeof(records[0]), records.size(), file)) > 0)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            printRecord(records[i]);
+        }
+    }
+
+    std::fclose(file);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,641 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "Core/Console.h"
+#include "Core/Jit.h"
+#include "Debug/Trace.h"
+
+static constexpr std::size_t TraceCapacity = 1 << 20;
+
+// Enough for the sweep and a few frames of spinning at its end.
+static constexpr std::size_t SweepTraceLength = 1 << 16;
+
+static constexpr unsigned long MaxFrames = 60;
+
+// Where the sweep program parks once it is done.
+static constexpr uint16_t DoneAddress = 0xBFF0;
+
+// Where nestest starts in automation mode, without a PPU.
+static constexpr uint16_t NestestEntry = 0xC000;
+
+// Sweeps run back to back for the JIT check, enough for every block to
+// pass the CPU's compile threshold several times over.
+static constexpr unsigned int JitRepeats = 64;
+
+// Comfortably more than JitRepeats sweeps take.
+static constexpr unsigned long JitFrames = 60;
+
+static constexpr std::size_t RamSize = 0x800;
+
+// Exit status meson reports as a skipped test.
+static constexpr int ExitSkip = 77;
+
+enum Mode
+{
+    IMP,
+    IMM,
+    ZP,
+    ZPX,
+    ZPY,
+    ABS,
+    ABX,
+    ABY,
+    IZX,
+    IZY,
+    REL,
+    SPECIAL
+};
+
+struct Opcode
+{
+    uint8_t opcode;
+    Mode mode;
+};
+
+// Every official opcode. Jumps, calls, returns and BRK get their own setup
+// in emitSpecial().
+static const Opcode Opcodes[] = {
+    {0x00, SPECIAL}, {0x01, IZX}, {0x05, ZP},  {0x06, ZP},  {0x08, IMP}, {0x09, IMM}, {0x0A, IMP}, {0x0D, ABS},
+    {0x0E, ABS},     {0x10, REL}, {0x11, IZY}, {0x15, ZPX}, {0x16, ZPX}, {0x18, IMP}, {0x19, ABY}, {0x1D, ABX},
+    {0x1E, ABX},     {0x20, SPECIAL}, {0x21, IZX}, {0x24, ZP}, {0x25, ZP}, {0x26, ZP}, {0x28, IMP}, {0x29, IMM},
+    {0x2A, IMP},     {0x2C, ABS}, {0x2D, ABS}, {0x2E, ABS}, {0x30, REL}, {0x31, IZY}, {0x35, ZPX}, {0x36, ZPX},
+    {0x38, IMP},     {0x39, ABY}, {0x3D, ABX}, {0x3E, ABX}, {0x40, SPECIAL}, {0x41, IZX}, {0x45, ZP}, {0x46, ZP},
+    {0x48, IMP},     {0x49, IMM}, {0x4A, IMP}, {0x4C, SPECIAL}, {0x4D, ABS}, {0x4E, ABS}, {0x50, REL}, {0x51, IZY},
+    {0x55, ZPX},     {0x56, ZPX}, {0x58, IMP}, {0x59, ABY}, {0x5D, ABX}, {0x5E, ABX}, {0x60, SPECIAL}, {0x61, IZX},
+    {0x65, ZP},      {0x66, ZP},  {0x68, IMP}, {0x69, IMM}, {0x6A, IMP}, {0x6C, SPECIAL}, {0x6D, ABS}, {0x6E, ABS},
+    {0x70, REL},     {0x71, IZY}, {0x75, ZPX}, {0x76, ZPX}, {0x78, IMP}, {0x79, ABY}, {0x7D, ABX}, {0x7E, ABX},
+    {0x81, IZX},     {0x84, ZP},  {0x85, ZP},  {0x86, ZP},  {0x88, IMP}, {0x8A, IMP}, {0x8C, ABS}, {0x8D, ABS},
+    {0x8E, ABS},     {0x90, REL}, {0x91, IZY}, {0x94, ZPX}, {0x95, ZPX}, {0x96, ZPY}, {0x98, IMP}, {0x99, ABY},
+    {0x9A, IMP},     {0x9D, ABX}, {0xA0, IMM}, {0xA1, IZX}, {0xA2, IMM}, {0xA4, ZP}, {0xA5, ZP}, {0xA6, ZP},
+    {0xA8, IMP},     {0xA9, IMM}, {0xAA, IMP}, {0xAC, ABS}, {0xAD, ABS}, {0xAE, ABS}, {0xB0, REL}, {0xB1, IZY},
+    {0xB4, ZPX},     {0xB5, ZPX}, {0xB6, ZPY}, {0xB8, IMP}, {0xB9, ABY}, {0xBA, IMP}, {0xBC, ABX}, {0xBD, ABX},
+    {0xBE, ABY},     {0xC0, IMM}, {0xC1, IZX}, {0xC4, ZP}, {0xC5, ZP}, {0xC6, ZP}, {0xC8, IMP}, {0xC9, IMM},
+    {0xCA, IMP},     {0xCC, ABS}, {0xCD, ABS}, {0xCE, ABS}, {0xD0, REL}, {0xD1, IZY}, {0xD5, ZPX}, {0xD6, ZPX},
+    {0xD8, IMP},     {0xD9, ABY}, {0xDD, ABX}, {0xDE, ABX}, {0xE0, IMM}, {0xE1, IZX}, {0xE4, ZP}, {0xE5, ZP},
+    {0xE6, ZP},      {0xE8, IMP}, {0xE9, IMM}, {0xEA, IMP}, {0xEC, ABS}, {0xED, ABS}, {0xEE, ABS}, {0xF0, REL},
+    {0xF1, IZY},     {0xF5, ZPX}, {0xF6, ZPX}, {0xF8, IMP}, {0xF9, ABY}, {0xFD, ABX}, {0xFE, ABX},
+};
+
+// Register values each pass of the sweep starts its instructions with.
+// X and Y stay below $10 so indexed operands land in initialized RAM, and
+// the absolute indexed operands cross a page once they reach 8.
+struct Pass
+{
+    uint8_t a;
+    uint8_t x;
+    uint8_t y;
+    uint8_t immediate;
+    bool carry;
+};
+
+static const Pass Passes[] = {
+    {0x00, 0x00, 0x0F, 0x00, false},
+    {0x7F, 0x0A, 0x05, 0x01, true},
+    {0xC3, 0x0F, 0x08, 0x80, true},
+};
+
+// Operands of the sweep. Data lives at $20-$2F, $0300, $03F8-$0407 and
+// $0505-$0514; zero page $80-$91 holds pointers to $0505.
+static constexpr uint8_t DataZeroPage = 0x20;
+static constexpr uint16_t DataAbsolute = 0x0300;
+static constexpr uint16_t DataIndexed = 0x03F8;
+static constexpr uint8_t PointerZeroPage = 0x80;
+static constexpr uint16_t JumpPointer = 0x0200;
+
+// Sweeps left to run when repeating, reaching zero once the last is done.
+static constexpr uint16_t RepeatCounter = 0x0600;
+
+class Assembler
+{
+private:
+    std::vector<uint8_t> &m_prg;
+
+    uint16_t m_origin;
+
+    std::size_t m_size = 0;
+
+public:
+    Assembler(std::vector<uint8_t> &prg, uint16_t origin) : m_prg(prg), m_origin(origin) {}
+
+    uint16_t here() { return static_cast<uint16_t>(m_origin + m_size); }
+
+    void seek(uint16_t address) { m_size = address - m_origin; }
+
+    Assembler &byte(uint8_t value)
+    {
+        m_prg[m_size++] = value;
+        return *this;
+    }
+
+    Assembler &word(uint16_t value) { return byte(value & 0xFF).byte(value >> 8); }
+
+    // A relative branch back or forward to target.
+    Assembler &branch(uint8_t opcode, uint16_t target)
+    {
+        const auto offset = static_cast<uint8_t>(target - (here() + 2));
+        return byte(opcode).byte(offset);
+    }
+};
+
+static void emitSpecial(Assembler &code, uint8_t opcode, const Pass &pass, uint16_t subroutine)
+{
+    switch (opcode)
+    {
+    case 0x00:
+        // The IRQ vector returns to the instruction after BRK's padding byte.
+        code.byte(0x00).byte(0x00);
+        break;
+    case 0x20:
+        code.byte(0x20).word(subroutine);
+        break;
+    case 0x40:
+    {
+        // PC and P pushed as an interrupt would, returning right after RTI.
+        const uint16_t next = code.here() + 10;
+        code.byte(0xA9).byte(next >> 8).byte(0x48);
+        code.byte(0xA9).byte(next & 0xFF).byte(0x48);
+        code.byte(0xA9).byte(pass.carry ? 0xC1 : 0x02).byte(0x48);
+        code.byte(0x40);
+        break;
+    }
+    case 0x4C:
+    {
+        const uint16_t next = code.here() + 3;
+        code.byte(0x4C).word(next);
+        break;
+    }
+    case 0x60:
+    {
+        // RTS adds one to the address it pulls.
+        const uint16_t next = code.here() + 7 - 1;
+        code.byte(0xA9).byte(next >> 8).byte(0x48);
+        code.byte(0xA9).byte(next & 0xFF).byte(0x48);
+        code.byte(0x60);
+        break;
+    }
+    case 0x6C:
+    {
+        const uint16_t next = code.here() + 13;
+        code.byte(0xA9).byte(next & 0xFF).byte(0x8D).word(JumpPointer);
+        code.byte(0xA9).byte(next >> 8).byte(0x8D).word(JumpPointer + 1);
+        code.byte(0x6C).word(JumpPointer);
+        break;
+    }
+    }
+}
+
+// A 32 KB NROM image that runs every official opcode from known register
+// values, once per pass, and then parks at DoneAddress. It touches nothing
+// but RAM and the APU frame counter, whose IRQ it disables. With more than
+// one repeat, the passes run that many times over before parking.
+static std::vector<char> buildSweepRom(unsigned int repeats = 1)
+{
+    std::vector<uint8_t> prg(0x8000, 0xEA);
+    Assembler code(prg, 0x8000);
+
+    // Subroutine for JSR and the handler for BRK, NMI and IRQ.
+    const uint16_t subroutine = DoneAddress + 3;
+    const uint16_t handler = DoneAddress + 4;
+
+    code.byte(0x78).byte(0xD8);                                        // SEI, CLD
+    code.byte(0xA2).byte(0xFF).byte(0x9A);                             // LDX #$FF, TXS
+    code.byte(0xA9).byte(0x40).byte(0x8D).word(0x4017);                // LDA #$40, STA $4017
+
+    // RAM starts out undefined, so fill everything the sweep reads.
+    const uint16_t fill = code.here();
+    code.byte(0xA2).byte(0x20);                                        // LDX #$20
+    code.byte(0x8A).byte(0x0A).byte(0x0A).byte(0x0A).byte(0x49).byte(0x3C); // TXA, ASL A x3, EOR #$3C
+    code.byte(0x95).byte(DataZeroPage - 1);                            // STA $1F,X
+    code.byte(0x9D).word(DataAbsolute - 1);                            // STA $02FF,X
+    code.byte(0x9D).word(DataIndexed - 9);                             // STA $03EF,X
+    code.byte(0x9D).word(0x04FF);                                      // STA $04FF,X
+    code.byte(0xCA).branch(0xD0, fill + 2);                            // DEX, BNE
+
+    const uint16_t pointers = code.here();
+    code.byte(0xA9).byte(0x05).byte(0xA2).byte(0x12);                  // LDA #$05, LDX #$12
+    code.byte(0x95).byte(PointerZeroPage - 1);                         // STA $7F,X
+    code.byte(0xCA).branch(0xD0, pointers + 4);                        // DEX, BNE
+
+    if (repeats > 1)
+    {
+        code.byte(0xA9).byte(repeats).byte(0x8D).word(RepeatCounter);  // LDA #repeats, STA counter
+    }
+
+    const uint16_t sweep = code.here();
+
+    for (const Pass &pass : Passes)
+    {
+        code.byte(0xD8);                                               // CLD
+
+        for (const Opcode &op : Opcodes)
+        {
+            code.byte(0xA2).byte(pass.x);                              // LDX #x
+            code.byte(0xA0).byte(pass.y);                              // LDY #y
+            code.byte(0xA9).byte(pass.a);                              // LDA #a
+            code.byte(pass.carry ? 0x38 : 0x18);                       // SEC or CLC
+
+            switch (op.mode)
+            {
+            case IMP:
+                code.byte(op.opcode);
+                break;
+            case IMM:
+                code.byte(op.opcode).byte(pass.immediate);
+                break;
+            case ZP:
+            case ZPX:
+            case ZPY:
+                code.byte(op.opcode).byte(DataZeroPage);
+                break;
+            case ABS:
+                code.byte(op.opcode).word(DataAbsolute);
+                break;
+            case ABX:
+            case ABY:
+                code.byte(op.opcode).word(DataIndexed);
+                break;
+            case IZX:
+            case IZY:
+                code.byte(op.opcode).byte(PointerZeroPage);
+                break;
+            case REL:
+                // Taken or not, execution continues with the next case.
+                code.byte(op.opcode).byte(0x00);
+                break;
+            case SPECIAL:
+                emitSpecial(code, op.opcode, pass, subroutine);
+                break;
+            }
+        }
+    }
+
+    if (repeats > 1)
+    {
+        // The operands BIT reads change every time, so it sees all four
+        // combinations of N and V.
+        code.byte(0xCE).word(RepeatCounter);                           // DEC counter
+        code.byte(0xF0).byte(0x0C);                                    // BEQ to the JMP after these
+        code.byte(0xAD).word(RepeatCounter).byte(0x0A);                // LDA counter, ASL A
+        code.byte(0x85).byte(DataZeroPage);                            // STA $20
+        code.byte(0x8D).word(DataAbsolute);                            // STA $0300
+        code.byte(0x4C).word(sweep);                                   // JMP sweep
+    }
+
+    code.byte(0x4C).word(DoneAddress);
+
+    code.seek(DoneAddress);
+    code.byte(0x4C).word(DoneAddress);                                 // JMP *
+    code.byte(0x60);                                                   // RTS
+    code.byte(0x40);                                                   // RTI
+
+    code.seek(0xFFFA);
+    code.word(handler).word(0x8000).word(handler);
+
+    std::vector<char> rom(INES_HEADER_SIZE + prg.size() + 0x2000, 0);
+    std::memcpy(rom.data(), "NES\x1A", 4);
+    rom[4] = 2;
+    rom[5] = 1;
+
+    std::copy(prg.begin(), prg.end(), rom.begin() + INES_HEADER_SIZE);
+
+    return rom;
+}
+
+static std::string formatRecord(const nemus::debug::TraceRecord &record)
+{
+    return fmt::format("{:04X}  {:02X} {:02X} {:02X}  A:{:02X} X:{:02X} Y:{:02X} P:{:02X} SP:{:02X} CYC:{}",
+                       record.pc, record.opcode, record.operand[0], record.operand[1],
+                       record.a, record.x, record.y, record.p, record.sp, record.cycle);
+}
+
+static bool readLines(const std::string &filename, std::vector<std::string> &lines)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        lines.push_back(line);
+    }
+
+    return true;
+}
+
+// Runs frames until the trace holds count records or the CPU stops.
+static void runTrace(nemus::core::Console &console, nemus::debug::TraceBuffer &trace, std::size_t count)
+{
+    for (unsigned long frame = 0; frame < MaxFrames && trace.getWritten() < count; frame++)
+    {
+        if (!console.runFrame())
+        {
+            break;
+        }
+    }
+}
+
+// The sweep's trace up to and including its arrival at DoneAddress.
+static bool traceSweep(nemus::comp::CPUEngine engine, std::vector<std::string> &lines)
+{
+    nemus::core::Console console;
+    console.setEngine(engine);
+    console.loadGame(buildSweepRom());
+
+    nemus::debug::TraceBuffer trace(TraceCapacity);
+    console.setTrace(&trace);
+
+    runTrace(console, trace, SweepTraceLength);
+
+    for (std::size_t i = 0; i < trace.getSize(); i++)
+    {
+        lines.push_back(formatRecord(trace[i]));
+
+        if (trace[i].pc == DoneAddress)
+        {
+            return trace.getWritten() == trace.getSize();
+        }
+    }
+
+    return false;
+}
+
+static int runSweep(nemus::comp::CPUEngine engine, const char *goldenFile)
+{
+    std::vector<std::string> lines;
+    if (!traceSweep(engine, lines))
+    {
+        fmt::print(stderr, "The sweep program did not finish\n");
+        return EXIT_FAILURE;
+    }
+
+    if (goldenFile == nullptr)
+    {
+        for (const std::string &line : lines)
+        {
+            fmt::print("{}\n", line);
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<std::string> golden;
+    if (!readLines(goldenFile, golden))
+    {
+        fmt::print(stderr, "Unable to open file: {}\n", goldenFile);
+        return EXIT_FAILURE;
+    }
+
+    for (std::size_t i = 0; i < std::max(lines.size(), golden.size()); i++)
+    {
+        const std::string actual = i < lines.size() ? lines[i] : "<end of trace>";
+        const std::string expected = i < golden.size() ? golden[i] : "<end of trace>";
+
+        if (actual != expected)
+        {
+            fmt::print(stderr, "Trace differs at line {}\n  expected: {}\n  actual:   {}\n", i + 1, expected, actual);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fmt::print("{} instructions match\n", lines.size());
+    return EXIT_SUCCESS;
+}
+
+// Where an untraced run of the repeated sweep ends up.
+struct FinalState
+{
+    nemus::comp::Registers reg;
+    uint64_t cycles;
+    std::vector<unsigned char> ram;
+    uint64_t checkedRuns;
+};
+
+// Runs the repeated sweep untraced for JitFrames frames. Returns false if
+// the CPU halts or the sweep is unfinished.
+static bool runUntraced(nemus::comp::JitMode mode, FinalState &state)
+{
+    nemus::core::Console console;
+    console.setJitMode(mode);
+    console.loadGame(buildSweepRom(JitRepeats));
+
+    for (unsigned long frame = 0; frame < JitFrames; frame++)
+    {
+        if (!console.runFrame())
+        {
+            fmt::print(stderr, "CPU halted: {}\n", console.getError());
+            return false;
+        }
+    }
+
+    if (console.getRam()[RepeatCounter] != 0)
+    {
+        fmt::print(stderr, "The sweep program did not finish\n");
+        return false;
+    }
+
+    nemus::core::CPU *cpu = console.getCPU();
+    state.reg = cpu->getRegisters();
+    state.cycles = cpu->getCycles();
+    state.ram.assign(console.getRam(), console.getRam() + RamSize);
+    state.checkedRuns = cpu->getCheckedRuns();
+
+    return true;
+}
+
+static std::string formatState(const FinalState &state)
+{
+    return fmt::format("PC:{:04X} A:{:02X} X:{:02X} Y:{:02X} P:{:02X} SP:{:02X} CYC:{}", state.reg.pc, state.reg.a,
+                       state.reg.x, state.reg.y, state.reg.p, state.reg.sp, state.cycles);
+}
+
+// Compiled code never runs while tracing, so the JIT gets its own check:
+// the sweep repeated until its blocks compile, with JIT_CHECK replaying
+// every native run on the interpreter, and the final registers, cycles
+// and RAM compared against a run without the JIT.
+static int runJitCheck()
+{
+    if (!nemus::core::Jit::isAvailable())
+    {
+        fmt::print("The JIT is not available on this host\n");
+        return ExitSkip;
+    }
+
+    FinalState expected;
+    FinalState actual;
+
+    if (!runUntraced(nemus::comp::JIT_OFF, expected) || !runUntraced(nemus::comp::JIT_CHECK, actual))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (actual.checkedRuns == 0)
+    {
+        fmt::print(stderr, "No compiled code ran\n");
+        return EXIT_FAILURE;
+    }
+
+    if (formatState(actual) != formatState(expected))
+    {
+        fmt::print(stderr, "Final state differs\n  expected: {}\n  actual:   {}\n", formatState(expected),
+                   formatState(actual));
+        return EXIT_FAILURE;
+    }
+
+    const auto difference = std::mismatch(expected.ram.begin(), expected.ram.end(), actual.ram.begin());
+    if (difference.first != expected.ram.end())
+    {
+        fmt::print(stderr, "RAM differs at ${:04X}: expected {:02X}, actual {:02X}\n",
+                   difference.first - expected.ram.begin(), *difference.first, *difference.second);
+        return EXIT_FAILURE;
+    }
+
+    fmt::print("{} compiled block runs match the interpreter\n", actual.checkedRuns);
+    return EXIT_SUCCESS;
+}
+
+// Compares against nestest.log from its PC, registers and cycle columns.
+// The log starts counting cycles at its first line and does not show the
+// B flag or bit 5 the same way the trace does, so neither is compared.
+static int runNestest(const char *romFile, const char *logFile)
+{
+    std::vector<std::string> log;
+    if (!readLines(logFile, log))
+    {
+        fmt::print(stderr, "Unable to open file: {}\n", logFile);
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream file(romFile, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        fmt::print(stderr, "Unable to open file: {}\n", romFile);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<char> rom(file.tellg());
+    file.seekg(file.beg);
+    file.read(rom.data(), rom.size());
+
+    nemus::core::Console console;
+    if (!console.loadGame(rom))
+    {
+        fmt::print(stderr, "Not a valid ROM image: {}\n", romFile);
+        return EXIT_FAILURE;
+    }
+
+    console.setEntryPoint(NestestEntry);
+
+    nemus::debug::TraceBuffer trace(TraceCapacity);
+    console.setTrace(&trace);
+
+    runTrace(console, trace, log.size());
+
+    if (trace.getWritten() != trace.getSize() || trace.getSize() < log.size())
+    {
+        fmt::print(stderr, "Traced {} of {} instructions\n", trace.getSize(), log.size());
+        return EXIT_FAILURE;
+    }
+
+    long firstCycle = 0;
+
+    for (std::size_t i = 0; i < log.size(); i++)
+    {
+        unsigned int pc = 0, a = 0, x = 0, y = 0, p = 0, sp = 0;
+        long cycle = 0;
+
+        const std::size_t registers = log[i].find("A:");
+        const std::size_t cycles = log[i].find("CYC:");
+
+        if (registers == std::string::npos || cycles == std::string::npos ||
+            std::sscanf(log[i].c_str(), "%4x", &pc) != 1 ||
+            std::sscanf(log[i].c_str() + registers, "A:%x X:%x Y:%x P:%x SP:%x", &a, &x, &y, &p, &sp) != 5 ||
+            std::sscanf(log[i].c_str() + cycles, "CYC:%ld", &cycle) != 1)
+        {
+            fmt::print(stderr, "Unable to parse line {} of {}\n", i + 1, logFile);
+            return EXIT_FAILURE;
+        }
+
+        const nemus::debug::TraceRecord &record = trace[i];
+
+        if (i == 0)
+        {
+            firstCycle = cycle - static_cast<long>(record.cycle);
+        }
+
+        if (record.pc != pc || record.a != a || record.x != x || record.y != y ||
+            (record.p & 0xCF) != (p & 0xCF) || record.sp != sp ||
+            static_cast<long>(record.cycle) + firstCycle != cycle)
+        {
+            fmt::print(stderr, "Trace differs at line {}\n  expected: {}\n  actual:   {}\n", i + 1, log[i], formatRecord(record));
+            return EXIT_FAILURE;
+        }
+    }
+
+    fmt::print("{} instructions match\n", log.size());
+    return EXIT_SUCCESS;
+}
+
+static void printUsage(const char *program)
+{
+    fmt::print(stderr, "Usage: {} [-c] [golden.log]\n       {} -j\n       {} -n nestest.nes nestest.log\n", program,
+               program, program);
+}
+
+// Checks the CPU core against reference traces. With a golden log it runs
+// a program sweeping every official opcode and addressing mode and diffs
+// its trace line by line; without one it prints that trace, which is how
+// the golden log is regenerated after an intended timing or behavior
+// change. -c runs the sweep on the cycle engine, which must produce the
+// same trace. -j checks compiled code against the interpreter. With -n
+// it runs nestest from $C000 against nestest.log.
+int main(int argc, char **argv)
+{
+    if (argc == 4 && std::strcmp(argv[1], "-n") == 0)
+    {
+        return runNestest(argv[2], argv[3]);
+    }
+
+    if (argc == 2 && std::strcmp(argv[1], "-j") == 0)
+    {
+        return runJitCheck();
+    }
+
+    auto engine = nemus::comp::ENGINE_INSTRUCTION;
+    const char *goldenFile = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-c") == 0)
+        {
+            engine = nemus::comp::ENGINE_CYCLE;
+        }
+        else if (argv[i][0] != '-' && goldenFile == nullptr)
+        {
+            goldenFile = argv[i];
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return runSweep(engine, goldenFile);
+}